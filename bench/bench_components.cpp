@@ -0,0 +1,124 @@
+//
+// Parsing and formatting time of point cloud files against the number of
+// components, for the stream extraction, the generic and the specialised
+// kernels.
+//
+// Usage: BENCH_COMPONENTS [points] [repeats] [varSize1 varSize2 ...]
+//
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <random>
+#include <vector>
+#include <omp.h>
+
+#include "utils.h"
+#include "components.h"
+
+/*
+Point cloud file of pointSize lines: 3 coordinates and varSize components,
+tab separated as written by the OpenFOAM raw set writer.
+*/
+std::string synthetic_cloud(const long pointSize, const long varSize)
+{
+  std::mt19937 gen(42) ;
+  std::normal_distribution<double> normal ;
+  std::ostringstream cloud ;
+  cloud << std::setprecision(12) ;
+  for (long i = 0; i < pointSize; i++)
+  {
+    cloud << 0.01 * i << " \t" << 0.5 << " \t" << -0.25 ;
+    for (long j = 0; j < varSize; j++)
+      cloud << " \t" << normal(gen) ;
+    cloud << "\n" ;
+  }
+  return cloud.str() ;
+}
+
+/*
+Best time of repeats runs of f.
+*/
+template <typename F>
+double best_time(const int repeats, F f)
+{
+  double best(1.e300) ;
+  for (int r = 0; r < repeats; r++)
+  {
+    const double start(omp_get_wtime()) ;
+    f() ;
+    best = std::min(best, omp_get_wtime() - start) ;
+  }
+  return best ;
+}
+
+int main(int argc, const char *argv[])
+{
+  const long pointSize(argc > 1 ? std::atol(argv[1]) : 100000) ;
+  const int repeats(argc > 2 ? std::atoi(argv[2]) : 5) ;
+  std::vector<long> sizes ;
+  for (int i = 3; i < argc; i++)
+    sizes.push_back(std::atol(argv[i])) ;
+  if (sizes.empty())
+    sizes = {1, 2, 3, 6, 9} ;
+
+  std::cout << "Points: " << pointSize << ", best of " << repeats << " runs, blocked layout\n" << std::endl ;
+  std::cout << std::setw(8) << "varSize" << std::setw(10) << "kernel"
+            << std::setw(14) << "stream (s)" << std::setw(14) << "generic (s)" << std::setw(12) << "kernel (s)"
+            << std::setw(10) << "speedup" << std::setw(16) << "fmt generic (s)" << std::setw(15) << "fmt kernel (s)"
+            << std::setw(10) << "speedup" << std::setw(10) << "max diff" << std::endl ;
+
+  for (auto varSize : sizes)
+  {
+    const std::string cloud(synthetic_cloud(pointSize, varSize)) ;
+    const char *begin(cloud.data()) ;
+    const char *end(begin + cloud.size()) ;
+    const long offset(3) ;
+    const ComponentKernels &kernels(component_kernels(varSize)) ;
+    const ComponentKernels &generic(generic_component_kernels()) ;
+
+    // PARSING
+
+    /* Former reading loop: stream extraction of every value */
+    VectorXd streamColumn(pointSize * varSize) ;
+    const double streamTime(best_time(repeats, [&]() {
+      std::istringstream file(cloud) ;
+      double dummy ;
+      for (long i = 0; i < pointSize; i++)
+      {
+        for (long c = 0; c < offset; c++)
+          file >> dummy ;
+        for (long j = 0; j < varSize; j++)
+          file >> streamColumn(i + pointSize * j) ;
+      }
+    })) ;
+
+    VectorXd genericColumn(pointSize * varSize), kernelColumn(pointSize * varSize) ;
+    const double genericTime(best_time(repeats, [&]() {
+      generic.parse[LAYOUT_BLOCKED](begin, end, pointSize, varSize, offset, genericColumn.data()) ;
+    })) ;
+    const double kernelTime(best_time(repeats, [&]() {
+      kernels.parse[LAYOUT_BLOCKED](begin, end, pointSize, varSize, offset, kernelColumn.data()) ;
+    })) ;
+    const double diff(std::max((kernelColumn - streamColumn).cwiseAbs().maxCoeff(),
+                               (genericColumn - streamColumn).cwiseAbs().maxCoeff())) ;
+
+    // FORMATTING
+
+    std::vector<char> buffer(pointSize * varSize * 26) ;
+    const double genericFormatTime(best_time(repeats, [&]() {
+      generic.format[LAYOUT_BLOCKED](buffer.data(), kernelColumn.data(), pointSize, varSize, nullptr, " \t") ;
+    })) ;
+    const double kernelFormatTime(best_time(repeats, [&]() {
+      kernels.format[LAYOUT_BLOCKED](buffer.data(), kernelColumn.data(), pointSize, varSize, nullptr, " \t") ;
+    })) ;
+
+    std::cout << std::setw(8) << varSize << std::setw(10) << (kernels.varSize ? "special" : "generic")
+              << std::setw(14) << streamTime << std::setw(14) << genericTime << std::setw(12) << kernelTime
+              << std::setw(10) << streamTime / kernelTime << std::setw(16) << genericFormatTime
+              << std::setw(15) << kernelFormatTime << std::setw(10) << genericFormatTime / kernelFormatTime
+              << std::setw(10) << diff << std::endl ;
+  }
+
+  return 0 ;
+}
@@ -0,0 +1,85 @@
+//
+// Time-to-solution of the eigen-solvers against the number of snapshots.
+//
+// Usage: BENCH_EIG [threads] [nev] [T1 T2 ...]
+//
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <Eigen/Dense>
+#include <omp.h>
+
+#include "eigensolvers.h"
+
+/*
+Correlation matrix of synthetic snapshots with an exponentially decaying
+spectrum plus noise, as for a periodic wake.
+*/
+MatrixXd synthetic_correlation(const long pointSize, const long timesSize)
+{
+  std::mt19937 gen(42) ;
+  std::normal_distribution<double> normal ;
+
+  const long rankSize(std::min(64L, timesSize)) ;
+  MatrixXd u(pointSize, rankSize), v(timesSize, rankSize) ;
+  for (long i = 0; i < u.size(); i++) u.data()[i] = normal(gen) ;
+  for (long i = 0; i < v.size(); i++) v.data()[i] = normal(gen) ;
+  VectorXd s(rankSize) ;
+  for (long i = 0; i < rankSize; i++) s(i) = std::exp(-0.2 * i) ;
+
+  MatrixXd m(u * s.asDiagonal() * v.transpose()) ;
+  for (long i = 0; i < m.size(); i++) m.data()[i] += 1.e-4 * normal(gen) ;
+
+  return (1.0 / timesSize) * m.transpose() * m ;
+}
+
+int main(int argc, const char *argv[])
+{
+  const int threadsSize(argc > 1 ? std::atoi(argv[1]) : omp_get_max_threads()) ;
+  const long nev(argc > 2 ? std::atol(argv[2]) : 20) ;
+  std::vector<long> sizes ;
+  for (int i = 3; i < argc; i++)
+    sizes.push_back(std::atol(argv[i])) ;
+  if (sizes.empty())
+    sizes = {500, 1000, 2000, 4000} ;
+
+  omp_set_num_threads(threadsSize) ;
+  std::cout << "Threads: " << threadsSize << ", wanted eigenpairs: " << nev << "\n" << std::endl ;
+  std::cout << std::setw(8) << "T" << std::setw(12) << "full (s)"
+            << std::setw(14) << "Lanczos (s)" << std::setw(10) << "speedup" << std::setw(14) << "max rel. err"
+            << std::setw(12) << "D&C (s)" << std::setw(10) << "speedup" << std::setw(14) << "max rel. err" << std::endl ;
+
+  for (auto timesSize : sizes)
+  {
+    MatrixXd pm(synthetic_correlation(1000, timesSize)) ;
+
+    double start(omp_get_wtime()) ;
+    SelfAdjointEigenSolver<MatrixXd> eigensolver(pm) ;
+    const VectorXd fullEigval = eigensolver.eigenvalues() ;
+    const double largest(fullEigval(fullEigval.size() - 1)) ;
+    const double fullTime(omp_get_wtime() - start) ;
+
+    VectorXd eigval ;
+    MatrixXd eigvec ;
+    start = omp_get_wtime() ;
+    lanczos_eigen(pm, nev, 1., pm.trace(), eigval, eigvec) ;
+    const double lanczosTime(omp_get_wtime() - start) ;
+
+    const double err(((eigval - fullEigval.tail(eigval.size())).array().abs() / largest).maxCoeff()) ;
+
+    VectorXd dcEigval ;
+    MatrixXd dcEigvec ;
+    start = omp_get_wtime() ;
+    divide_conquer_eigen(pm, dcEigval, dcEigvec) ;
+    const double dcTime(omp_get_wtime() - start) ;
+    const double dcErr(((dcEigval - fullEigval).array().abs() / largest).maxCoeff()) ;
+
+    std::cout << std::setw(8) << timesSize << std::setw(12) << fullTime
+              << std::setw(14) << lanczosTime << std::setw(10) << fullTime / lanczosTime << std::setw(14) << err
+              << std::setw(12) << dcTime << std::setw(10) << fullTime / dcTime << std::setw(14) << dcErr << std::endl ;
+  }
+
+  return 0 ;
+}
@@ -0,0 +1,120 @@
+//
+// In-situ POD of the fields of a running solver, without any file.
+//
+// Usage: INSITU_POD [points] [steps] [threads] [outDir]
+//
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <random>
+#include <Eigen/Dense>
+#include <omp.h>
+
+#include "libpod.h"
+
+/*
+Stand-in for a flow solver: a 2-component field on a line of points, made of
+travelling waves and noise, overwritten in its own buffer every time step.
+*/
+class WakeSolver {
+public:
+  explicit WakeSolver(const long pointSize) :
+  m_pointSize(pointSize),
+  m_step(0),
+  m_field(2 * pointSize),
+  m_gen(7) {
+  }
+
+  void step()
+  {
+    std::normal_distribution<double> noise(0., 1.e-3) ;
+    const double t(0.05 * m_step++) ;
+    for (long i = 0; i < m_pointSize; i++)
+    {
+      const double x(10. * i / m_pointSize) ;
+      m_field[i] = 1. + 0.5 * std::sin(x - 2. * t) + 0.1 * std::sin(2. * x - 4. * t) + noise(m_gen) ;
+      m_field[m_pointSize + i] = 0.5 * std::cos(x - 2. * t) + 0.1 * std::cos(2. * x - 4. * t) + noise(m_gen) ;
+    }
+  }
+
+  const double *field() const { return m_field.data() ; }
+  long rows() const { return (long)m_field.size() ; }
+
+private:
+  long m_pointSize ;
+  long m_step ;
+  std::vector<double> m_field ;
+  std::mt19937 m_gen ;
+} ;
+
+int main(int argc, const char *argv[])
+{
+  const long pointSize(argc > 1 ? std::atol(argv[1]) : 20000) ;
+  const long stepsSize(argc > 2 ? std::atol(argv[2]) : 400) ;
+  const int threadsSize(argc > 3 ? std::atoi(argv[3]) : omp_get_max_threads()) ;
+  omp_set_num_threads(threadsSize) ;
+
+  // SNAPSHOTS COPIED FROM THE SOLVER BUFFER EVERY STEP
+
+  /* The solver overwrites its field, which the source copies once; the
+  correlation matrix is updated with the new snapshot at every step */
+  WakeSolver solver(pointSize) ;
+  SnapshotSource snapshots(solver.rows()) ;
+  GramAccumulator gram ;
+  double start(omp_get_wtime()) ;
+  for (long s = 0; s < stepsSize; s++)
+  {
+    solver.step() ;
+    snapshots.append(solver.field()) ;
+    gram.update(snapshots) ;
+  }
+  std::cout << "Accumulated " << gram.size() << " snapshots of " << snapshots.rows() << " values in "
+            << omp_get_wtime() - start << "s" << std::endl ;
+
+  MatrixXd pm ;
+  gram.release(pm) ;
+  const PodBasis basis(pm, 10, 0.9999) ;
+  std::cout << "POD size for RIC 0.9999: " << basis.size() << ", eigenvalues:" ;
+  const VectorXd eigval(basis.eigenvalues()) ;
+  for (long i = 0; i < basis.size(); i++)
+    std::cout << " " << eigval(i) ;
+  std::cout << std::endl ;
+  const MatrixXd modes(basis.modes(snapshots)) ;
+
+  // SNAPSHOTS MAPPED FROM CALLER MEMORY
+
+  /* A solver keeping its own history: the source maps it without copy */
+  WakeSolver history(pointSize) ;
+  std::vector<double> buffer(history.rows() * stepsSize) ;
+  for (long s = 0; s < stepsSize; s++)
+  {
+    history.step() ;
+    std::copy(history.field(), history.field() + history.rows(), buffer.begin() + s * history.rows()) ;
+  }
+  const SnapshotSource mapped(buffer.data(), history.rows(), stepsSize) ;
+  GramAccumulator mappedGram ;
+  mappedGram.update(mapped) ;
+  MatrixXd mappedPm ;
+  mappedGram.release(mappedPm) ;
+  const PodBasis mappedBasis(mappedPm, 10, 0.9999) ;
+  std::cout << "Largest eigenvalue difference between the copied and the mapped snapshots: "
+            << (mappedBasis.eigenvalues().head(basis.size()) - eigval.head(basis.size())).cwiseAbs().maxCoeff()
+            << std::endl ;
+
+  // PROJECTION OF A NEW FIELD
+
+  solver.step() ;
+  const Map<const MatrixXd> field(solver.field(), solver.rows(), 1) ;
+  const Projector projector(modes) ;
+  const MatrixXd rec(projector.reconstruct(projector.coefficients(field))) ;
+  std::cout << "Relative error of the projection of the next field: " << (rec - field).norm() / field.norm() << std::endl ;
+
+  if (argc > 4)
+  {
+    basis.write(snapshots, argv[4], argv[4], 2) ;
+    std::cout << "Wrote the eigenvalues, chronos and modes to " << argv[4] << std::endl ;
+  }
+
+  return 0 ;
+}
@@ -0,0 +1,122 @@
+/*
+ * POD of synthetic snapshots through the C interface (libpod_c.so), checking
+ * the results: exits with 1 if a check fails.
+ *
+ * Usage: POD_C_EXAMPLE [points] [snapshots]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pod_c.h"
+
+static int failures = 0 ;
+
+static void check(const int ok, const char *what, const double value)
+{
+  printf("%-52s %12.3e  %s\n", what, value, ok ? "ok" : "FAILED") ;
+  if (!ok)
+    failures++ ;
+}
+
+int main(int argc, char *argv[])
+{
+  const long rows = argc > 1 ? atol(argv[1]) : 2000 ;
+  const long cols = argc > 2 ? atol(argv[2]) : 100 ;
+  const int podSize = 10 ;
+  long i, j ;
+  int k, l, size = 0 ;
+
+  /* Travelling waves: 4 modes, snapshot j in column j */
+  double *snapshots = malloc(rows * cols * sizeof(double)) ;
+  for (j = 0; j < cols; j++)
+    for (i = 0; i < rows; i++)
+    {
+      const double x = 10. * i / rows, t = 0.05 * j ;
+      snapshots[j * rows + i] = sin(x - 2. * t) + 0.1 * sin(2. * x - 4. * t) ;
+    }
+
+  double *eigval = malloc(cols * sizeof(double)) ;
+  double *chronos = malloc(cols * podSize * sizeof(double)) ;
+  double *modes = malloc(rows * podSize * sizeof(double)) ;
+
+  printf("libpod_c ABI version %d\n", pod_c_abi_version()) ;
+  if (pod_c_compute(snapshots, rows, cols, podSize, 0.99999, 0, &size, eigval, chronos, modes) != POD_C_OK)
+  {
+    printf("pod_c_compute failed: %s\n", pod_c_last_error()) ;
+    return 1 ;
+  }
+  printf("POD size for RIC 0.99999: %d, eigenvalues:", size) ;
+  for (k = 0; k < size; k++)
+    printf(" %g", eigval[k]) ;
+  printf("\n") ;
+  check(size == 4, "number of modes (4 expected)", size) ;
+
+  /* Orthonormal modes */
+  double orthoError = 0. ;
+  for (k = 0; k < size; k++)
+    for (l = 0; l < size; l++)
+    {
+      double dot = 0. ;
+      for (i = 0; i < rows; i++)
+        dot += modes[k * rows + i] * modes[l * rows + i] ;
+      orthoError = fmax(orthoError, fabs(dot - (k == l))) ;
+    }
+  check(orthoError < 1.e-10, "largest deviation of Phi^T Phi from identity", orthoError) ;
+
+  /* Coefficients of the snapshots = chronos (stored times x modes) */
+  double *coeffs = malloc(size * cols * sizeof(double)) ;
+  if (pod_c_project(modes, rows, size, snapshots, cols, coeffs) != POD_C_OK)
+  {
+    printf("pod_c_project failed: %s\n", pod_c_last_error()) ;
+    return 1 ;
+  }
+  double chronosError = 0. ;
+  for (j = 0; j < cols; j++)
+    for (k = 0; k < size; k++)
+      chronosError = fmax(chronosError, fabs(coeffs[j * size + k] - chronos[k * cols + j])) ;
+  check(chronosError < 1.e-8, "largest difference of the coefficients and chronos", chronosError) ;
+
+  /* Reconstruction and its error */
+  double *fields = malloc(rows * cols * sizeof(double)) ;
+  if (pod_c_reconstruct(modes, rows, size, coeffs, cols, fields) != POD_C_OK)
+  {
+    printf("pod_c_reconstruct failed: %s\n", pod_c_last_error()) ;
+    return 1 ;
+  }
+  double recError = 0. ;
+  for (i = 0; i < rows * cols; i++)
+    recError = fmax(recError, fabs(fields[i] - snapshots[i])) ;
+  check(recError < 1.e-8, "largest reconstruction error", recError) ;
+
+  double *globalError = malloc(size * sizeof(double)) ;
+  double *energy = malloc(size * sizeof(double)) ;
+  if (pod_c_projection_error(snapshots, rows, cols, coeffs, size, NULL, globalError, energy) != POD_C_OK)
+  {
+    printf("pod_c_projection_error failed: %s\n", pod_c_last_error()) ;
+    return 1 ;
+  }
+  for (k = 0; k < size; k++)
+    printf("  rank %d: energy %.8f, relative error %.3e\n", k + 1, energy[k], globalError[k]) ;
+  check(energy[size - 1] > 0.99999, "energy captured by all the modes", energy[size - 1]) ;
+  check(globalError[0] > globalError[size - 1], "error decrease from rank 1 to the last rank",
+        globalError[0] - globalError[size - 1]) ;
+
+  /* Errors are status codes and messages, not crashes */
+  const int status = pod_c_project(NULL, rows, size, snapshots, cols, coeffs) ;
+  printf("Null modes: status %d, \"%s\"\n", status, pod_c_last_error()) ;
+  check(status == POD_C_INVALID_ARGUMENT, "status of a call with null modes", status) ;
+
+  free(snapshots) ;
+  free(eigval) ;
+  free(chronos) ;
+  free(modes) ;
+  free(coeffs) ;
+  free(fields) ;
+  free(globalError) ;
+  free(energy) ;
+
+  printf("%s\n", failures ? "Some checks FAILED" : "All checks passed") ;
+  return failures ? 1 : 0 ;
+}
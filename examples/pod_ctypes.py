@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+# ---------------------------------------------------------------------------
+"""
+POD, projection, reconstruction and error curves of NumPy arrays through the
+C interface of the POD library (libpod_c.so), without files or copies
+
+Usage: pod_ctypes.py [path/to/libpod_c.so]
+"""
+
+import ctypes
+import os
+import sys
+import numpy as np
+from numpy.ctypeslib import ndpointer
+
+# ---------------------------------------------------------------------------
+# BINDINGS
+# ---------------------------------------------------------------------------
+#- A matrix with rows values per column is a C-ordered array of shape
+#- (columns, rows): snapshot j, mode i, ... are the rows of the arrays
+DOUBLES = ndpointer(dtype=np.float64, flags='C_CONTIGUOUS')
+#- Same, accepting None for the outputs to skip
+class OptionalDoubles(object):
+    @classmethod
+    def from_param(cls, a):
+        return None if a is None else DOUBLES.from_param(a)
+
+class PodLibrary():
+    def __init__(self, path):
+        self.lib = ctypes.CDLL(path)
+        lib = self.lib
+        lib.pod_c_abi_version.restype = ctypes.c_int
+        lib.pod_c_last_error.restype = ctypes.c_char_p
+        lib.pod_c_set_threads.argtypes = [ctypes.c_int]
+        lib.pod_c_set_verbose.argtypes = [ctypes.c_int]
+        lib.pod_c_compute.argtypes = [DOUBLES, ctypes.c_long, ctypes.c_long,
+                                      ctypes.c_int, ctypes.c_double, ctypes.c_int,
+                                      ctypes.POINTER(ctypes.c_int),
+                                      OptionalDoubles, OptionalDoubles, OptionalDoubles]
+        lib.pod_c_project.argtypes = [DOUBLES, ctypes.c_long, ctypes.c_long,
+                                      DOUBLES, ctypes.c_long, DOUBLES]
+        lib.pod_c_reconstruct.argtypes = [DOUBLES, ctypes.c_long, ctypes.c_long,
+                                          DOUBLES, ctypes.c_long, DOUBLES]
+        lib.pod_c_projection_error.argtypes = [DOUBLES, ctypes.c_long, ctypes.c_long,
+                                               DOUBLES, ctypes.c_long,
+                                               OptionalDoubles, OptionalDoubles, OptionalDoubles]
+        for f in (lib.pod_c_compute, lib.pod_c_project, lib.pod_c_reconstruct, lib.pod_c_projection_error):
+            f.restype = ctypes.c_int
+
+    def check(self, status):
+        if status != 0:
+            raise RuntimeError(self.lib.pod_c_last_error().decode())
+
+    def version(self):
+        return self.lib.pod_c_abi_version()
+
+    def set_threads(self, threads):
+        self.lib.pod_c_set_threads(threads)
+
+    def set_verbose(self, verbose):
+        self.lib.pod_c_set_verbose(1 if verbose else 0)
+
+    #- snapshots: (T, N); returns eigenvalues (T), chronos (k, T), modes (k, N)
+    def compute(self, snapshots, podSize, targetRic, eigSolver=0):
+        snapshots = np.ascontiguousarray(snapshots, dtype=np.float64)
+        T, N = snapshots.shape
+        eigval = np.empty(T)
+        chronos = np.empty((podSize, T))
+        modes = np.empty((podSize, N))
+        size = ctypes.c_int(0)
+        self.check(self.lib.pod_c_compute(snapshots, N, T, podSize, targetRic, eigSolver,
+                                          ctypes.byref(size), eigval, chronos, modes))
+        return eigval, chronos[:size.value], modes[:size.value]
+
+    #- modes: (k, N), snapshots: (T, N); returns coefficients (T, k)
+    def project(self, modes, snapshots):
+        modes = np.ascontiguousarray(modes, dtype=np.float64)
+        snapshots = np.ascontiguousarray(snapshots, dtype=np.float64)
+        coeffs = np.empty((snapshots.shape[0], modes.shape[0]))
+        self.check(self.lib.pod_c_project(modes, modes.shape[1], modes.shape[0],
+                                          snapshots, snapshots.shape[0], coeffs))
+        return coeffs
+
+    #- modes: (k, N), coeffs: (T, k); returns fields (T, N)
+    def reconstruct(self, modes, coeffs):
+        modes = np.ascontiguousarray(modes, dtype=np.float64)
+        coeffs = np.ascontiguousarray(coeffs, dtype=np.float64)
+        fields = np.empty((coeffs.shape[0], modes.shape[1]))
+        self.check(self.lib.pod_c_reconstruct(modes, modes.shape[1], modes.shape[0],
+                                              coeffs, coeffs.shape[0], fields))
+        return fields
+
+    #- snapshots: (T, N), coeffs: (T, k); returns the errors per snapshot
+    #- (T, k), the global errors (k) and the energy captured (k) per rank
+    def projection_error(self, snapshots, coeffs):
+        snapshots = np.ascontiguousarray(snapshots, dtype=np.float64)
+        coeffs = np.ascontiguousarray(coeffs, dtype=np.float64)
+        T, k = coeffs.shape
+        snapError = np.empty((T, k))
+        globalError = np.empty(k)
+        energy = np.empty(k)
+        self.check(self.lib.pod_c_projection_error(snapshots, snapshots.shape[1], T, coeffs, k,
+                                                   snapError, globalError, energy))
+        return snapError, globalError, energy
+
+# ---------------------------------------------------------------------------
+# MAIN
+# ---------------------------------------------------------------------------
+if __name__ == '__main__':
+    path = sys.argv[1] if len(sys.argv) > 1 else os.path.join(os.getcwd(), 'lib', 'libpod_c.so')
+    pod = PodLibrary(path)
+    print('libpod_c ABI version', pod.version())
+
+    #- Travelling waves and noise: 200 snapshots of 5000 values
+    rng = np.random.default_rng(7)
+    x = np.linspace(0., 10., 5000)
+    t = 0.05 * np.arange(200)[:, None]
+    snapshots = np.sin(x - 2.*t) + 0.1*np.sin(2.*x - 4.*t) + 1.e-3*rng.standard_normal((200, 5000))
+
+    eigval, chronos, modes = pod.compute(snapshots, 10, 0.9999)
+    print('POD size for RIC 0.9999:', len(modes), ', eigenvalues:', eigval[:len(modes)])
+
+    #- Same eigenvalues as the SVD of the snapshots
+    s = np.linalg.svd(snapshots, compute_uv=False)
+    print('Largest relative difference with the SVD eigenvalues: %.3e'
+          % np.max(np.abs(eigval[:len(modes)] - s[:len(modes)]**2 / len(snapshots)) / eigval[0]))
+
+    coeffs = pod.project(modes, snapshots)
+    print('Largest difference of the coefficients and chronos: %.3e' % np.max(np.abs(coeffs - chronos.T)))
+
+    fields = pod.reconstruct(modes, coeffs)
+    snapError, globalError, energy = pod.projection_error(snapshots, coeffs)
+    for rank in range(len(modes)):
+        print('  rank %d: energy %.8f, relative error %.3e' % (rank + 1, energy[rank], globalError[rank]))
+    print('Relative error of the reconstruction: %.3e (%.3e from the error curves)'
+          % (np.linalg.norm(fields - snapshots) / np.linalg.norm(snapshots), globalError[-1]))
+
+    try:
+        pod.compute(snapshots, 0, 0.9999)
+    except RuntimeError as e:
+        print('Error reported for a POD size of 0:', e)
@@ -0,0 +1,664 @@
+//
+// Resident POD basis answering projection and reconstruction requests on a
+// Unix-domain socket.
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <new>
+#include <sstream>
+#include <fcntl.h>
+#include <omp.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "basisserver.h"
+#include "libpod.h"
+
+static const uint32_t basisMagic(0x50445342) ; // "BSDP"
+static const size_t latenciesSize(65536) ;
+static const int64_t maxPayload(int64_t(1) << 36) ;
+
+std::atomic<bool> BasisServer::m_stopRequested(false) ;
+
+static bool read_full(const int fd, void *data, size_t size)
+{
+  char *bytes(static_cast<char*>(data)) ;
+  while (size > 0)
+  {
+    const ssize_t n(recv(fd, bytes, size, 0)) ;
+    if (n < 0 && errno == EINTR)
+      continue ;
+    if (n <= 0)
+      return false ;
+    bytes += n ;
+    size -= n ;
+  }
+  return true ;
+}
+
+static bool write_full(const int fd, const void *data, size_t size)
+{
+  const char *bytes(static_cast<const char*>(data)) ;
+  while (size > 0)
+  {
+    const ssize_t n(send(fd, bytes, size, MSG_NOSIGNAL)) ;
+    if (n < 0 && errno == EINTR)
+      continue ;
+    if (n <= 0)
+      return false ;
+    bytes += n ;
+    size -= n ;
+  }
+  return true ;
+}
+
+static sockaddr_un socket_address(const std::string &socketName)
+{
+  sockaddr_un address ;
+  std::memset(&address, 0, sizeof(address)) ;
+  address.sun_family = AF_UNIX ;
+  if (socketName.size() >= sizeof(address.sun_path))
+    throw "Socket path too long" ;
+  std::strncpy(address.sun_path, socketName.c_str(), sizeof(address.sun_path) - 1) ;
+  return address ;
+}
+
+static const char* request_name(const int type)
+{
+  return type == BASIS_PROJECT ? "project" : type == BASIS_RECONSTRUCT ? "reconstruct" : "probe" ;
+}
+
+struct BasisServer::Connection {
+  explicit Connection(const int fd) : m_fd(fd), m_done(false) {}
+  ~Connection() { close(m_fd) ; }
+
+  /*
+  Answer, the header and the payload being written together.
+  */
+  void respond(const uint64_t id, const int status, const long rows, const long cols,
+               const void *data, const size_t bytes)
+  {
+    const ResponseHeader header = {basisMagic, status, id, rows, cols, (int64_t)bytes} ;
+    std::lock_guard<std::mutex> lock(m_writeMutex) ;
+    if (write_full(m_fd, &header, sizeof(header)))
+      write_full(m_fd, data, bytes) ;
+  }
+
+  void respond_error(const uint64_t id, const std::string &message)
+  {
+    respond(id, 1, 0, 0, message.data(), message.size()) ;
+  }
+
+  int m_fd ;
+  std::atomic<bool> m_done ;
+  std::mutex m_writeMutex ;
+} ;
+
+struct BasisServer::Request {
+  std::shared_ptr<Connection> m_connection ;
+  RequestHeader m_header ;
+  std::vector<double> m_values ;
+  std::vector<int64_t> m_points ;
+  std::vector<long> m_rows ;      // rows of the probe points in the basis
+  double m_arrival ;
+
+  /*
+  Requests answered by the same product.
+  */
+  bool batches_with(const Request &other) const
+  {
+    return m_header.type == other.m_header.type && m_header.rank == other.m_header.rank
+           && m_points == other.m_points ;
+  }
+} ;
+
+BasisServer::BasisServer(const std::string &modeFile, const int workersSize,
+                         const long batchColumns, const double batchWait) :
+m_modes(nullptr),
+m_base(nullptr),
+m_mapSize(0),
+m_pinned(false),
+m_workersSize(std::max(workersSize, 1)),
+m_batchColumns(std::max(batchColumns, 1L)),
+m_batchWait(batchWait),
+m_origin(omp_get_wtime()),
+m_draining(false),
+m_stats(BASIS_PROBE + 1) {
+  const MatrixInfo description(read_matrix_info(modeFile)) ;
+  if (description.rows == 0)
+    throw "Missing mode file description (mode.bin.info)" ;
+  m_info = {description.rows, description.cols, description.varSize, description.layout} ;
+  if (m_info.rows <= 0 || m_info.modes <= 0 || m_info.varSize <= 0 || m_info.rows % m_info.varSize != 0)
+    throw "Invalid mode file description" ;
+  if (description.scalar != SCALAR_DOUBLE)
+    throw "Only modes of doubles are served" ;
+
+  const int fd(open(modeFile.c_str(), O_RDONLY)) ;
+  if (fd < 0)
+    throw "Could not open mode file" ;
+  struct stat info ;
+  m_mapSize = m_info.rows * m_info.modes * sizeof(double) ;
+  if (fstat(fd, &info) != 0 || info.st_size != (off_t)m_mapSize)
+  {
+    close(fd) ;
+    throw "Mode file size differs from its description" ;
+  }
+
+  /* Read once, and kept in memory if the memlock limit allows it */
+  m_base = mmap(nullptr, m_mapSize, PROT_READ, MAP_SHARED | MAP_POPULATE, fd, 0) ;
+  close(fd) ;
+  if (m_base == MAP_FAILED)
+  {
+    m_base = nullptr ;
+    throw "Could not map mode file" ;
+  }
+  m_modes = static_cast<const double*>(m_base) ;
+  m_pinned = mlock(m_base, m_mapSize) == 0 ;
+  m_gram = Projector(m_modes, m_info.rows, m_info.modes).gram() ;
+}
+
+BasisServer::~BasisServer()
+{
+  if (m_base)
+  {
+    if (m_pinned)
+      munlock(m_base, m_mapSize) ;
+    munmap(m_base, m_mapSize) ;
+  }
+}
+
+void BasisServer::request_stop()
+{
+  m_stopRequested = true ;
+}
+
+void BasisServer::run(const std::string &socketName)
+{
+  const sockaddr_un address(socket_address(socketName)) ;
+  const int listenFd(socket(AF_UNIX, SOCK_STREAM, 0)) ;
+  if (listenFd < 0)
+    throw "Could not create the socket" ;
+
+  if (bind(listenFd, (const sockaddr*)&address, sizeof(address)) != 0)
+  {
+    /* Socket file left by a server that is gone */
+    const bool inUse(errno == EADDRINUSE) ;
+    const int probeFd(socket(AF_UNIX, SOCK_STREAM, 0)) ;
+    const bool served(inUse && connect(probeFd, (const sockaddr*)&address, sizeof(address)) == 0) ;
+    close(probeFd) ;
+    if (served || unlink(socketName.c_str()) != 0
+        || bind(listenFd, (const sockaddr*)&address, sizeof(address)) != 0)
+    {
+      close(listenFd) ;
+      throw served ? "Another server listens on the socket" : "Could not bind the socket" ;
+    }
+  }
+  if (listen(listenFd, SOMAXCONN) != 0)
+  {
+    close(listenFd) ;
+    unlink(socketName.c_str()) ;
+    throw "Could not listen on the socket" ;
+  }
+
+  m_draining = false ;
+  std::vector<std::thread> workers ;
+  for (int i = 0; i < m_workersSize; i++)
+    workers.emplace_back(&BasisServer::worker, this) ;
+
+  /* Connections, their reader threads being joined once they are done */
+  std::list<std::pair<std::shared_ptr<Connection>, std::thread>> readers ;
+  while (!m_stopRequested)
+  {
+    pollfd ready = {listenFd, POLLIN, 0} ;
+    if (poll(&ready, 1, 100) > 0 && (ready.revents & POLLIN))
+    {
+      const int fd(accept(listenFd, nullptr, nullptr)) ;
+      if (fd >= 0)
+      {
+        auto connection(std::make_shared<Connection>(fd)) ;
+        readers.emplace_back(connection, std::thread(&BasisServer::read_requests, this, connection)) ;
+      }
+    }
+
+    for (auto it = readers.begin(); it != readers.end();)
+    {
+      if (it->first->m_done)
+      {
+        it->second.join() ;
+        it = readers.erase(it) ;
+      }
+      else
+        ++it ;
+    }
+  }
+
+  close(listenFd) ;
+  unlink(socketName.c_str()) ;
+
+  /* No more requests; the queued ones are answered */
+  for (auto &reader : readers)
+  {
+    shutdown(reader.first->m_fd, SHUT_RD) ;
+    reader.second.join() ;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex) ;
+    m_draining = true ;
+  }
+  m_cond.notify_all() ;
+  for (auto &worker : workers)
+    worker.join() ;
+  m_stopRequested = false ;
+}
+
+std::string BasisServer::check(const RequestHeader &header) const
+{
+  if (header.cols < 0 || header.rank < 0 || header.probes < 0)
+    return "Negative size" ;
+  if (header.rank > m_info.modes)
+    return "Rank larger than the number of modes" ;
+  const int64_t rank(header.rank > 0 ? header.rank : m_info.modes) ;
+  const int64_t values(header.type == BASIS_PROJECT ? m_info.rows : rank) ;
+  /* Divided rather than multiplied, so that a huge cols cannot overflow */
+  const int64_t capacity(maxPayload / (int64_t)sizeof(double)) ;
+  if (header.probes > capacity || header.cols > (capacity - header.probes) / std::max<int64_t>(values, 1))
+    return "Request too large" ;
+  return "" ;
+}
+
+void BasisServer::read_requests(std::shared_ptr<Connection> connection)
+{
+  RequestHeader header ;
+  while (read_full(connection->m_fd, &header, sizeof(header)))
+  {
+    if (header.magic != basisMagic)
+      break ;
+    const double arrival(omp_get_wtime()) ;
+
+    if (header.type == BASIS_INFO)
+    {
+      connection->respond(header.id, 0, 0, 0, &m_info, sizeof(m_info)) ;
+      continue ;
+    }
+    if (header.type == BASIS_STATS)
+    {
+      const std::string text(stats()) ;
+      connection->respond(header.id, 0, 0, 0, text.data(), text.size()) ;
+      continue ;
+    }
+    if (header.type == BASIS_STOP)
+    {
+      connection->respond(header.id, 0, 0, 0, nullptr, 0) ;
+      request_stop() ;
+      continue ;
+    }
+    if (header.type != BASIS_PROJECT && header.type != BASIS_RECONSTRUCT && header.type != BASIS_PROBE)
+    {
+      connection->respond_error(header.id, "Unknown request") ;
+      break ;
+    }
+
+    /* The payload of an invalid header cannot be skipped: the connection is closed */
+    if (header.type != BASIS_PROBE)
+      header.probes = 0 ;
+    const std::string error(check(header)) ;
+    if (!error.empty())
+    {
+      connection->respond_error(header.id, error) ;
+      break ;
+    }
+    if (header.rank == 0)
+      header.rank = m_info.modes ;
+
+    auto request(std::make_shared<Request>()) ;
+    request->m_connection = connection ;
+    request->m_header = header ;
+    /* An exception on this thread would terminate the server */
+    try
+    {
+      request->m_points.resize(header.probes) ;
+      request->m_values.resize(header.cols * (header.type == BASIS_PROJECT ? m_info.rows : header.rank)) ;
+    }
+    catch (const std::bad_alloc &)
+    {
+      connection->respond_error(header.id, "Out of memory") ;
+      break ;
+    }
+    if (!read_full(connection->m_fd, request->m_points.data(), request->m_points.size() * sizeof(int64_t))
+        || !read_full(connection->m_fd, request->m_values.data(), request->m_values.size() * sizeof(double)))
+      break ;
+    request->m_arrival = arrival ;
+
+    if (header.type == BASIS_PROBE)
+    {
+      const long pointSize(m_info.rows / m_info.varSize) ;
+      if (std::any_of(request->m_points.begin(), request->m_points.end(),
+                      [pointSize](const int64_t p) { return p < 0 || p >= pointSize ; }))
+      {
+        connection->respond_error(header.id, "Point index out of range") ;
+        continue ;
+      }
+      for (const auto p : request->m_points)
+        for (long j = 0; j < m_info.varSize; j++)
+          request->m_rows.push_back(layout_row(m_info.layout, p, j, pointSize, m_info.varSize)) ;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex) ;
+      m_queue.push_back(request) ;
+    }
+    /* A worker waiting for its batch to fill may not take this request */
+    if (m_batchWait > 0.)
+      m_cond.notify_all() ;
+    else
+      m_cond.notify_one() ;
+  }
+  connection->m_done = true ;
+}
+
+void BasisServer::worker()
+{
+  omp_set_num_threads(1) ;
+  while (true)
+  {
+    std::vector<std::shared_ptr<Request>> batch ;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex) ;
+      m_cond.wait(lock, [this] { return m_draining || !m_queue.empty() ; }) ;
+      if (m_queue.empty())
+        return ;
+
+      /* Columns queued for the product of the head request */
+      auto batchedColumns = [this]() {
+        long columns(0) ;
+        for (const auto &request : m_queue)
+          if (request->batches_with(*m_queue.front()))
+            columns += request->m_header.cols ;
+        return columns ;
+      } ;
+      if (m_batchWait > 0. && batchedColumns() < m_batchColumns)
+      {
+        const auto deadline(std::chrono::steady_clock::now() + std::chrono::duration<double>(m_batchWait)) ;
+        m_cond.wait_until(lock, deadline, [&] {
+          return m_draining || m_queue.empty() || batchedColumns() >= m_batchColumns ;
+        }) ;
+        if (m_queue.empty())
+          continue ;
+      }
+
+      batch.push_back(m_queue.front()) ;
+      m_queue.pop_front() ;
+      long columns(batch[0]->m_header.cols) ;
+      for (auto it = m_queue.begin(); it != m_queue.end() && columns < m_batchColumns;)
+      {
+        if ((*it)->batches_with(*batch[0]) && columns + (*it)->m_header.cols <= m_batchColumns)
+        {
+          columns += (*it)->m_header.cols ;
+          batch.push_back(*it) ;
+          it = m_queue.erase(it) ;
+        }
+        else
+          ++it ;
+      }
+    }
+    compute(batch) ;
+  }
+}
+
+void BasisServer::compute(const std::vector<std::shared_ptr<Request>> &batch)
+{
+  const RequestHeader &head(batch[0]->m_header) ;
+  const long rank(head.rank) ;
+  const long inRows(head.type == BASIS_PROJECT ? m_info.rows : rank) ;
+  long columns(0) ;
+  for (const auto &request : batch)
+    columns += request->m_header.cols ;
+
+  /* Columns of all the requests side by side, without copy for a single one */
+  MatrixXd gathered ;
+  if (batch.size() > 1)
+  {
+    gathered.resize(inRows, columns) ;
+    long c0(0) ;
+    for (const auto &request : batch)
+    {
+      std::copy(request->m_values.begin(), request->m_values.end(), gathered.data() + c0 * inRows) ;
+      c0 += request->m_header.cols ;
+    }
+  }
+  const Map<const MatrixXd> in(batch.size() > 1 ? gathered.data() : batch[0]->m_values.data(), inRows, columns) ;
+
+  MatrixXd out ;
+  try
+  {
+    const Projector projector(m_modes, m_info.rows, rank) ;
+    if (head.type == BASIS_PROJECT)
+    {
+      out.resize(rank + 1, columns) ;
+      auto coeffs(out.topRows(rank)) ;
+      projector.coefficients(in, coeffs) ;
+      out.row(rank) = projector.residuals(in, coeffs, m_gram).transpose() ;
+    }
+    else if (head.type == BASIS_RECONSTRUCT)
+    {
+      out.resize(m_info.rows, columns) ;
+      projector.reconstruct(in, out) ;
+    }
+    else
+    {
+      const std::vector<long> &rows(batch[0]->m_rows) ;
+      const Map<const MatrixXd> modes(m_modes, m_info.rows, rank) ;
+      MatrixXd probes(rows.size(), rank) ;
+      for (size_t i = 0; i < rows.size(); i++)
+        probes.row(i) = modes.row(rows[i]) ;
+      out.noalias() = probes * in ;
+    }
+  }
+  catch (const char *message)
+  {
+    for (const auto &request : batch)
+      request->m_connection->respond_error(request->m_header.id, message) ;
+    return ;
+  }
+  catch (const std::exception &e)
+  {
+    for (const auto &request : batch)
+      request->m_connection->respond_error(request->m_header.id, e.what()) ;
+    return ;
+  }
+
+  long c0(0) ;
+  for (const auto &request : batch)
+  {
+    const long cols(request->m_header.cols) ;
+    request->m_connection->respond(request->m_header.id, 0, out.rows(), cols,
+                                   out.data() + c0 * out.rows(), out.rows() * cols * sizeof(double)) ;
+    c0 += cols ;
+  }
+  record(batch, columns) ;
+}
+
+void BasisServer::record(const std::vector<std::shared_ptr<Request>> &batch, const long columns)
+{
+  const double now(omp_get_wtime()) ;
+  std::lock_guard<std::mutex> lock(m_statsMutex) ;
+  KindStats &stats(m_stats[batch[0]->m_header.type]) ;
+  stats.batches++ ;
+  stats.columns += columns ;
+  for (const auto &request : batch)
+  {
+    stats.requests++ ;
+    if (stats.latencies.size() < latenciesSize)
+      stats.latencies.push_back(now - request->m_arrival) ;
+    else
+      stats.latencies[stats.next] = now - request->m_arrival ;
+    stats.next = (stats.next + 1) % latenciesSize ;
+  }
+}
+
+std::string BasisServer::stats() const
+{
+  const double uptime(omp_get_wtime() - m_origin) ;
+  std::ostringstream out ;
+  out << "Basis " << m_info.rows << " x " << m_info.modes << (m_pinned ? " (pinned)" : " (not pinned)")
+      << ", " << m_workersSize << " workers, up " << uptime << "s" << std::endl ;
+
+  std::lock_guard<std::mutex> lock(m_statsMutex) ;
+  for (int type = BASIS_PROJECT; type <= BASIS_PROBE; type++)
+  {
+    const KindStats &stats(m_stats[type]) ;
+    out << request_name(type) << ": " << stats.requests << " requests (" << stats.requests / uptime << "/s), "
+        << stats.columns << " columns (" << stats.columns / uptime << "/s) in " << stats.batches << " batches" ;
+    if (!stats.latencies.empty())
+    {
+      std::vector<double> latencies(stats.latencies) ;
+      auto percentile = [&latencies](const double q) {
+        auto nth(latencies.begin() + (long)(q * (latencies.size() - 1))) ;
+        std::nth_element(latencies.begin(), nth, latencies.end()) ;
+        return *nth * 1.e3 ;
+      } ;
+      out << ", latency p50 " << percentile(0.5) << " ms, p99 " << percentile(0.99) << " ms (last "
+          << latencies.size() << ")" ;
+    }
+    out << std::endl ;
+  }
+  return out.str() ;
+}
+
+BasisClient::BasisClient(const std::string &socketName) :
+m_fd(-1),
+m_nextId(0) {
+  const sockaddr_un address(socket_address(socketName)) ;
+  m_fd = socket(AF_UNIX, SOCK_STREAM, 0) ;
+  if (m_fd < 0 || connect(m_fd, (const sockaddr*)&address, sizeof(address)) != 0)
+  {
+    if (m_fd >= 0)
+      close(m_fd) ;
+    throw "Could not connect to the basis server" ;
+  }
+}
+
+BasisClient::~BasisClient()
+{
+  close(m_fd) ;
+}
+
+MatrixXd BasisClient::request(const RequestHeader &header, const std::vector<const void*> &blocks,
+                              const std::vector<size_t> &sizes, std::string *text)
+{
+  /* Kept for the message thrown, the client being possibly destroyed meanwhile */
+  thread_local std::string error ;
+
+  RequestHeader sent(header) ;
+  sent.magic = basisMagic ;
+  sent.id = m_nextId++ ;
+  bool written(write_full(m_fd, &sent, sizeof(sent))) ;
+  for (size_t k = 0; k < blocks.size() && written; k++)
+    written = write_full(m_fd, blocks[k], sizes[k]) ;
+
+  ResponseHeader response ;
+  if (!written || !read_full(m_fd, &response, sizeof(response)) || response.magic != basisMagic
+      || response.id != sent.id || response.bytes < 0)
+    throw "Lost connection to the basis server" ;
+
+  std::string payload(response.bytes, '\0') ;
+  if (!read_full(m_fd, &payload[0], payload.size()))
+    throw "Lost connection to the basis server" ;
+  if (response.status != 0)
+  {
+    error = payload ;
+    throw error.c_str() ;
+  }
+  if (text)
+  {
+    *text = payload ;
+    return MatrixXd() ;
+  }
+
+  MatrixXd values(response.rows, response.cols) ;
+  if (values.size() * sizeof(double) != payload.size())
+    throw "Unexpected answer size" ;
+  std::memcpy(values.data(), payload.data(), payload.size()) ;
+  return values ;
+}
+
+BasisInfo BasisClient::info()
+{
+  const RequestHeader header = {0, BASIS_INFO, 0, 0, 0, 0} ;
+  std::string text ;
+  request(header, {}, {}, &text) ;
+  BasisInfo info ;
+  if (text.size() != sizeof(info))
+    throw "Unexpected answer size" ;
+  std::memcpy(&info, text.data(), sizeof(info)) ;
+  return info ;
+}
+
+/*
+Columns as blocks of the request, one block if they are contiguous.
+*/
+static void column_blocks(const Ref<const MatrixXd> &m, std::vector<const void*> &blocks, std::vector<size_t> &sizes)
+{
+  if (m.outerStride() == m.rows() || m.cols() <= 1)
+  {
+    blocks.push_back(m.data()) ;
+    sizes.push_back(m.size() * sizeof(double)) ;
+    return ;
+  }
+  for (long j = 0; j < m.cols(); j++)
+  {
+    blocks.push_back(m.col(j).data()) ;
+    sizes.push_back(m.rows() * sizeof(double)) ;
+  }
+}
+
+MatrixXd BasisClient::project(const Ref<const MatrixXd> &fields, const long rank)
+{
+  const RequestHeader header = {0, BASIS_PROJECT, 0, fields.cols(), rank, 0} ;
+  std::vector<const void*> blocks ;
+  std::vector<size_t> sizes ;
+  column_blocks(fields, blocks, sizes) ;
+  return request(header, blocks, sizes) ;
+}
+
+MatrixXd BasisClient::reconstruct(const Ref<const MatrixXd> &coeffs)
+{
+  const RequestHeader header = {0, BASIS_RECONSTRUCT, 0, coeffs.cols(), coeffs.rows(), 0} ;
+  std::vector<const void*> blocks ;
+  std::vector<size_t> sizes ;
+  column_blocks(coeffs, blocks, sizes) ;
+  return request(header, blocks, sizes) ;
+}
+
+MatrixXd BasisClient::probe(const std::vector<int64_t> &points, const Ref<const MatrixXd> &coeffs)
+{
+  const RequestHeader header = {0, BASIS_PROBE, 0, coeffs.cols(), coeffs.rows(), (int64_t)points.size()} ;
+  std::vector<const void*> blocks = {points.data()} ;
+  std::vector<size_t> sizes = {points.size() * sizeof(int64_t)} ;
+  column_blocks(coeffs, blocks, sizes) ;
+  return request(header, blocks, sizes) ;
+}
+
+std::string BasisClient::stats()
+{
+  const RequestHeader header = {0, BASIS_STATS, 0, 0, 0, 0} ;
+  std::string text ;
+  request(header, {}, {}, &text) ;
+  return text ;
+}
+
+void BasisClient::stop()
+{
+  const RequestHeader header = {0, BASIS_STOP, 0, 0, 0, 0} ;
+  request(header, {}, {}) ;
+}
@@ -0,0 +1,199 @@
+//
+// Resident POD basis answering projection and reconstruction requests on a
+// Unix-domain socket.
+//
+
+#ifndef POD_BASISSERVER_H
+#define POD_BASISSERVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <Eigen/Dense>
+
+using namespace Eigen;
+
+/*
+Requests of the protocol. A request is a RequestHeader followed by its
+payload, in the byte order of the node:
+- BASIS_INFO: no payload; answered by a BasisInfo.
+- BASIS_PROJECT: cols fields (rows doubles each, in the layout of the basis);
+  answered by (rank + 1) x cols doubles, the coefficients on the first rank
+  modes followed by the relative residual of every field.
+- BASIS_RECONSTRUCT: cols coefficient vectors (rank doubles each); answered by
+  rows x cols doubles, the fields.
+- BASIS_PROBE: probes point indices (int64), then cols coefficient vectors;
+  answered by (probes x varSize) x cols doubles, the components of every probe
+  point side by side.
+- BASIS_STATS: no payload; answered by the counters of the server, as text.
+- BASIS_STOP: no payload; the server stops once the queued requests are done.
+A rank of 0 selects all the modes. A failed request is answered with a
+non-zero status and the error message as payload.
+*/
+enum BasisRequestType {
+  BASIS_INFO = 0,
+  BASIS_PROJECT = 1,
+  BASIS_RECONSTRUCT = 2,
+  BASIS_PROBE = 3,
+  BASIS_STATS = 4,
+  BASIS_STOP = 5
+};
+
+struct RequestHeader {
+  uint32_t magic ;
+  uint32_t type ;
+  uint64_t id ;      // echoed in the response
+  int64_t cols ;
+  int64_t rank ;
+  int64_t probes ;
+} ;
+
+struct ResponseHeader {
+  uint32_t magic ;
+  int32_t status ;
+  uint64_t id ;
+  int64_t rows ;
+  int64_t cols ;
+  int64_t bytes ;    // payload size
+} ;
+
+struct BasisInfo {
+  int64_t rows ;
+  int64_t modes ;
+  int64_t varSize ;
+  int64_t layout ;
+} ;
+
+/*
+Modes of mode.bin mapped once and locked in memory (when the memlock limit
+allows it), serving the requests of any number of local clients. Every
+connection has a thread reading its requests into a queue; a pool of workers
+takes the request at the head of the queue together with every queued request
+of the same kind, rank and probe points (up to batchColumns columns, waiting
+at most batchWait seconds for more), and answers them with one product over
+the basis, the basis being streamed once per batch instead of once per
+request. Each worker computes on one thread.
+
+The latency of every request (from its arrival to the sending of the answer)
+is kept for the last requests of each kind, for the percentiles, together
+with the number of requests, columns and batches.
+*/
+class BasisServer {
+public:
+  /*
+  Map modeFile (mode.bin of doubles, described by mode.bin.info).
+  */
+  BasisServer(const std::string &modeFile, const int workersSize,
+              const long batchColumns, const double batchWait) ;
+  ~BasisServer() ;
+
+  BasisServer(const BasisServer&) = delete ;
+  BasisServer &operator=(const BasisServer&) = delete ;
+
+  /*
+  Serve the clients of the socket socketName until a BASIS_STOP request or
+  request_stop(). A stale socket file is replaced.
+  */
+  void run(const std::string &socketName) ;
+
+  /*
+  Stop the running servers; async-signal-safe.
+  */
+  static void request_stop() ;
+
+  const BasisInfo &info() const { return m_info ; }
+  bool pinned() const { return m_pinned ; }
+
+  /*
+  Uptime, workers, and per kind of request the counts, throughputs and p50/p99
+  latencies.
+  */
+  std::string stats() const ;
+
+private:
+  struct Connection ;
+  struct Request ;
+  struct KindStats {
+    uint64_t requests ;
+    uint64_t columns ;
+    uint64_t batches ;
+    std::vector<double> latencies ;  // ring of the last ones, in seconds
+    size_t next ;
+  } ;
+
+  void read_requests(std::shared_ptr<Connection> connection) ;
+  std::string check(const RequestHeader &header) const ;
+  void worker() ;
+  void compute(const std::vector<std::shared_ptr<Request>> &batch) ;
+  void record(const std::vector<std::shared_ptr<Request>> &batch, const long columns) ;
+
+  const double *m_modes ;
+  void *m_base ;
+  size_t m_mapSize ;
+  bool m_pinned ;
+  BasisInfo m_info ;
+  MatrixXd m_gram ;       // Phi^T Phi, for the residuals of projections
+  int m_workersSize ;
+  long m_batchColumns ;
+  double m_batchWait ;
+  double m_origin ;
+
+  std::deque<std::shared_ptr<Request>> m_queue ;
+  bool m_draining ;
+  std::mutex m_mutex ;
+  std::condition_variable m_cond ;
+
+  std::vector<KindStats> m_stats ;
+  mutable std::mutex m_statsMutex ;
+
+  static std::atomic<bool> m_stopRequested ;
+} ;
+
+/*
+Connection of a client to a BasisServer, one request at a time. Fields and
+coefficients are column-major, one column per field.
+*/
+class BasisClient {
+public:
+  explicit BasisClient(const std::string &socketName) ;
+  ~BasisClient() ;
+
+  BasisClient(const BasisClient&) = delete ;
+  BasisClient &operator=(const BasisClient&) = delete ;
+
+  BasisInfo info() ;
+
+  /*
+  Coefficients of the fields on the first rank modes, followed by a row of
+  relative residuals ((rank + 1) x cols).
+  */
+  MatrixXd project(const Ref<const MatrixXd> &fields, const long rank = 0) ;
+
+  /*
+  Fields from coefficients on the first coeffs.rows() modes.
+  */
+  MatrixXd reconstruct(const Ref<const MatrixXd> &coeffs) ;
+
+  /*
+  Components of the points from coefficients (points x varSize rows).
+  */
+  MatrixXd probe(const std::vector<int64_t> &points, const Ref<const MatrixXd> &coeffs) ;
+
+  std::string stats() ;
+  void stop() ;
+
+private:
+  MatrixXd request(const RequestHeader &header, const std::vector<const void*> &blocks,
+                   const std::vector<size_t> &sizes, std::string *text = nullptr) ;
+
+  int m_fd ;
+  uint64_t m_nextId ;
+} ;
+
+#endif //POD_BASISSERVER_H
@@ -0,0 +1,122 @@
+//
+// Point cloud kernels specialised on the number of components per point.
+//
+
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "components.h"
+#include "utils.h"
+
+static inline bool is_space(const char c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f' ;
+}
+
+static inline const char *skip_space(const char *p, const char *end)
+{
+  while (p < end && is_space(*p))
+    p++ ;
+  return p ;
+}
+
+static inline const char *skip_value(const char *p, const char *end)
+{
+  p = skip_space(p, end) ;
+  while (p < end && !is_space(*p))
+    p++ ;
+  return p ;
+}
+
+static inline const char *parse_value(const char *p, const char *end, double &value)
+{
+  p = skip_space(p, end) ;
+  const auto result(std::from_chars(p, end, value)) ;
+  if (result.ec == std::errc())
+    return result.ptr ;
+  if (p == end)
+  {
+    value = 0. ;
+    return p ;
+  }
+
+  /* Forms from_chars rejects (leading +, out of range) go through strtod,
+  on a terminated copy of the value */
+  const char *last(skip_value(p, end)) ;
+  char token[64] ;
+  const size_t size(std::min<size_t>(last - p, sizeof(token) - 1)) ;
+  std::memcpy(token, p, size) ;
+  token[size] = '\0' ;
+  value = std::strtod(token, nullptr) ;
+  return last ;
+}
+
+/* VarSize 0: generic kernel, the count being varSize */
+template <int VarSize, int Layout>
+static const char *parse_points(const char *p, const char *end,
+                                const long pointSize, const long varSize, const long offset,
+                                double *column)
+{
+  const long compSize(VarSize > 0 ? VarSize : varSize) ;
+  for (long i = 0; i < pointSize; i++)
+  {
+    for (long c = 0; c < offset; c++)
+      p = skip_value(p, end) ;
+    for (long j = 0; j < compSize; j++)
+      p = parse_value(p, end, column[Layout == LAYOUT_INTERLEAVED ? j + compSize * i : i + pointSize * j]) ;
+  }
+  return p ;
+}
+
+template <int VarSize, int Layout>
+static char *format_points(char *ptr, const double *column,
+                           const long pointSize, const long varSize,
+                           const std::vector<std::string> *coords,
+                           const char *separator)
+{
+  const long compSize(VarSize > 0 ? VarSize : varSize) ;
+  const size_t separatorSize(std::strlen(separator)) ;
+  for (long i = 0; i < pointSize; i++)
+  {
+    if (coords)
+      ptr = std::copy((*coords)[i].begin(), (*coords)[i].end(), ptr) ;
+
+    for (long j = 0; j < compSize; j++)
+    {
+      if (j > 0)
+        ptr = std::copy(separator, separator + separatorSize, ptr) ;
+      /* Shortest round-trip doubles are at most 24 characters long */
+      ptr = std::to_chars(ptr, ptr + 24, column[Layout == LAYOUT_INTERLEAVED ? j + compSize * i : i + pointSize * j]).ptr ;
+    }
+    *ptr++ = '\n' ;
+  }
+  return ptr ;
+}
+
+template <int VarSize>
+static ComponentKernels kernels_of()
+{
+  return {VarSize,
+          {parse_points<VarSize, LAYOUT_BLOCKED>, parse_points<VarSize, LAYOUT_INTERLEAVED>},
+          {format_points<VarSize, LAYOUT_BLOCKED>, format_points<VarSize, LAYOUT_INTERLEAVED>}} ;
+}
+
+// DISPATCH TABLE
+
+static const ComponentKernels kernelTable[] = {kernels_of<1>(), kernels_of<3>(), kernels_of<6>(), kernels_of<9>()} ;
+static const ComponentKernels genericKernels(kernels_of<0>()) ;
+
+const ComponentKernels &component_kernels(const long varSize)
+{
+  for (const auto &kernels : kernelTable)
+    if (kernels.varSize == varSize)
+      return kernels ;
+  return genericKernels ;
+}
+
+const ComponentKernels &generic_component_kernels()
+{
+  return genericKernels ;
+}
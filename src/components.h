@@ -0,0 +1,56 @@
+//
+// Point cloud kernels specialised on the number of components per point.
+//
+
+#ifndef POD_COMPONENTS_H
+#define POD_COMPONENTS_H
+
+#include <string>
+#include <vector>
+
+/*
+Parse the lines of a point cloud file held in [p, end): for each of the
+pointSize points, skip offset values and write the varSize following ones
+into column, in the layout of the kernel. Values are separated by any white
+space, as for stream extraction; missing values are set to 0. Returns the
+position after the last parsed value.
+*/
+typedef const char *(*ParsePointsKernel)(const char *p, const char *end,
+                                         const long pointSize, const long varSize, const long offset,
+                                         double *column) ;
+
+/*
+Format the varSize components of the pointSize points of column (in the
+layout of the kernel) into ptr, one line per point prefixed with its
+coordinates if coords is given, values being separated by separator.
+Returns the end of the written characters.
+*/
+typedef char *(*FormatPointsKernel)(char *ptr, const double *column,
+                                    const long pointSize, const long varSize,
+                                    const std::vector<std::string> *coords,
+                                    const char *separator) ;
+
+/*
+Kernels of one component count, indexed by VariableLayout. The component
+loops of the specialised kernels have a compile-time trip count (and the
+interleaved stride is a constant), so that the compiler unrolls them; the
+generic kernels (varSize 0) take the count at run time.
+*/
+struct ComponentKernels {
+  long varSize ;
+  ParsePointsKernel parse[2] ;
+  FormatPointsKernel format[2] ;
+} ;
+
+/*
+Kernels for varSize from the dispatch table: specialised for the scalars (1),
+vectors (3), symmetric (6) and full tensors (9), generic otherwise.
+*/
+const ComponentKernels &component_kernels(const long varSize) ;
+
+/*
+Generic kernels, for any varSize.
+*/
+const ComponentKernels &generic_component_kernels() ;
+
+#endif //POD_COMPONENTS_H
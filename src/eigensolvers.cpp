@@ -0,0 +1,787 @@
+//
+// Eigen-solvers for the symmetric correlation matrix.
+//
+
+#include <cmath>
+#include <random>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#include <omp.h>
+
+#include "eigensolvers.h"
+
+template <typename MatrixType>
+void symmetric_matvec(const MatrixType &a, const Matrix<typename MatrixType::Scalar, Dynamic, 1> &x,
+                      Matrix<typename MatrixType::Scalar, Dynamic, 1> &y)
+{
+  const long TSIZE(a.rows()) ;
+  y.resize(TSIZE) ;
+
+#pragma omp parallel for schedule(static)
+  for (long i = 0; i < TSIZE; i++)
+    y(i) = a.col(i).dot(x) ;
+}
+
+/*
+Random unit vector orthogonal to the columns of v, or zero if v already spans
+the whole space.
+*/
+template <typename Scalar>
+static Matrix<Scalar, Dynamic, 1> random_orthogonal(const Ref<const Matrix<Scalar, Dynamic, Dynamic>> &v, std::mt19937 &gen)
+{
+  typedef Matrix<Scalar, Dynamic, 1> Vector ;
+  std::normal_distribution<double> normal ;
+  Vector x(v.rows()) ;
+  for (long i = 0; i < x.size(); i++)
+    x(i) = Scalar(normal(gen)) ;
+
+  for (int pass = 0; pass < 2; pass++)
+    x -= v * (v.adjoint() * x) ;
+
+  const auto norm(x.norm()) ;
+  return norm > 1.e-8 ? Vector(x / norm) : Vector(Vector::Zero(x.size())) ;
+}
+
+/*
+Largest eigenvalue of a on the orthogonal complement of the columns of locked,
+by Lanczos with full reorthogonalisation against them, until the leading Ritz
+pair has a residual below tol, the complement is exhausted, or 128 steps
+(Ritz value plus residual then). A random start has a component on every
+eigenvector of the complement, so that an eigenvalue missed by the main
+iteration, which only sees one direction of a repeated eigenvalue's
+eigenspace, is the leading one here.
+*/
+template <typename MatrixType>
+static double deflated_max_eigenvalue(const MatrixType &a, const Ref<const MatrixType> &locked, const double tol,
+                                      std::mt19937 &gen)
+{
+  typedef typename MatrixType::Scalar Scalar ;
+  typedef Matrix<Scalar, Dynamic, 1> Vector ;
+  const long TSIZE(a.rows()) ;
+  const long stepsSize(std::min(TSIZE - locked.cols(), 128L)) ;
+  if (stepsSize <= 0)
+    return -std::numeric_limits<double>::infinity() ;
+
+  MatrixType v(TSIZE, stepsSize + 1) ;
+  MatrixType h(MatrixType::Zero(stepsSize, stepsSize)) ;
+  v.col(0) = random_orthogonal<Scalar>(locked, gen) ;
+  Vector w(TSIZE) ;
+  double estimate(0.) ;
+
+  for (long j = 0; j < stepsSize; j++)
+  {
+    symmetric_matvec<MatrixType>(a, v.col(j), w) ;
+    auto vj(v.leftCols(j + 1)) ;
+    for (int pass = 0; pass < 2; pass++)
+    {
+      w -= locked * (locked.adjoint() * w) ;
+      const Vector hj(vj.adjoint() * w) ;
+      w -= vj * hj ;
+      h.block(0, j, j + 1, 1) += hj ;
+    }
+    h.block(j, 0, 1, j) = h.block(0, j, j, 1).adjoint().eval() ;
+
+    const double beta(w.norm()) ;
+    const bool exhausted(beta <= 1.e-12 * std::max<double>(std::abs(h(0, 0)), 1.e-300) || j + 1 == stepsSize) ;
+    if (exhausted || (j + 1) % 8 == 0)
+    {
+      SelfAdjointEigenSolver<MatrixType> ritz(h.topLeftCorner(j + 1, j + 1)) ;
+      const double residual(std::abs(beta * ritz.eigenvectors()(j, j))) ;
+      estimate = ritz.eigenvalues()(j) ;
+      if (residual <= tol || exhausted)
+        return estimate + (residual <= tol ? 0. : residual) ;
+    }
+    v.col(j + 1) = w / beta ;
+  }
+
+  return estimate ;
+}
+
+template <typename MatrixType>
+bool lanczos_eigen(const MatrixType &a,
+                   const long nev,
+                   const double targetRic,
+                   const double trace,
+                   Matrix<typename NumTraits<typename MatrixType::Scalar>::Real, Dynamic, 1> &eigval,
+                   MatrixType &eigvec,
+                   const double tol,
+                   const int maxRestarts)
+{
+  typedef typename MatrixType::Scalar Scalar ;
+  typedef typename NumTraits<Scalar>::Real Real ;
+  typedef Matrix<Scalar, Dynamic, 1> Vector ;
+  typedef Matrix<Real, Dynamic, 1> RealVector ;
+  const long TSIZE(a.rows()) ;
+  const long nevSize(std::max(std::min(nev, TSIZE), 1L)) ;
+  auto basisSize = [TSIZE](const long want) { return std::min(TSIZE, std::max(2 * want, want + 32)) ; } ;
+
+  /* Number of wanted eigenpairs, doubled whenever they have converged
+  without reaching the RIC */
+  long wantSize(std::min(nevSize, 16L)) ;
+  long mSize(basisSize(wantSize)) ;
+
+  std::mt19937 gen(5489u) ;
+  MatrixType v(TSIZE, mSize + 1) ;
+  MatrixType h(MatrixType::Zero(mSize, mSize)) ;
+  v.col(0) = random_orthogonal<Scalar>(v.leftCols(0), gen) ;
+
+  long keepSize(0) ;
+  Vector w(TSIZE) ;
+
+  for (int restart = 0; restart < maxRestarts; restart++)
+  {
+    /* Extend the basis from keepSize to mSize vectors. With full
+    reorthogonalisation (classical Gram-Schmidt, twice) the projection
+    coefficients are exactly the columns of H = V^T A V, which after a
+    restart has an arrowhead block followed by a tridiagonal part. */
+    double beta(0.) ;
+    for (long j = keepSize; j < mSize; j++)
+    {
+      symmetric_matvec<MatrixType>(a, v.col(j), w) ;
+
+      auto vj(v.leftCols(j + 1)) ;
+      Vector hj(vj.adjoint() * w) ;
+      w -= vj * hj ;
+      Vector correction(vj.adjoint() * w) ;
+      w -= vj * correction ;
+      hj += correction ;
+
+      h.block(0, j, j + 1, 1) = hj ;
+      h.block(j, 0, 1, j + 1) = hj.adjoint() ;
+
+      beta = w.norm() ;
+      if (beta > 1.e-12 * std::max<double>(std::abs(h(0, 0)), 1.e-300))
+        v.col(j + 1) = w / Real(beta) ;
+      else
+      {
+        /* Invariant subspace found: continue with a new direction */
+        beta = 0. ;
+        v.col(j + 1) = j + 1 < TSIZE ? random_orthogonal<Scalar>(v.leftCols(j + 1), gen) : Vector(Vector::Zero(TSIZE)) ;
+      }
+    }
+
+    // RAYLEIGH-RITZ
+
+    SelfAdjointEigenSolver<MatrixType> ritz(h) ;
+    RealVector theta = ritz.eigenvalues().reverse() ;
+    MatrixType y = ritz.eigenvectors().rowwise().reverse() ;
+
+    /* Leading Ritz pairs with a small residual norm |beta y_m|, the tolerance
+    being bounded by the precision of Scalar */
+    const double tolerance(std::max(tol, 100. * NumTraits<Real>::epsilon())) ;
+    const double scale(std::max<double>(std::abs(theta(0)), 1.e-300)) ;
+    long convSize(0) ;
+    while (convSize < mSize && std::abs(beta * y(mSize - 1, convSize)) <= tolerance * scale)
+      convSize++ ;
+
+    long doneSize(0) ;
+    auto ric(0.) ;
+    for (long i = 0; i < convSize && doneSize == 0; i++)
+    {
+      ric += std::fabs(theta(i)) ;
+      if (ric >= targetRic * trace)
+        doneSize = std::min(i + 1, nevSize) ;
+    }
+    if (doneSize == 0 && convSize >= nevSize)
+      doneSize = nevSize ;
+
+    if (doneSize > 0)
+    {
+      eigval = theta.head(doneSize).reverse() ;
+      eigvec = v.leftCols(mSize) * y.leftCols(doneSize).rowwise().reverse() ;
+
+      /* An eigenvalue missed above the smallest accepted one (a repeated
+      eigenvalue) is the largest one left once the accepted pairs are
+      deflated */
+      const double margin(100. * tolerance * scale) ;
+      const double missed(deflated_max_eigenvalue<MatrixType>(a, eigvec, tolerance * scale, gen)) ;
+      return !(missed >= theta(doneSize - 1) - margin && missed > margin) ;
+    }
+
+    // THICK RESTART
+
+    if (convSize >= wantSize && wantSize < nevSize)
+      wantSize = std::min(2 * wantSize, nevSize) ;
+    const long newMSize(basisSize(wantSize)) ;
+
+    /* Keep the leading Ritz vectors and the last Lanczos vector */
+    keepSize = std::min(mSize - 1, wantSize + (mSize - wantSize) / 2) ;
+    MatrixType ritzVectors(v.leftCols(mSize) * y.leftCols(keepSize)) ;
+    Vector last(v.col(mSize)) ;
+
+    mSize = newMSize ;
+    v.resize(TSIZE, mSize + 1) ;
+    v.leftCols(keepSize) = ritzVectors ;
+    v.col(keepSize) = last ;
+    h = MatrixType::Zero(mSize, mSize) ;
+    h.topLeftCorner(keepSize, keepSize) = theta.head(keepSize).template cast<Scalar>().asDiagonal() ;
+  }
+
+  return false ;
+}
+
+// BLOCKED TRIDIAGONALISATION
+
+#pragma omp declare reduction(+ : std::complex<double> : omp_out += omp_in) initializer(omp_priv = 0.)
+
+/*
+y = a x for a symmetric (Hermitian) matrix of which only the lower triangle is
+up to date. Every thread accumulates the contributions of its columns into its
+own vector.
+*/
+template <typename Scalar>
+static void lower_symv(const Ref<const Matrix<Scalar, Dynamic, Dynamic>> &a, const Ref<const Matrix<Scalar, Dynamic, 1>> &x,
+                       Ref<Matrix<Scalar, Dynamic, 1>> y)
+{
+  typedef Matrix<Scalar, Dynamic, 1> Vector ;
+  const long nSize(a.rows()) ;
+  y.setZero() ;
+
+#pragma omp parallel
+  {
+    Vector yt(Vector::Zero(nSize)) ;
+    const Scalar *xp(x.data()) ;
+    Scalar *yp(yt.data()) ;
+
+#pragma omp for schedule(dynamic, 32) nowait
+    for (long j = 0; j < nSize; j++)
+    {
+      const Scalar *col(a.col(j).data()) ;
+      const Scalar xj(xp[j]) ;
+      Scalar dot(col[j] * xj) ;
+#pragma omp simd reduction(+:dot)
+      for (long i = j + 1; i < nSize; i++)
+      {
+        dot += numext::conj(col[i]) * xp[i] ;
+        yp[i] += col[i] * xj ;
+      }
+      yp[j] += dot ;
+    }
+
+#pragma omp critical
+    y += yt ;
+  }
+}
+
+/*
+Householder reflector (I - tau v v^H)^H x = beta e_1 with v(0) = 1 and beta
+real, overwriting x with v (tau is real for real x).
+*/
+template <typename Scalar>
+static void householder(Ref<Matrix<Scalar, Dynamic, 1>> x, Scalar &tau, typename NumTraits<Scalar>::Real &beta)
+{
+  typedef typename NumTraits<Scalar>::Real Real ;
+  const Scalar alpha(x(0)) ;
+  const Real xnorm(x.size() > 1 ? x.tail(x.size() - 1).norm() : Real(0)) ;
+
+  if (xnorm == Real(0) && numext::imag(alpha) == Real(0))
+  {
+    tau = Scalar(0) ;
+    beta = numext::real(alpha) ;
+  }
+  else
+  {
+    beta = -std::copysign(std::hypot(std::abs(alpha), xnorm), numext::real(alpha)) ;
+    tau = (beta - alpha) / beta ;
+    x.tail(x.size() - 1) /= alpha - beta ;
+  }
+  x(0) = Scalar(1) ;
+}
+
+template <typename MatrixType>
+void tridiagonalize(MatrixType &a, Matrix<typename NumTraits<typename MatrixType::Scalar>::Real, Dynamic, 1> &diag,
+                    Matrix<typename NumTraits<typename MatrixType::Scalar>::Real, Dynamic, 1> &subdiag,
+                    Matrix<typename MatrixType::Scalar, Dynamic, 1> &tau, const long blockSize)
+{
+  typedef typename MatrixType::Scalar Scalar ;
+  typedef Matrix<Scalar, Dynamic, 1> Vector ;
+  const long nSize(a.rows()) ;
+  diag.resize(nSize) ;
+  subdiag.resize(std::max(nSize - 1, 0L)) ;
+  tau = Vector::Zero(std::max(nSize - 1, 0L)) ;
+  if (nSize == 0)
+    return ;
+
+  Vector y(nSize) ;
+
+  for (long k0 = 0; k0 < nSize - 1; k0 += blockSize)
+  {
+    /* Panel of columns k0..k0+nb-1. The trailing matrix is kept as
+    A - V W^H - W V^H, A being only updated after the panel. Row r of V and W
+    stands for row k0 + r of A. */
+    const long nb(std::min(blockSize, nSize - 1 - k0)) ;
+    MatrixType v(MatrixType::Zero(nSize - k0, nb)) ;
+    MatrixType w(MatrixType::Zero(nSize - k0, nb)) ;
+
+    for (long i = 0; i < nb; i++)
+    {
+      const long k(k0 + i) ;
+      const long r(k - k0) ;
+      const long tailSize(nSize - k - 1) ;
+
+      if (i > 0)
+      {
+        a.col(k).tail(nSize - k).noalias() -= v.block(r, 0, nSize - k, i) * w.row(r).head(i).adjoint() ;
+        a.col(k).tail(nSize - k).noalias() -= w.block(r, 0, nSize - k, i) * v.row(r).head(i).adjoint() ;
+      }
+      diag(k) = numext::real(a(k, k)) ;
+
+      /* Reflector annihilating column k below the sub-diagonal, stored in place */
+      Ref<Vector> x(a.col(k).tail(tailSize)) ;
+      householder<Scalar>(x, tau(k), subdiag(k)) ;
+
+      /* w = tau (A v - V W^H v - W V^H v) - tau/2 (v^H w) v, for the update
+      H^H A H = A - v w^H - w v^H */
+      Ref<Vector> yk(y.head(tailSize)) ;
+      lower_symv<Scalar>(a.bottomRightCorner(tailSize, tailSize), x, yk) ;
+      if (i > 0)
+      {
+        const Vector wv(w.bottomLeftCorner(tailSize, i).adjoint() * x) ;
+        const Vector vv(v.bottomLeftCorner(tailSize, i).adjoint() * x) ;
+        yk.noalias() -= v.bottomLeftCorner(tailSize, i) * wv ;
+        yk.noalias() -= w.bottomLeftCorner(tailSize, i) * vv ;
+      }
+      yk *= tau(k) ;
+      yk -= Scalar(0.5) * tau(k) * yk.dot(x) * x ;
+
+      v.col(i).tail(tailSize) = x ;
+      w.col(i).tail(tailSize) = yk ;
+    }
+
+    /* Rank-2nb update of the lower triangle of the trailing matrix, by
+    blocks of columns distributed over the threads */
+    const long j0(k0 + nb) ;
+    const long trailSize(nSize - j0) ;
+    const long colBlock(std::max(64L, trailSize / (4L * omp_get_max_threads()) + 1)) ;
+    const auto vt(v.bottomRows(trailSize)) ;
+    const auto wt(w.bottomRows(trailSize)) ;
+
+#pragma omp parallel for schedule(dynamic)
+    for (long c0 = 0; c0 < trailSize; c0 += colBlock)
+    {
+      const long cols(std::min(colBlock, trailSize - c0)) ;
+      auto target(a.block(j0 + c0, j0 + c0, trailSize - c0, cols)) ;
+      target.noalias() -= vt.bottomRows(trailSize - c0) * wt.middleRows(c0, cols).adjoint() ;
+      target.noalias() -= wt.bottomRows(trailSize - c0) * vt.middleRows(c0, cols).adjoint() ;
+    }
+  }
+
+  diag(nSize - 1) = numext::real(a(nSize - 1, nSize - 1)) ;
+}
+
+template <typename MatrixType>
+void apply_tridiagonal_q(const MatrixType &a, const Matrix<typename MatrixType::Scalar, Dynamic, 1> &tau, MatrixType &z,
+                         const long blockSize)
+{
+  typedef typename MatrixType::Scalar Scalar ;
+  typedef Matrix<Scalar, Dynamic, 1> Vector ;
+  const long nSize(a.rows()) ;
+  const long reflSize(nSize - 1) ;
+  if (reflSize <= 0)
+    return ;
+
+  const long colsSize(z.cols()) ;
+  const long colBlock(std::max(64L, colsSize / (4L * omp_get_max_threads()) + 1)) ;
+  const long lastBlock(((reflSize - 1) / blockSize) * blockSize) ;
+
+  /* Q = H_0 H_1 ... H_{n-2}: the blocks of reflectors are applied last first,
+  each as I - V T V^H (compact WY form) */
+  for (long k0 = lastBlock; k0 >= 0; k0 -= blockSize)
+  {
+    const long nb(std::min(blockSize, reflSize - k0)) ;
+    const long rows(nSize - k0 - 1) ;
+
+    MatrixType v(MatrixType::Zero(rows, nb)) ;
+    for (long i = 0; i < nb; i++)
+      v.col(i).tail(rows - i) = a.col(k0 + i).tail(rows - i) ;
+
+    MatrixType t(MatrixType::Zero(nb, nb)) ;
+    for (long i = 0; i < nb; i++)
+    {
+      t(i, i) = tau(k0 + i) ;
+      if (i > 0)
+      {
+        const Vector vv(v.leftCols(i).adjoint() * v.col(i)) ;
+        const Vector tv(t.topLeftCorner(i, i).template triangularView<Upper>() * vv) ;
+        t.col(i).head(i) = -tau(k0 + i) * tv ;
+      }
+    }
+
+#pragma omp parallel for schedule(dynamic)
+    for (long c0 = 0; c0 < colsSize; c0 += colBlock)
+    {
+      const long cols(std::min(colBlock, colsSize - c0)) ;
+      auto zb(z.block(k0 + 1, c0, rows, cols)) ;
+      MatrixType vz(v.adjoint() * zb) ;
+      vz = t.template triangularView<Upper>() * vz ;
+      zb.noalias() -= v * vz ;
+    }
+  }
+}
+
+// DIVIDE AND CONQUER
+
+/*
+Root of the secular equation 1 + rho sum_j z_j^2 / (delta_j - lambda) = 0 in
+(delta_i, delta_{i+1}), or (delta_{k-1}, delta_{k-1} + rho |z|^2) for the last
+one. lambda is returned as delta_origin + tau, the origin being the nearest
+pole, so that the differences delta_j - lambda are accurate.
+*/
+template <typename Real>
+static void secular_root(const Matrix<Real, Dynamic, 1> &delta, const Matrix<Real, Dynamic, 1> &z, const Real rho,
+                         const long i, long &origin, Real &tau)
+{
+  const long kSize(delta.size()) ;
+  const Real eps(std::numeric_limits<Real>::epsilon()) ;
+  const bool last(i == kSize - 1) ;
+
+  auto secular = [&](const Real t, const long org, Real &psi, Real &dpsi, Real &phi, Real &dphi) {
+    psi = dpsi = phi = dphi = Real(0) ;
+    for (long j = 0; j < kSize; j++)
+    {
+      const Real inv(Real(1) / ((delta(j) - delta(org)) - t)) ;
+      const Real term(rho * z(j) * z(j) * inv) ;
+      if (j <= i) { psi += term ; dpsi += term * inv ; }
+      else        { phi += term ; dphi += term * inv ; }
+    }
+    return Real(1) + psi + phi ;
+  } ;
+
+  Real lo, hi ;
+  Real psi, dpsi, phi, dphi ;
+  if (last)
+  {
+    origin = i ;
+    lo = Real(0) ;
+    hi = rho * z.squaredNorm() ;
+  }
+  else
+  {
+    const Real gap(delta(i + 1) - delta(i)) ;
+    if (secular(Real(0.5) * gap, i, psi, dpsi, phi, dphi) >= Real(0))
+    {
+      origin = i ;
+      lo = Real(0) ;
+      hi = Real(0.5) * gap ;
+    }
+    else
+    {
+      origin = i + 1 ;
+      lo = -Real(0.5) * gap ;
+      hi = Real(0) ;
+    }
+  }
+
+  tau = Real(0.5) * (lo + hi) ;
+  for (int it = 0; it < 200; it++)
+  {
+    const Real f(secular(tau, origin, psi, dpsi, phi, dphi)) ;
+    if (std::fabs(f) <= Real(8) * eps * (Real(1) + std::fabs(psi) + std::fabs(phi)))
+      break ;
+    if (f < Real(0))
+      lo = tau ;
+    else
+      hi = tau ;
+    if (hi - lo <= Real(2) * eps * std::max(std::fabs(lo), std::fabs(hi)))
+      break ;
+
+    /* Rational model matching f and f' at tau, with the poles delta_i and
+    delta_{i+1}, solved for the step h */
+    const Real alpha((delta(i) - delta(origin)) - tau) ;
+    Real h(std::numeric_limits<Real>::quiet_NaN()) ;
+    if (last)
+    {
+      const Real c(f - alpha * dpsi) ;
+      if (c > Real(0))
+        h = alpha + alpha * alpha * dpsi / c ;
+    }
+    else
+    {
+      const Real beta((delta(i + 1) - delta(origin)) - tau) ;
+      const Real c(f - alpha * dpsi - beta * dphi) ;
+      const Real b(c * (alpha + beta) + alpha * alpha * dpsi + beta * beta * dphi) ;
+      const Real disc(b * b - Real(4) * c * alpha * beta * f) ;
+      if (disc >= Real(0))
+      {
+        const Real q(b + std::copysign(std::sqrt(disc), b)) ;
+        const Real h1(c != Real(0) ? q / (Real(2) * c) : std::numeric_limits<Real>::quiet_NaN()) ;
+        const Real h2(q != Real(0) ? Real(2) * alpha * beta * f / q : std::numeric_limits<Real>::quiet_NaN()) ;
+        h = (h2 > alpha && h2 < beta) ? h2 : h1 ;
+      }
+    }
+
+    const Real next(tau + h) ;
+    tau = (next > lo && next < hi) ? next : Real(0.5) * (lo + hi) ;
+  }
+}
+
+/*
+Eigen-decomposition of the symmetric tridiagonal matrix (d, e), overwriting d
+with the eigenvalues (ascending) and q with the eigenvectors. q must be zero
+on entry. The two halves are solved as concurrent tasks and merged by a
+rank-one update (Cuppen, 1981) with deflation, the eigenvectors of the update
+being computed from the Gu & Eisenstat (1995) weights for orthogonality.
+*/
+template <typename Real>
+static void divide_conquer(Ref<Matrix<Real, Dynamic, 1>> d, Ref<Matrix<Real, Dynamic, 1>> e,
+                           Ref<Matrix<Real, Dynamic, Dynamic>> q)
+{
+  typedef Matrix<Real, Dynamic, 1> RealVector ;
+  typedef Matrix<Real, Dynamic, Dynamic> RealMatrix ;
+  const long nSize(d.size()) ;
+  const long leafSize(32) ;
+
+  if (nSize <= leafSize)
+  {
+    SelfAdjointEigenSolver<RealMatrix> eigensolver ;
+    eigensolver.computeFromTridiagonal(d, e, ComputeEigenvectors) ;
+    d = eigensolver.eigenvalues() ;
+    q = eigensolver.eigenvectors() ;
+    return ;
+  }
+
+  /* T = diag(T1, T2) + rho u u^T with u = e_{m-1} + s e_m */
+  const long m(nSize / 2) ;
+  const Real coupling(e(m - 1)) ;
+  const Real sign(coupling < Real(0) ? -Real(1) : Real(1)) ;
+  Real rho(std::fabs(coupling)) ;
+  d(m - 1) -= rho ;
+  d(m) -= rho ;
+
+#pragma omp task default(shared) if(nSize > 256)
+  divide_conquer<Real>(d.head(m), e.head(m - 1), q.topLeftCorner(m, m)) ;
+#pragma omp task default(shared) if(nSize > 256)
+  divide_conquer<Real>(d.tail(nSize - m), e.tail(nSize - m - 1), q.bottomRightCorner(nSize - m, nSize - m)) ;
+#pragma omp taskwait
+
+  // RANK-ONE UPDATE diag(d) + rho z z^T
+
+  RealVector z(nSize) ;
+  z.head(m) = q.row(m - 1).head(m).transpose() ;
+  z.tail(nSize - m) = sign * q.row(m).tail(nSize - m).transpose() ;
+  rho *= z.squaredNorm() ;
+  z.normalize() ;
+
+  std::vector<long> order(nSize) ;
+  for (long i = 0; i < nSize; i++)
+    order[i] = i ;
+  std::stable_sort(order.begin(), order.end(), [&](const long a, const long b) { return d(a) < d(b) ; }) ;
+
+  /* Deflation: negligible weights, and close poles after a rotation zeroing
+  one of their weights */
+  const Real tol(Real(8) * std::numeric_limits<Real>::epsilon() * std::max(d.cwiseAbs().maxCoeff(), rho)) ;
+  std::vector<long> kept, deflated ;
+  for (auto i : order)
+  {
+    if (rho * std::fabs(z(i)) <= tol)
+    {
+      deflated.push_back(i) ;
+      continue ;
+    }
+    if (!kept.empty())
+    {
+      const long j(kept.back()) ;
+      const Real r(std::hypot(z(j), z(i))) ;
+      const Real c(z(i) / r), s(z(j) / r) ;
+      if (std::fabs(c * s * (d(i) - d(j))) <= tol)
+      {
+        const RealVector qj(q.col(j)) ;
+        q.col(j) = c * qj - s * q.col(i) ;
+        q.col(i) = s * qj + c * q.col(i) ;
+        const Real dj(d(j)), di(d(i)) ;
+        d(j) = dj * c * c + di * s * s ;
+        d(i) = dj * s * s + di * c * c ;
+        z(j) = Real(0) ;
+        z(i) = r ;
+        deflated.push_back(j) ;
+        kept.back() = i ;
+        continue ;
+      }
+    }
+    kept.push_back(i) ;
+  }
+
+  const long kSize(kept.size()) ;
+  RealVector lambda(d) ;
+
+  if (kSize > 0)
+  {
+    RealVector delta(kSize), w(kSize) ;
+    for (long j = 0; j < kSize; j++)
+    {
+      delta(j) = d(kept[j]) ;
+      w(j) = z(kept[j]) ;
+    }
+
+    std::vector<long> origins(kSize) ;
+    RealVector taus(kSize) ;
+#pragma omp taskloop default(shared) grainsize(16)
+    for (long i = 0; i < kSize; i++)
+      secular_root(delta, w, rho, i, origins[i], taus(i)) ;
+
+    /* diff(j, i) = delta_j - lambda_i */
+    auto diff = [&](const long j, const long i) { return (delta(j) - delta(origins[i])) - taus(i) ; } ;
+
+    /* Weights for which the computed roots are exact (Gu & Eisenstat) */
+    RealVector zhat(kSize) ;
+#pragma omp taskloop default(shared) grainsize(16)
+    for (long j = 0; j < kSize; j++)
+    {
+      Real prod(-diff(j, j)) ;
+      for (long i = 0; i < kSize; i++)
+      {
+        if (i != j)
+          prod *= -diff(j, i) / (delta(i) - delta(j)) ;
+      }
+      zhat(j) = std::copysign(std::sqrt(std::max(prod, Real(0)) / rho), w(j)) ;
+    }
+
+    RealMatrix u(kSize, kSize) ;
+#pragma omp taskloop default(shared) grainsize(16)
+    for (long i = 0; i < kSize; i++)
+    {
+      for (long j = 0; j < kSize; j++)
+        u(j, i) = zhat(j) / diff(j, i) ;
+      u.col(i).normalize() ;
+    }
+
+    /* Q(:, kept) <- Q(:, kept) U in place, by blocks of rows */
+    const long rowBlock(64) ;
+#pragma omp taskloop default(shared) grainsize(1)
+    for (long r0 = 0; r0 < nSize; r0 += rowBlock)
+    {
+      const long rows(std::min(rowBlock, nSize - r0)) ;
+      RealMatrix rowsQ(rows, kSize) ;
+      for (long j = 0; j < kSize; j++)
+        rowsQ.col(j) = q.col(kept[j]).segment(r0, rows) ;
+      rowsQ = rowsQ * u ;
+      for (long j = 0; j < kSize; j++)
+        q.col(kept[j]).segment(r0, rows) = rowsQ.col(j) ;
+    }
+
+    for (long i = 0; i < kSize; i++)
+      lambda(kept[i]) = delta(origins[i]) + taus(i) ;
+  }
+
+  /* Sort the eigenpairs, permuting the columns of q in place cycle by cycle */
+  for (long i = 0; i < nSize; i++)
+    order[i] = i ;
+  std::stable_sort(order.begin(), order.end(), [&](const long a, const long b) { return lambda(a) < lambda(b) ; }) ;
+  for (long i = 0; i < nSize; i++)
+    d(i) = lambda(order[i]) ;
+
+  std::vector<bool> placed(nSize, false) ;
+  RealVector column(nSize) ;
+  for (long s0 = 0; s0 < nSize; s0++)
+  {
+    if (placed[s0] || order[s0] == s0)
+      continue ;
+    column = q.col(s0) ;
+    long j(s0) ;
+    while (order[j] != s0)
+    {
+      q.col(j) = q.col(order[j]) ;
+      placed[j] = true ;
+      j = order[j] ;
+    }
+    q.col(j) = column ;
+    placed[j] = true ;
+  }
+}
+
+template <typename MatrixType>
+void divide_conquer_eigen(MatrixType &a, Matrix<typename NumTraits<typename MatrixType::Scalar>::Real, Dynamic, 1> &eigval,
+                          MatrixType &eigvec)
+{
+  typedef typename MatrixType::Scalar Scalar ;
+  typedef typename NumTraits<Scalar>::Real Real ;
+  typedef Matrix<Real, Dynamic, 1> RealVector ;
+  typedef Matrix<Real, Dynamic, Dynamic> RealMatrix ;
+  const long nSize(a.rows()) ;
+  RealVector diag, subdiag ;
+  Matrix<Scalar, Dynamic, 1> tau ;
+  tridiagonalize(a, diag, subdiag, tau) ;
+
+  /* The tridiagonal matrix is real also for a complex a (real sub-diagonal
+  of the reflectors) */
+  if constexpr (NumTraits<Scalar>::IsComplex)
+  {
+    RealMatrix q(RealMatrix::Zero(nSize, nSize)) ;
+#pragma omp parallel
+#pragma omp single
+    divide_conquer<Real>(diag, subdiag, q) ;
+    eigvec = q.template cast<Scalar>() ;
+  }
+  else
+  {
+    eigvec = MatrixType::Zero(nSize, nSize) ;
+#pragma omp parallel
+#pragma omp single
+    divide_conquer<Real>(diag, subdiag, eigvec) ;
+  }
+
+  apply_tridiagonal_q(a, tau, eigvec) ;
+
+  eigval.swap(diag) ;
+}
+
+template <typename MatrixType>
+void selfadjoint_eigen_inplace(MatrixType &a,
+                               Matrix<typename NumTraits<typename MatrixType::Scalar>::Real, Dynamic, 1> &eigval,
+                               const bool computeEigenvectors)
+{
+  typedef typename NumTraits<typename MatrixType::Scalar>::Real RealScalar ;
+  const long nSize(a.rows()) ;
+  if (nSize == 1)
+  {
+    eigval = a.diagonal().real() ;
+    a.setOnes() ;
+    return ;
+  }
+
+  /* Scaled to [-1, 1] against over- and underflow, as in SelfAdjointEigenSolver */
+  RealScalar scale(0) ;
+  for (long j = 0; j < nSize; j++)
+    scale = std::max(scale, a.col(j).tail(nSize - j).cwiseAbs().maxCoeff()) ;
+  if (scale == RealScalar(0))
+    scale = RealScalar(1) ;
+  a.template triangularView<Lower>() /= scale ;
+
+  Matrix<RealScalar, Dynamic, 1> subdiag(nSize - 1) ;
+  eigval.resize(nSize) ;
+  internal::tridiagonalization_inplace(a, eigval, subdiag, computeEigenvectors) ;
+  const ComputationInfo info(internal::computeFromTridiagonal_impl(eigval, subdiag, 30, computeEigenvectors, a)) ;
+  if (info != Success)
+    throw "Tridiagonal eigen-solver did not converge" ;
+
+  eigval *= scale ;
+}
+
+template void symmetric_matvec<MatrixXd>(const MatrixXd&, const VectorXd&, VectorXd&) ;
+template void symmetric_matvec<MatrixXf>(const MatrixXf&, const VectorXf&, VectorXf&) ;
+template void symmetric_matvec<MatrixXcd>(const MatrixXcd&, const VectorXcd&, VectorXcd&) ;
+
+template bool lanczos_eigen<MatrixXd>(const MatrixXd&, const long, const double, const double, VectorXd&, MatrixXd&,
+                                      const double, const int) ;
+template bool lanczos_eigen<MatrixXf>(const MatrixXf&, const long, const double, const double, VectorXf&, MatrixXf&,
+                                      const double, const int) ;
+template bool lanczos_eigen<MatrixXcd>(const MatrixXcd&, const long, const double, const double, VectorXd&, MatrixXcd&,
+                                       const double, const int) ;
+
+template void tridiagonalize<MatrixXd>(MatrixXd&, VectorXd&, VectorXd&, VectorXd&, const long) ;
+template void tridiagonalize<MatrixXf>(MatrixXf&, VectorXf&, VectorXf&, VectorXf&, const long) ;
+template void tridiagonalize<MatrixXcd>(MatrixXcd&, VectorXd&, VectorXd&, VectorXcd&, const long) ;
+
+template void apply_tridiagonal_q<MatrixXd>(const MatrixXd&, const VectorXd&, MatrixXd&, const long) ;
+template void apply_tridiagonal_q<MatrixXf>(const MatrixXf&, const VectorXf&, MatrixXf&, const long) ;
+template void apply_tridiagonal_q<MatrixXcd>(const MatrixXcd&, const VectorXcd&, MatrixXcd&, const long) ;
+
+template void divide_conquer_eigen<MatrixXd>(MatrixXd&, VectorXd&, MatrixXd&) ;
+template void divide_conquer_eigen<MatrixXf>(MatrixXf&, VectorXf&, MatrixXf&) ;
+template void divide_conquer_eigen<MatrixXcd>(MatrixXcd&, VectorXd&, MatrixXcd&) ;
+
+template void selfadjoint_eigen_inplace<MatrixXd>(MatrixXd&, VectorXd&, const bool) ;
+template void selfadjoint_eigen_inplace<MatrixXf>(MatrixXf&, VectorXf&, const bool) ;
+template void selfadjoint_eigen_inplace<MatrixXcd>(MatrixXcd&, VectorXd&, const bool) ;
@@ -0,0 +1,128 @@
+//
+// Eigen-solvers for the symmetric correlation matrix.
+//
+
+#ifndef POD_EIGENSOLVERS_H
+#define POD_EIGENSOLVERS_H
+
+#include <Eigen/Dense>
+
+using namespace Eigen;
+
+/*
+Eigen-solvers available for the correlation matrix (as given to -eig).
+*/
+enum EigenSolverType {
+  EIG_FULL = 0,     // All eigenpairs, SelfAdjointEigenSolver
+  EIG_LANCZOS = 1,  // Leading eigenpairs only, thick-restart Lanczos
+  EIG_DIVIDE_CONQUER = 2  // All eigenpairs, multithreaded divide and conquer
+};
+
+/*
+Parallel symmetric (Hermitian) matrix-vector product y = a x. Rows are
+distributed over the threads, and each entry is the dot product of a column
+of a (the matrix being Hermitian) with x, so that a is read contiguously.
+*/
+template <typename MatrixType>
+void symmetric_matvec(const MatrixType &a, const Matrix<typename MatrixType::Scalar, Dynamic, 1> &x,
+                      Matrix<typename MatrixType::Scalar, Dynamic, 1> &y) ;
+
+/*
+All the solvers return the eigenvalues in ascending order, with the
+eigenvectors as columns in the same order (as SelfAdjointEigenSolver), so that
+callers can read them in descending order through reverse() views.
+*/
+
+/*
+Leading eigenpairs of the symmetric (Hermitian) positive semi-definite matrix
+a (in ascending order, see above), by thick-restart Lanczos with full
+reorthogonalisation (Wu & Simon, 2000). The iteration stops as soon as either
+  - the nev leading eigenpairs have converged, or
+  - the leading converged eigenvalues add up to targetRic * trace, trace
+    being the sum of all the eigenvalues (the trace of a),
+and only those eigenpairs are returned. The number of wanted pairs grows
+adaptively, so that a RIC reached with a few modes only costs a small basis.
+A single start vector only finds one direction of the eigenspace of a
+repeated eigenvalue: the accepted pairs are deflated and a short Lanczos run
+on the rest checks that no eigenvalue above the smallest accepted one was
+missed. Returns false if the iteration did not converge or missed an
+eigenvalue; the caller may then fall back to a full solve. The tolerance is
+bounded below by the precision of the scalar type. Instantiated for MatrixXd,
+MatrixXf and MatrixXcd.
+*/
+template <typename MatrixType>
+bool lanczos_eigen(const MatrixType &a,
+                   const long nev,
+                   const double targetRic,
+                   const double trace,
+                   Matrix<typename NumTraits<typename MatrixType::Scalar>::Real, Dynamic, 1> &eigval,
+                   MatrixType &eigvec,
+                   const double tol = 1.e-10,
+                   const int maxRestarts = 500) ;
+
+/*
+Reduce the symmetric (Hermitian) matrix a to tridiagonal form T = Q^H a Q
+(real diagonal diag and sub-diagonal subdiag) by blocked Householder
+reflections, using the lower triangle of a only. Panels of blockSize columns
+are reduced with a parallel symmetric matrix-vector product, and the trailing
+matrix is then updated by a rank-2 blockSize product distributed over the
+threads by blocks of columns. The reflectors are stored below the diagonal of
+a, their scalings in tau.
+*/
+template <typename MatrixType>
+void tridiagonalize(MatrixType &a, Matrix<typename NumTraits<typename MatrixType::Scalar>::Real, Dynamic, 1> &diag,
+                    Matrix<typename NumTraits<typename MatrixType::Scalar>::Real, Dynamic, 1> &subdiag,
+                    Matrix<typename MatrixType::Scalar, Dynamic, 1> &tau, const long blockSize = 64) ;
+
+/*
+z <- Q z, Q being stored in a and tau by tridiagonalize. The reflectors are
+applied by blocks (compact WY form), the columns of z being distributed over
+the threads.
+*/
+template <typename MatrixType>
+void apply_tridiagonal_q(const MatrixType &a, const Matrix<typename MatrixType::Scalar, Dynamic, 1> &tau, MatrixType &z,
+                         const long blockSize = 64) ;
+
+/*
+All the eigenpairs of the symmetric (Hermitian) matrix a: blocked
+tridiagonalisation, divide-and-conquer eigen-decomposition of the real
+tridiagonal matrix (subproblems as OpenMP tasks, rank-one merges updating the
+eigenvectors in place) and blocked back-transformation. Only the lower
+triangle of a is used, and a is overwritten by the reflectors. Instantiated
+for MatrixXd, MatrixXf and MatrixXcd.
+*/
+template <typename MatrixType>
+void divide_conquer_eigen(MatrixType &a, Matrix<typename NumTraits<typename MatrixType::Scalar>::Real, Dynamic, 1> &eigval,
+                          MatrixType &eigvec) ;
+
+/*
+All the eigenvalues of the symmetric (Hermitian) matrix a, and its
+eigenvectors if computeEigenvectors, overwriting a: the tridiagonal QR of
+SelfAdjointEigenSolver without its internal copy of the matrix. Only the lower
+triangle of a is used. Instantiated for MatrixXd, MatrixXf and MatrixXcd.
+*/
+template <typename MatrixType>
+void selfadjoint_eigen_inplace(MatrixType &a,
+                               Matrix<typename NumTraits<typename MatrixType::Scalar>::Real, Dynamic, 1> &eigval,
+                               const bool computeEigenvectors = true) ;
+
+extern template bool lanczos_eigen<MatrixXd>(const MatrixXd&, const long, const double, const double, VectorXd&,
+                                             MatrixXd&, const double, const int) ;
+extern template bool lanczos_eigen<MatrixXf>(const MatrixXf&, const long, const double, const double, VectorXf&,
+                                             MatrixXf&, const double, const int) ;
+extern template bool lanczos_eigen<MatrixXcd>(const MatrixXcd&, const long, const double, const double, VectorXd&,
+                                              MatrixXcd&, const double, const int) ;
+extern template void tridiagonalize<MatrixXd>(MatrixXd&, VectorXd&, VectorXd&, VectorXd&, const long) ;
+extern template void tridiagonalize<MatrixXf>(MatrixXf&, VectorXf&, VectorXf&, VectorXf&, const long) ;
+extern template void tridiagonalize<MatrixXcd>(MatrixXcd&, VectorXd&, VectorXd&, VectorXcd&, const long) ;
+extern template void apply_tridiagonal_q<MatrixXd>(const MatrixXd&, const VectorXd&, MatrixXd&, const long) ;
+extern template void apply_tridiagonal_q<MatrixXf>(const MatrixXf&, const VectorXf&, MatrixXf&, const long) ;
+extern template void apply_tridiagonal_q<MatrixXcd>(const MatrixXcd&, const VectorXcd&, MatrixXcd&, const long) ;
+extern template void divide_conquer_eigen<MatrixXd>(MatrixXd&, VectorXd&, MatrixXd&) ;
+extern template void divide_conquer_eigen<MatrixXf>(MatrixXf&, VectorXf&, MatrixXf&) ;
+extern template void divide_conquer_eigen<MatrixXcd>(MatrixXcd&, VectorXd&, MatrixXcd&) ;
+extern template void selfadjoint_eigen_inplace<MatrixXd>(MatrixXd&, VectorXd&, const bool) ;
+extern template void selfadjoint_eigen_inplace<MatrixXf>(MatrixXf&, VectorXf&, const bool) ;
+extern template void selfadjoint_eigen_inplace<MatrixXcd>(MatrixXcd&, VectorXd&, const bool) ;
+
+#endif //POD_EIGENSOLVERS_H
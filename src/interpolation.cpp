@@ -0,0 +1,133 @@
+//
+// Temporal interpolation of the POD coefficients (chronos).
+//
+
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+#include "interpolation.h"
+
+VectorXd times_to_vector(const std::vector<std::string> &t)
+{
+  VectorXd tv(t.size()) ;
+  for (size_t i = 0; i < t.size(); i++)
+    tv(i) = std::stod(t[i]) ;
+
+  return tv ;
+}
+
+bool is_uniform(const VectorXd &t, const double tol)
+{
+  if (t.size() < 3)
+    return true ;
+
+  const double dt((t(t.size() - 1) - t(0)) / (t.size() - 1)) ;
+  for (long i = 1; i < t.size(); i++)
+  {
+    if (std::fabs(t(i) - t(i - 1) - dt) > tol * std::fabs(dt))
+      return false ;
+  }
+
+  return true ;
+}
+
+/*
+Locate the interval [t(i), t(i+1)] holding x. Times outside the record are
+assigned to the first or last interval (extrapolation).
+*/
+static long find_interval(const VectorXd &t, const double x)
+{
+  const auto it(std::upper_bound(t.data(), t.data() + t.size(), x)) ;
+  long i(it - t.data() - 1) ;
+  return std::min(std::max(i, 0L), (long)t.size() - 2) ;
+}
+
+MatrixXd interpolate_cubic_spline(const VectorXd &t, const MatrixXd &c, const VectorXd &tOut)
+{
+  const long TSIZE(t.size()) ;
+  const long KSIZE(c.rows()) ;
+  MatrixXd cOut(KSIZE, tOut.size()) ;
+
+  if (TSIZE == 1)
+  {
+    cOut = c.col(0).replicate(1, tOut.size()) ;
+    return cOut ;
+  }
+
+  /* Second derivatives at the knots, with natural end conditions. The
+  tridiagonal system is solved with the Thomas algorithm, one column
+  (i.e. all modes at one knot) at a time. */
+  MatrixXd d2 = MatrixXd::Zero(KSIZE, TSIZE) ;
+  if (TSIZE > 2)
+  {
+    VectorXd h(t.tail(TSIZE - 1) - t.head(TSIZE - 1)) ;
+    VectorXd cp(TSIZE) ;
+
+    for (long i = 1; i < TSIZE - 1; i++)
+    {
+      const double diag(2. * (h(i - 1) + h(i)) - (i > 1 ? h(i - 1) * cp(i - 1) : 0.)) ;
+      cp(i) = h(i) / diag ;
+      d2.col(i) = 6. * ((c.col(i + 1) - c.col(i)) / h(i) - (c.col(i) - c.col(i - 1)) / h(i - 1)) ;
+      if (i > 1)
+        d2.col(i) -= h(i - 1) * d2.col(i - 1) ;
+      d2.col(i) /= diag ;
+    }
+
+    for (long i = TSIZE - 3; i > 0; i--)
+      d2.col(i) -= cp(i) * d2.col(i + 1) ;
+  }
+
+  for (long o = 0; o < tOut.size(); o++)
+  {
+    const long i(find_interval(t, tOut(o))) ;
+    const double h(t(i + 1) - t(i)) ;
+    const double a((t(i + 1) - tOut(o)) / h) ;
+    const double b(1. - a) ;
+    cOut.col(o) = a * c.col(i) + b * c.col(i + 1)
+                + ((a * a * a - a) * d2.col(i) + (b * b * b - b) * d2.col(i + 1)) * (h * h / 6.) ;
+  }
+
+  return cOut ;
+}
+
+MatrixXd interpolate_band_limited(const VectorXd &t, const MatrixXd &c, const VectorXd &tOut, const int a)
+{
+  const long TSIZE(t.size()) ;
+  MatrixXd cOut = MatrixXd::Zero(c.rows(), tOut.size()) ;
+
+  if (TSIZE == 1)
+  {
+    cOut = c.col(0).replicate(1, tOut.size()) ;
+    return cOut ;
+  }
+
+  const double dt((t(TSIZE - 1) - t(0)) / (TSIZE - 1)) ;
+
+  for (long o = 0; o < tOut.size(); o++)
+  {
+    /* Position of the output time in sample units */
+    const double x((tOut(o) - t(0)) / dt) ;
+    const long first(std::max((long)std::floor(x) - a + 1, 0L)) ;
+    const long last(std::min((long)std::floor(x) + a, TSIZE - 1)) ;
+
+    double wSum(0.) ;
+    for (long i = first; i <= last; i++)
+    {
+      const double u(x - i) ;
+      double w(1.) ;
+      if (std::fabs(u) > 1.e-12)
+      {
+        const double pu(M_PI * u) ;
+        w = a * std::sin(pu) * std::sin(pu / a) / (pu * pu) ;
+      }
+      cOut.col(o) += w * c.col(i) ;
+      wSum += w ;
+    }
+
+    if (std::fabs(wSum) > 1.e-12)
+      cOut.col(o) /= wSum ;
+  }
+
+  return cOut ;
+}
@@ -0,0 +1,46 @@
+//
+// Temporal interpolation of the POD coefficients (chronos).
+//
+
+#ifndef POD_INTERPOLATION_H
+#define POD_INTERPOLATION_H
+
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+
+using namespace Eigen;
+
+/*
+Interpolation schemes available for the temporal coefficients.
+*/
+enum InterpolationType {
+  INTERP_CUBIC_SPLINE = 1,  // Natural cubic spline, any time spacing
+  INTERP_BAND_LIMITED = 2   // Lanczos-windowed sinc, uniform time spacing only
+};
+
+/*
+Convert the entries of a time list (as read by read_timefile) to numbers.
+*/
+VectorXd times_to_vector(const std::vector<std::string> &t) ;
+
+/*
+Check whether the times are equally spaced (up to a relative tolerance).
+*/
+bool is_uniform(const VectorXd &t, const double tol = 1.e-3) ;
+
+/*
+Interpolate each row of c (sampled at the times t) at the times tOut using a
+natural cubic spline. The spline system only depends on t, so it is factored
+once and solved for all rows at the same time.
+*/
+MatrixXd interpolate_cubic_spline(const VectorXd &t, const MatrixXd &c, const VectorXd &tOut) ;
+
+/*
+Interpolate each row of c (sampled at the equally spaced times t) at the times
+tOut with a Lanczos-windowed sinc kernel of half-width a samples. Near the ends
+of the record the kernel weights are renormalised over the available samples.
+*/
+MatrixXd interpolate_band_limited(const VectorXd &t, const MatrixXd &c, const VectorXd &tOut, const int a = 8) ;
+
+#endif //POD_INTERPOLATION_H
@@ -0,0 +1,465 @@
+//
+// In-memory POD: snapshots, correlation matrix, basis and projections.
+//
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <omp.h>
+
+#include "libpod.h"
+#include "simd.h"
+
+/*
+c = op(a) b, op(a) (m x k) being a or its adjoint, for the blocks computed by
+the threads with the SIMD kernels (the denormals of floats being flushed).
+*/
+template <typename Scalar>
+static void block_product(const bool adjointA, const long m, const long n, const long k,
+                          const Scalar *a, const long lda, const Scalar *b, const long ldb,
+                          Scalar *c, const long ldc)
+{
+  const FlushDenormals flush(std::is_same<Scalar, float>::value) ;
+  gemm_kernel<Scalar>(simd_kernels())(adjointA, false, m, n, k, Scalar(1), a, lda, b, ldb, false, c, ldc) ;
+}
+
+// SNAPSHOT SOURCE
+
+template <typename Scalar>
+BasicSnapshotSource<Scalar>::BasicSnapshotSource() :
+m_owning(true),
+m_view(nullptr, 0, 0) {
+}
+
+template <typename Scalar>
+BasicSnapshotSource<Scalar>::BasicSnapshotSource(const long rows) :
+m_owned(rows, 0),
+m_owning(true),
+m_view(nullptr, rows, 0) {
+}
+
+template <typename Scalar>
+BasicSnapshotSource<Scalar>::BasicSnapshotSource(const Scalar *data, const long rows, const long cols) :
+m_owning(false),
+m_view(data, rows, cols) {
+}
+
+template <typename Scalar>
+BasicSnapshotSource<Scalar>::BasicSnapshotSource(const BasicSnapshotSource &other) :
+m_owned(other.m_owned),
+m_owning(other.m_owning),
+m_view(nullptr, 0, 0) {
+  remap(m_owning ? m_owned.data() : other.m_view.data(), other.rows(), other.size()) ;
+}
+
+/* Moving an owned matrix keeps its data, the view stays valid */
+template <typename Scalar>
+BasicSnapshotSource<Scalar>::BasicSnapshotSource(BasicSnapshotSource &&other) :
+m_owned(std::move(other.m_owned)),
+m_owning(other.m_owning),
+m_view(other.m_view.data(), other.rows(), other.size()) {
+  other.remap(nullptr, other.rows(), 0) ;
+}
+
+template <typename Scalar>
+BasicSnapshotSource<Scalar> &BasicSnapshotSource<Scalar>::operator=(const BasicSnapshotSource &other)
+{
+  if (this != &other)
+  {
+    m_owned = other.m_owned ;
+    m_owning = other.m_owning ;
+    remap(m_owning ? m_owned.data() : other.m_view.data(), other.rows(), other.size()) ;
+  }
+  return *this ;
+}
+
+template <typename Scalar>
+BasicSnapshotSource<Scalar> &BasicSnapshotSource<Scalar>::operator=(BasicSnapshotSource &&other)
+{
+  if (this != &other)
+  {
+    m_owned.swap(other.m_owned) ;
+    m_owning = other.m_owning ;
+    remap(other.m_view.data(), other.rows(), other.size()) ;
+    other.remap(nullptr, other.rows(), 0) ;
+  }
+  return *this ;
+}
+
+template <typename Scalar>
+BasicSnapshotSource<Scalar> BasicSnapshotSource<Scalar>::read(const std::vector<std::string> &pcfs,
+                                                              const long varSize,
+                                                              const long offset,
+                                                              const int layout)
+{
+  BasicSnapshotSource source ;
+  read_pcfs_to_matrix(&source.m_owned, &pcfs, varSize, offset, layout) ;
+  source.remap(source.m_owned.data(), source.m_owned.rows(), source.m_owned.cols()) ;
+  return source ;
+}
+
+template <typename Scalar>
+void BasicSnapshotSource<Scalar>::append(const Ref<const ScalarMatrix<Scalar>> &columns)
+{
+  if (!m_owning)
+    throw "Cannot append to snapshots mapped from caller memory" ;
+  if (columns.rows() != rows() && size() > 0)
+    throw "Appended snapshots differ in size" ;
+
+  const long rowsSize(columns.rows()) ;
+  const long newSize(size() + columns.cols()) ;
+  if (m_owned.rows() != rowsSize || newSize > m_owned.cols())
+    m_owned.conservativeResize(rowsSize, std::max(newSize, 2 * m_owned.cols())) ;
+
+  m_owned.middleCols(size(), columns.cols()) = columns ;
+  remap(m_owned.data(), rowsSize, newSize) ;
+}
+
+template <typename Scalar>
+void BasicSnapshotSource<Scalar>::append(const Scalar *column)
+{
+  append(Map<const Matrix<Scalar, Dynamic, 1>>(column, rows())) ;
+}
+
+template <typename Scalar>
+void BasicSnapshotSource<Scalar>::remap(const Scalar *data, const long rows, const long cols)
+{
+  /* Re-seating a Map (Eigen documents placement new for this) */
+  new (&m_view) Map<const ScalarMatrix<Scalar>>(data, rows, cols) ;
+}
+
+// GRAM ACCUMULATOR
+
+template <typename Scalar>
+BasicGramAccumulator<Scalar>::BasicGramAccumulator() :
+m_size(0) {
+}
+
+template <typename Scalar>
+void BasicGramAccumulator<Scalar>::update(const BasicSnapshotSource<Scalar> &source)
+{
+  const auto &m(source.matrix()) ;
+  const long newSize(source.size()) ;
+  if (newSize <= m_size)
+    return ;
+
+  if (newSize > m_gram.rows())
+  {
+    const long capacity(std::max(newSize, 2 * (long)m_gram.rows())) ;
+    ScalarMatrix<Scalar> grown(capacity, capacity) ;
+    grown.topLeftCorner(m_size, m_size) = m_gram.topLeftCorner(m_size, m_size) ;
+    m_gram.swap(grown) ;
+  }
+
+  /* New rows of the lower triangle, by block columns (longest first) */
+  const long rowsSize(m.rows()) ;
+  const long blockSize(64) ;
+  const long blocksSize((newSize + blockSize - 1) / blockSize) ;
+#pragma omp parallel for schedule(dynamic)
+  for (long b = 0; b < blocksSize; b++)
+  {
+    const long j0(b * blockSize) ;
+    const long cols(std::min(blockSize, newSize - j0)) ;
+    const long r0(std::max(m_size, j0)) ;
+    block_product(true, newSize - r0, cols, rowsSize,
+                  m.data() + r0 * rowsSize, rowsSize, m.data() + j0 * rowsSize, rowsSize,
+                  m_gram.data() + r0 + j0 * m_gram.rows(), m_gram.rows()) ;
+  }
+
+  m_size = newSize ;
+}
+
+template <typename Scalar>
+ScalarMatrix<Scalar> BasicGramAccumulator<Scalar>::correlation() const
+{
+  typedef typename NumTraits<Scalar>::Real Real ;
+  ScalarMatrix<Scalar> pm(m_gram.topLeftCorner(m_size, m_size)) ;
+  pm.template triangularView<Lower>() *= Real(1.0 / m_size) ;
+  symmetrize_lower(pm) ;
+  return pm ;
+}
+
+template <typename Scalar>
+void BasicGramAccumulator<Scalar>::release(ScalarMatrix<Scalar> &pm)
+{
+  typedef typename NumTraits<Scalar>::Real Real ;
+  if (m_gram.rows() != m_size)
+    m_gram.conservativeResize(m_size, m_size) ;
+  pm.swap(m_gram) ;
+  m_gram.resize(0, 0) ;
+
+  pm.template triangularView<Lower>() *= Real(1.0 / m_size) ;
+  symmetrize_lower(pm) ;
+  m_size = 0 ;
+}
+
+// EIGEN-DECOMPOSITION
+
+template <typename Scalar>
+double pod_eigen(ScalarMatrix<Scalar> &a, const int eigSolver, const long nev, const double targetRic,
+                 const double baseMemory, Matrix<typename NumTraits<Scalar>::Real, Dynamic, 1> &eigval,
+                 ScalarMatrix<Scalar> &eigvec)
+{
+  const FlushDenormals flush(std::is_same<Scalar, float>::value) ;
+  const long nSize(a.rows()) ;
+  /* With a partial solve, the sum of all eigenvalues is the trace */
+  double eigValSum(numext::real(a.trace())) ;
+  bool solved(false) ;
+
+  if (eigSolver == EIG_LANCZOS)
+  {
+    solved = lanczos_eigen(a, nev, targetRic, eigValSum, eigval, eigvec) ;
+    if (library_verbose() && solved)
+      std::cout << "Lanczos solver converged " << eigval.size() << " eigenpairs." << std::endl;
+    else if (library_verbose())
+      std::cout << "Lanczos solver did not converge or missed a repeated eigenvalue, falling back to the full solver."
+                << std::endl;
+  }
+
+  /* a is not needed after the solve and is overwritten */
+  if (eigSolver == EIG_DIVIDE_CONQUER)
+    divide_conquer_eigen(a, eigval, eigvec) ;
+  else if (!solved)
+  {
+    selfadjoint_eigen_inplace(a, eigval) ;
+    eigvec.swap(a) ;
+  }
+  a.resize(0, 0) ;
+
+  if (baseMemory > 0. && library_verbose())
+    std::cout << "Peak memory of the correlation and eigen stages: " << peak_memory_mb() - baseMemory
+              << " MB above the snapshots ("
+              << (peak_memory_mb() - baseMemory) * 1024. * 1024. / ((double)sizeof(Scalar) * nSize * nSize)
+              << " matrices of order " << nSize << ")." << std::endl;
+
+  if (!solved)
+  {
+    eigValSum = 0. ;
+    for(auto i(0) ; i < eigval.size() ; ++i) {
+      eigValSum += std::fabs(eigval(i)) ;
+    }
+  }
+
+  return eigValSum ;
+}
+
+// POD BASIS
+
+template <typename Scalar>
+BasicPodBasis<Scalar>::BasicPodBasis() :
+m_podSize(0),
+m_timesSize(0),
+m_trace(0.) {
+}
+
+template <typename Scalar>
+BasicPodBasis<Scalar>::BasicPodBasis(ScalarMatrix<Scalar> &pm, const int podSize, const double targetRic,
+                                     const int eigSolver, const double baseMemory) :
+m_podSize(0),
+m_timesSize(pm.rows()),
+m_trace(0.) {
+  typedef typename NumTraits<Scalar>::Real Real ;
+  m_trace = pod_eigen<Scalar>(pm, eigSolver, podSize, targetRic, baseMemory, m_eigval, m_eigvec) ;
+  m_podSize = ric_pod_size(m_eigval.reverse(), m_trace, targetRic, podSize) ;
+
+  /* phi_i = M v_i / sqrt(lambda_i T) */
+  m_weights = m_eigvec.rowwise().reverse().leftCols(m_podSize)
+              * (m_eigval.reverse().head(m_podSize) * Real(m_timesSize)).array().rsqrt().matrix().asDiagonal() ;
+}
+
+template <typename Scalar>
+typename BasicPodBasis<Scalar>::RealVector BasicPodBasis<Scalar>::eigenvalues() const
+{
+  return m_eigval.reverse() ;
+}
+
+template <typename Scalar>
+ScalarMatrix<Scalar> BasicPodBasis<Scalar>::chronos(const long rank) const
+{
+  typedef typename NumTraits<Scalar>::Real Real ;
+  /* chronos(i, j) = sqrt(lambda_i T) conj(v_ji) */
+  return (m_eigval.reverse().head(rank).array().max(Real(0)) * Real(m_timesSize)).sqrt().matrix().asDiagonal()
+         * m_eigvec.rowwise().reverse().leftCols(rank).adjoint() ;
+}
+
+template <typename Scalar>
+ScalarMatrix<Scalar> BasicPodBasis<Scalar>::weights() const
+{
+  return m_weights ;
+}
+
+template <typename Scalar>
+void BasicPodBasis<Scalar>::mode_rows(const BasicSnapshotSource<Scalar> &source, const long first, const long rows,
+                                      ScalarMatrix<Scalar> &out) const
+{
+  out.resize(rows, m_podSize) ;
+  mode_rows(source, first, rows, Ref<ScalarMatrix<Scalar>>(out)) ;
+}
+
+template <typename Scalar>
+void BasicPodBasis<Scalar>::mode_rows(const BasicSnapshotSource<Scalar> &source, const long first, const long rows,
+                                      Ref<ScalarMatrix<Scalar>> out) const
+{
+  const auto &m(source.matrix()) ;
+  if (out.rows() != rows || out.cols() != m_podSize)
+    throw "Mode block size differs from the requested rows and the POD size" ;
+
+  /* Rows are split over the threads, independently of the number of modes */
+  const long chunkSize(256) ;
+#pragma omp parallel for schedule(dynamic)
+  for (long r0 = 0; r0 < rows; r0 += chunkSize)
+  {
+    const long chunk(std::min(chunkSize, rows - r0)) ;
+    block_product(false, chunk, m_podSize, m_weights.rows(),
+                  m.data() + first + r0, m.rows(), m_weights.data(), m_weights.rows(),
+                  out.data() + r0, out.outerStride()) ;
+  }
+}
+
+template <typename Scalar>
+ScalarMatrix<Scalar> BasicPodBasis<Scalar>::modes(const BasicSnapshotSource<Scalar> &source) const
+{
+  ScalarMatrix<Scalar> phi ;
+  mode_rows(source, 0, source.rows(), phi) ;
+  return phi ;
+}
+
+template <typename Scalar>
+void BasicPodBasis<Scalar>::write(const BasicSnapshotSource<Scalar> &source, const std::string &chronosDir,
+                                  const std::string &modeDir, const long varSize, const int layout) const
+{
+  const int scalar(scalar_type_of<Scalar>()) ;
+  write_eigenvalues(chronosDir, eigenvalues().template cast<double>(), m_timesSize, m_trace) ;
+
+  /* Chronos of another scalar type are described, for the readers of doubles to refuse them */
+  const ScalarMatrix<Scalar> c(chronos()) ;
+  std::ofstream writeChronos(chronosDir + "/chronos.bin", std::ios::binary) ;
+  if (writeChronos.is_open()) {
+    writeChronos.write(reinterpret_cast<const char*>(c.data()), c.size() * sizeof(Scalar)) ;
+    writeChronos.close() ;
+  }
+  if (scalar != SCALAR_DOUBLE)
+    write_matrix_info(chronosDir + "/chronos.bin", c.rows(), c.cols(), 1, LAYOUT_BLOCKED, scalar) ;
+
+  const ScalarMatrix<Scalar> phi(modes(source)) ;
+  std::ofstream writeModes(modeDir + "/mode.bin", std::ios::binary) ;
+  if (writeModes.is_open()) {
+    writeModes.write(reinterpret_cast<const char*>(phi.data()), phi.size() * sizeof(Scalar)) ;
+    writeModes.close() ;
+  }
+  write_matrix_info(modeDir + "/mode.bin", phi.rows(), phi.cols(), varSize, layout, scalar) ;
+}
+
+// PROJECTOR
+
+template <typename Scalar>
+BasicProjector<Scalar>::BasicProjector(const Scalar *modes, const long rows, const long cols) :
+m_modes(modes, rows, cols) {
+}
+
+template <typename Scalar>
+BasicProjector<Scalar>::BasicProjector(const ScalarMatrix<Scalar> &modes) :
+m_modes(modes.data(), modes.rows(), modes.cols()) {
+}
+
+template <typename Scalar>
+ScalarMatrix<Scalar> BasicProjector<Scalar>::coefficients(const Ref<const ScalarMatrix<Scalar>> &snapshots) const
+{
+  ScalarMatrix<Scalar> c(m_modes.cols(), snapshots.cols()) ;
+  coefficients(snapshots, c) ;
+  return c ;
+}
+
+template <typename Scalar>
+void BasicProjector<Scalar>::coefficients(const Ref<const ScalarMatrix<Scalar>> &snapshots,
+                                          Ref<ScalarMatrix<Scalar>> c) const
+{
+  const long colsSize(snapshots.cols()) ;
+  if (snapshots.rows() != m_modes.rows() || c.rows() != m_modes.cols() || c.cols() != colsSize)
+    throw "Snapshot or coefficient sizes differ from the modes" ;
+
+  /* Snapshots split over the threads */
+  const long chunkSize(16) ;
+#pragma omp parallel for schedule(dynamic)
+  for (long c0 = 0; c0 < colsSize; c0 += chunkSize)
+  {
+    const long chunk(std::min(chunkSize, colsSize - c0)) ;
+    block_product(true, m_modes.cols(), chunk, m_modes.rows(),
+                  m_modes.data(), m_modes.rows(), snapshots.data() + c0 * snapshots.outerStride(),
+                  snapshots.outerStride(), c.data() + c0 * c.outerStride(), c.outerStride()) ;
+  }
+}
+
+template <typename Scalar>
+ScalarMatrix<Scalar> BasicProjector<Scalar>::reconstruct(const Ref<const ScalarMatrix<Scalar>> &coeffs) const
+{
+  ScalarMatrix<Scalar> fields(m_modes.rows(), coeffs.cols()) ;
+  reconstruct(coeffs, fields) ;
+  return fields ;
+}
+
+template <typename Scalar>
+void BasicProjector<Scalar>::reconstruct(const Ref<const ScalarMatrix<Scalar>> &coeffs,
+                                         Ref<ScalarMatrix<Scalar>> fields) const
+{
+  const long rowsSize(m_modes.rows()) ;
+  if (coeffs.rows() != m_modes.cols() || fields.rows() != rowsSize || fields.cols() != coeffs.cols())
+    throw "Coefficient or field sizes differ from the modes" ;
+
+  const long chunkSize(256) ;
+#pragma omp parallel for schedule(dynamic)
+  for (long r0 = 0; r0 < rowsSize; r0 += chunkSize)
+  {
+    const long chunk(std::min(chunkSize, rowsSize - r0)) ;
+    block_product(false, chunk, coeffs.cols(), m_modes.cols(),
+                  m_modes.data() + r0, rowsSize, coeffs.data(), coeffs.outerStride(),
+                  fields.data() + r0, fields.outerStride()) ;
+  }
+}
+
+template <typename Scalar>
+ScalarMatrix<Scalar> BasicProjector<Scalar>::gram() const
+{
+  const long colsSize(m_modes.cols()) ;
+  ScalarMatrix<Scalar> g(colsSize, colsSize) ;
+  coefficients(m_modes, g) ;
+  return g ;
+}
+
+template <typename Scalar>
+VectorXd BasicProjector<Scalar>::residuals(const Ref<const ScalarMatrix<Scalar>> &snapshots,
+                                           const Ref<const ScalarMatrix<Scalar>> &coeffs,
+                                           const Ref<const ScalarMatrix<Scalar>> &gram) const
+{
+  const long modesSize(m_modes.cols()) ;
+  if (snapshots.cols() != coeffs.cols() || coeffs.rows() != modesSize)
+    throw "Snapshot or coefficient sizes differ from the modes" ;
+  if (gram.rows() < modesSize || gram.cols() < modesSize)
+    throw "Gram matrix smaller than the number of modes" ;
+
+  VectorXd residuals(snapshots.cols()) ;
+  for (long j = 0; j < snapshots.cols(); j++)
+  {
+    const double norm2(snapshots.col(j).squaredNorm()) ;
+    const auto c(coeffs.col(j)) ;
+    const double residual2(norm2 - 2. * c.squaredNorm()
+                           + numext::real(c.dot(gram.topLeftCorner(modesSize, modesSize) * c))) ;
+    residuals(j) = norm2 > 0. ? std::sqrt(std::max(residual2, 0.) / norm2) : 0. ;
+  }
+  return residuals ;
+}
+
+// EXPLICIT INSTANTIATIONS
+
+#define POD_INSTANTIATE_LIBPOD(Scalar) \
+  template class BasicSnapshotSource<Scalar> ; \
+  template class BasicGramAccumulator<Scalar> ; \
+  template double pod_eigen<Scalar>(ScalarMatrix<Scalar>&, const int, const long, const double, const double, \
+                                    Matrix<NumTraits<Scalar>::Real, Dynamic, 1>&, ScalarMatrix<Scalar>&) ; \
+  template class BasicPodBasis<Scalar> ; \
+  template class BasicProjector<Scalar> ;
+
+POD_INSTANTIATE_LIBPOD(float)
+POD_INSTANTIATE_LIBPOD(double)
+POD_INSTANTIATE_LIBPOD(std::complex<double>)
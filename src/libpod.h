@@ -0,0 +1,275 @@
+//
+// In-memory POD: snapshots, correlation matrix, basis and projections.
+//
+
+#ifndef POD_LIBPOD_H
+#define POD_LIBPOD_H
+
+#include <complex>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+
+#include "utils.h"
+#include "eigensolvers.h"
+
+using namespace Eigen;
+
+/*
+The classes are templated on the Scalar of the snapshots and instantiated for
+float, double and std::complex<double> (-scalar); SnapshotSource,
+GramAccumulator, PodBasis and Projector are the double ones. With complex
+snapshots the correlation matrix is Hermitian, its eigenvalues real, and the
+transposes of the real case are adjoints.
+*/
+
+/*
+Snapshot columns of rows values. The columns are either caller-owned memory,
+mapped without copy (all the snapshots in one column-major buffer, e.g. the
+history kept by a solver or a buffer shared with another process), or owned
+by the source: read from point cloud files, or appended one time step after
+the other by a solver overwriting its own field buffer. Appending grows the
+storage geometrically, so that a run of T steps copies every column once on
+average.
+*/
+template <typename Scalar>
+class BasicSnapshotSource {
+public:
+  BasicSnapshotSource() ;
+
+  /*
+  Empty source owning its columns, to be filled by append().
+  */
+  explicit BasicSnapshotSource(const long rows) ;
+
+  /*
+  View of cols caller-owned columns, which must outlive the source.
+  */
+  BasicSnapshotSource(const Scalar *data, const long rows, const long cols) ;
+
+  BasicSnapshotSource(const BasicSnapshotSource &other) ;
+  BasicSnapshotSource(BasicSnapshotSource &&other) ;
+  BasicSnapshotSource &operator=(const BasicSnapshotSource &other) ;
+  BasicSnapshotSource &operator=(BasicSnapshotSource &&other) ;
+
+  /*
+  Source owning the snapshots read from the point cloud files (varSize
+  complex values per point taking two columns each).
+  */
+  static BasicSnapshotSource read(const std::vector<std::string> &pcfs,
+                                  const long varSize,
+                                  const long offset,
+                                  const int layout = LAYOUT_BLOCKED) ;
+
+  /*
+  Copy one or several columns at the end of an owned source.
+  */
+  void append(const Ref<const ScalarMatrix<Scalar>> &columns) ;
+  void append(const Scalar *column) ;
+
+  long rows() const { return m_view.rows() ; }
+  long size() const { return m_view.cols() ; }
+
+  /*
+  All the snapshots, without copy.
+  */
+  const Map<const ScalarMatrix<Scalar>> &matrix() const { return m_view ; }
+
+private:
+  void remap(const Scalar *data, const long rows, const long cols) ;
+
+  ScalarMatrix<Scalar> m_owned ;
+  bool m_owning ;
+  Map<const ScalarMatrix<Scalar>> m_view ;
+} ;
+
+/*
+Correlation matrix m^H m / T of a growing snapshot source. update() computes
+the products of the columns added since the last update with all the
+columns, block by block over the threads, so that a solver can append a
+snapshot and update every time step for O(N T) work. Only the lower triangle
+is accumulated until the matrix is released.
+*/
+template <typename Scalar>
+class BasicGramAccumulator {
+public:
+  BasicGramAccumulator() ;
+
+  void update(const BasicSnapshotSource<Scalar> &source) ;
+
+  /*
+  Number of snapshots accumulated.
+  */
+  long size() const { return m_size ; }
+
+  /*
+  Normalised correlation matrix (copy).
+  */
+  ScalarMatrix<Scalar> correlation() const ;
+
+  /*
+  Move the normalised correlation matrix to pm without copy, the accumulator
+  being reset.
+  */
+  void release(ScalarMatrix<Scalar> &pm) ;
+
+private:
+  ScalarMatrix<Scalar> m_gram ;
+  long m_size ;
+} ;
+
+/*
+Sorted eigenpairs (ascending, as the solvers) of the Hermitian matrix a with
+the given solver (EigenSolverType), a being overwritten and released. nev and
+targetRic bound the eigenpairs computed by Lanczos. Returns the sum of the
+absolute values of all the eigenvalues. The peak memory is reported above
+baseMemory (MB), if given.
+*/
+template <typename Scalar>
+double pod_eigen(ScalarMatrix<Scalar> &a, const int eigSolver, const long nev, const double targetRic,
+                 const double baseMemory, Matrix<typename NumTraits<Scalar>::Real, Dynamic, 1> &eigval,
+                 ScalarMatrix<Scalar> &eigvec) ;
+
+/*
+POD basis from the correlation matrix of T snapshots: eigenvalues, chronos
+and the weights W = V Lambda^-1/2 / sqrt(T) that give the modes Phi = M W.
+The number of modes is the smallest reaching targetRic, and at most podSize.
+*/
+template <typename Scalar>
+class BasicPodBasis {
+public:
+  typedef Matrix<typename NumTraits<Scalar>::Real, Dynamic, 1> RealVector ;
+
+  BasicPodBasis() ;
+
+  /*
+  Decompose pm (consumed) with the given solver (EigenSolverType).
+  */
+  BasicPodBasis(ScalarMatrix<Scalar> &pm, const int podSize, const double targetRic,
+                const int eigSolver = EIG_FULL, const double baseMemory = 0.) ;
+
+  int size() const { return m_podSize ; }
+  long times() const { return m_timesSize ; }
+
+  /*
+  Sum of all the eigenvalues, also those a partial solve did not compute.
+  */
+  double trace() const { return m_trace ; }
+
+  /*
+  All the computed eigenvalues, in descending order.
+  */
+  RealVector eigenvalues() const ;
+
+  /*
+  Chronos of the modes (modes x times): sqrt(lambda_i T) conj(v_ji).
+  */
+  ScalarMatrix<Scalar> chronos() const { return chronos(m_podSize) ; }
+
+  /*
+  Coefficients of the snapshots on the first rank modes.
+  */
+  ScalarMatrix<Scalar> chronos(const long rank) const ;
+
+  /*
+  Weights of the snapshots in every mode (times x modes).
+  */
+  ScalarMatrix<Scalar> weights() const ;
+
+  /*
+  Rows first..first+rows-1 of the modes, rows split over the threads.
+  */
+  void mode_rows(const BasicSnapshotSource<Scalar> &source, const long first, const long rows,
+                 ScalarMatrix<Scalar> &out) const ;
+
+  /*
+  Same, in a caller-sized block (rows x modes), e.g. mapped caller memory.
+  */
+  void mode_rows(const BasicSnapshotSource<Scalar> &source, const long first, const long rows,
+                 Ref<ScalarMatrix<Scalar>> out) const ;
+
+  /*
+  All the modes (rows x modes).
+  */
+  ScalarMatrix<Scalar> modes(const BasicSnapshotSource<Scalar> &source) const ;
+
+  /*
+  Write eigenValues.bin (doubles), chronos.bin and mode.bin (Scalar, with
+  their descriptions) as POD does.
+  */
+  void write(const BasicSnapshotSource<Scalar> &source, const std::string &chronosDir, const std::string &modeDir,
+             const long varSize, const int layout = LAYOUT_BLOCKED) const ;
+
+private:
+  RealVector m_eigval ;
+  ScalarMatrix<Scalar> m_eigvec ;
+  ScalarMatrix<Scalar> m_weights ;
+  int m_podSize ;
+  long m_timesSize ;
+  double m_trace ;
+} ;
+
+/*
+Projection on modes (rows x modes), mapped without copy: the coefficients
+Phi^H x of snapshots and the fields Phi c reconstructed from coefficients,
+rows split over the threads. The results are returned, or written in
+caller-sized blocks.
+*/
+template <typename Scalar>
+class BasicProjector {
+public:
+  BasicProjector(const Scalar *modes, const long rows, const long cols) ;
+  explicit BasicProjector(const ScalarMatrix<Scalar> &modes) ;
+
+  /*
+  Coefficients (modes x snapshots) of the given snapshot columns.
+  */
+  ScalarMatrix<Scalar> coefficients(const Ref<const ScalarMatrix<Scalar>> &snapshots) const ;
+  void coefficients(const Ref<const ScalarMatrix<Scalar>> &snapshots, Ref<ScalarMatrix<Scalar>> c) const ;
+
+  /*
+  Fields (rows x columns) from coefficients (modes x columns).
+  */
+  ScalarMatrix<Scalar> reconstruct(const Ref<const ScalarMatrix<Scalar>> &coeffs) const ;
+  void reconstruct(const Ref<const ScalarMatrix<Scalar>> &coeffs, Ref<ScalarMatrix<Scalar>> fields) const ;
+
+  /*
+  Gram matrix Phi^H Phi of the modes, the identity for POD modes but not for
+  SPOD modes.
+  */
+  ScalarMatrix<Scalar> gram() const ;
+
+  /*
+  Relative residuals |x - Phi c| / |x| of the snapshot columns given their
+  coefficients c = Phi^H x, from |x|^2 - 2 |c|^2 + c^H G c, gram being at
+  least modes x modes (its leading block is used).
+  */
+  VectorXd residuals(const Ref<const ScalarMatrix<Scalar>> &snapshots, const Ref<const ScalarMatrix<Scalar>> &coeffs,
+                     const Ref<const ScalarMatrix<Scalar>> &gram) const ;
+
+  long rows() const { return m_modes.rows() ; }
+  long size() const { return m_modes.cols() ; }
+
+private:
+  Map<const ScalarMatrix<Scalar>> m_modes ;
+} ;
+
+typedef BasicSnapshotSource<double> SnapshotSource ;
+typedef BasicGramAccumulator<double> GramAccumulator ;
+typedef BasicPodBasis<double> PodBasis ;
+typedef BasicProjector<double> Projector ;
+
+extern template class BasicSnapshotSource<float> ;
+extern template class BasicSnapshotSource<double> ;
+extern template class BasicSnapshotSource<std::complex<double>> ;
+extern template class BasicGramAccumulator<float> ;
+extern template class BasicGramAccumulator<double> ;
+extern template class BasicGramAccumulator<std::complex<double>> ;
+extern template class BasicPodBasis<float> ;
+extern template class BasicPodBasis<double> ;
+extern template class BasicPodBasis<std::complex<double>> ;
+extern template class BasicProjector<float> ;
+extern template class BasicProjector<double> ;
+extern template class BasicProjector<std::complex<double>> ;
+
+#endif //POD_LIBPOD_H
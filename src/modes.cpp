@@ -0,0 +1,332 @@
+//
+// On-demand computation of POD modes from the snapshots referenced by POD -lazy.
+//
+
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <Eigen/Dense>
+#include "ezOptionParser.hpp"
+#include <omp.h>
+#include <sys/stat.h>
+
+#include "utils.h"
+#include "simd.h"
+
+/*
+Compute the requested modes (all of them by default) at the requested points
+(all of them by default) as Scalar values, the type of the chronos. Modes
+already computed are read from modeDir/cache/mode.<i>.bin; the others are
+computed in a single streaming pass over the snapshot files,
+phi_i = M v_i / sqrt(lambda_i T) = M c_i^H / (lambda_i T) with c_i the chronos,
+and added to the cache.
+*/
+template <typename Scalar>
+static void modes_scalar(Parameters &params, const ModeSource &source)
+{
+  const long TSIZE(source.times) ;
+  const long MVSIZE(source.rows) ;
+  const long pointSize(MVSIZE / source.varSize) ;
+
+  std::vector<int> indices(params.m_modeIndices) ;
+  if (indices.empty())
+  {
+    for (int i = 0; i < source.modes; i++)
+      indices.push_back(i) ;
+  }
+  for (auto i : indices)
+  {
+    if (i < 0 || i >= source.modes)
+      throw "Mode index out of range" ;
+  }
+
+  // READING EIGENVALUES AND CHRONOS
+
+  MatrixXd eigval(read_binary_matrix(source.chronosDirName + "/eigenValues.bin", 1)) ;
+  ScalarMatrix<Scalar> chronos(read_binary_matrix<Scalar>(source.chronosDirName + "/chronos.bin", source.modes)) ;
+
+  // CACHE
+
+  /* A cache filled for another POD run is discarded */
+  const std::string cacheDir(params.m_modeDirName + "/cache") ;
+  auto cacheName = [&](const int i) { return cacheDir + "/mode." + std::to_string(i) + ".bin" ; } ;
+  const std::string sourceName(params.m_modeDirName + "/modeSource.info") ;
+  const std::string cachedSourceName(cacheDir + "/modeSource.info") ;
+  if (std::filesystem::exists(cachedSourceName)
+      && std::filesystem::last_write_time(cachedSourceName) < std::filesystem::last_write_time(sourceName))
+    std::filesystem::remove_all(cacheDir) ;
+  if (!std::filesystem::exists(cacheDir))
+  {
+    std::filesystem::create_directories(cacheDir) ;
+    std::filesystem::copy_file(sourceName, cachedSourceName) ;
+  }
+
+  /* An entry counts only if complete, a run killed mid-write leaves at most
+  a temporary file behind */
+  const std::uintmax_t entrySize(MVSIZE * sizeof(Scalar)) ;
+  auto cached = [&](const int i) {
+    std::error_code ec ;
+    return std::filesystem::file_size(cacheName(i), ec) == entrySize && !ec ;
+  } ;
+  std::vector<int> missing ;
+  for (auto i : indices)
+  {
+    if (!cached(i) && std::find(missing.begin(), missing.end(), i) == missing.end())
+      missing.push_back(i) ;
+  }
+  std::cout << indices.size() - missing.size() << " of " << indices.size() << " modes found in the cache. " << std::endl ;
+
+  // COMPUTING MISSING MODES IN ONE PASS
+
+  if (!missing.empty())
+  {
+    double start(omp_get_wtime()) ;
+    std::cout << "Computing " << missing.size() << " modes from " << TSIZE << " snapshots..." << std::flush ;
+
+    std::vector<std::string> t(read_timefile(source.timesFileName)) ;
+    std::vector<std::string> pcfs ;
+    for (auto &time : t)
+      pcfs.push_back(source.inputDirName + "/" + time + "/" + source.dataFileName) ;
+
+    ScalarMatrix<Scalar> w(TSIZE, missing.size()) ;
+    for (size_t k = 0; k < missing.size(); k++)
+      w.col(k) = chronos.row(missing[k]).adjoint() / (eigval(missing[k]) * TSIZE) ;
+
+    ScalarMatrix<Scalar> pod(ScalarMatrix<Scalar>::Zero(MVSIZE, missing.size())) ;
+    const long batchSize(std::max(4L * params.m_threadsSize, 16L)) ;
+    stream_snapshots<Scalar>(pcfs, pointSize, source.varSize, source.offset, source.layout, batchSize,
+                     [&](const long first, const Ref<const ScalarMatrix<Scalar>> &b) {
+      /* Rows are split over the threads */
+      const long chunkSize(256) ;
+#pragma omp parallel
+      {
+        const FlushDenormals flush(std::is_same<Scalar, float>::value) ;
+#pragma omp for schedule(dynamic)
+        for (long r0 = 0; r0 < MVSIZE; r0 += chunkSize)
+        {
+          const long chunk(std::min(chunkSize, MVSIZE - r0)) ;
+          pod.middleRows(r0, chunk).noalias() += b.middleRows(r0, chunk) * w.middleRows(first, b.cols()) ;
+        }
+      }
+    }) ;
+
+    /* Each entry is written under a temporary name and renamed into place */
+    for (size_t k = 0; k < missing.size(); k++)
+    {
+      const std::string tmpName(cacheName(missing[k]) + ".tmp") ;
+      std::ofstream writeCache(tmpName, std::ios::binary) ;
+      if (writeCache.is_open()) {
+        writeCache.write(reinterpret_cast<const char*>(pod.col(k).data()), MVSIZE * sizeof(Scalar)) ;
+        writeCache.close() ;
+      }
+      std::error_code ec ;
+      if (writeCache)
+        std::filesystem::rename(tmpName, cacheName(missing[k]), ec) ;
+      if (!writeCache || ec)
+        throw "Cannot write the mode cache" ;
+    }
+
+    double end(omp_get_wtime()) ;
+    std::cout << "\t\t Done in " << end - start << "s \n" << std::endl ;
+  }
+
+  // SELECTING POINTS AND WRITING
+
+  std::vector<long> rows ;
+  long selPointSize(pointSize) ;
+  if (!params.m_pointIndicesFileName.empty())
+  {
+    std::vector<std::string> lines(read_timefile(params.m_pointIndicesFileName)) ;
+    std::vector<long> points ;
+    for (auto &line : lines)
+    {
+      if (!line.empty())
+        points.push_back(std::stol(line)) ;
+    }
+    selPointSize = points.size() ;
+    rows.resize(selPointSize * source.varSize) ;
+    for (long p = 0; p < selPointSize; p++)
+    {
+      if (points[p] < 0 || points[p] >= pointSize)
+        throw "Point index out of range" ;
+      for (long j = 0; j < source.varSize; j++)
+        rows[layout_row(source.layout, p, j, selPointSize, source.varSize)]
+          = layout_row(source.layout, points[p], j, pointSize, source.varSize) ;
+    }
+  }
+
+  const long selRowsSize(rows.empty() ? MVSIZE : rows.size()) ;
+  ScalarMatrix<Scalar> selection(selRowsSize, indices.size()) ;
+  ScalarMatrix<Scalar> mode(MVSIZE, 1) ;
+  for (size_t k = 0; k < indices.size(); k++)
+  {
+    std::ifstream readCache(cacheName(indices[k]), std::ios::binary) ;
+    if (!readCache.read(reinterpret_cast<char*>(mode.data()), MVSIZE * sizeof(Scalar)))
+      throw "Mode cache entry missing or truncated" ;
+    if (rows.empty())
+      selection.col(k) = mode ;
+    else
+      for (long r = 0; r < selRowsSize; r++)
+        selection(r, k) = mode(rows[r]) ;
+  }
+
+  /* All the modes at all the points make a regular mode file */
+  std::string outName(params.m_outFileName) ;
+  if (outName.empty())
+    outName = params.m_modeDirName + (params.m_modeIndices.empty() && rows.empty() ? "/mode.bin" : "/modeSelection.bin") ;
+
+  std::ofstream writeMode(outName, std::ios::binary) ;
+  if (writeMode.is_open()) {
+    writeMode.write(reinterpret_cast<const char*>(selection.data()), selection.size() * sizeof(Scalar)) ;
+    writeMode.close() ;
+  }
+  write_matrix_info(outName, selRowsSize, indices.size(), source.varSize, source.layout, scalar_type_of<Scalar>()) ;
+  std::cout << "Wrote " << indices.size() << " modes at " << selPointSize << " points to " << outName << std::endl ;
+}
+
+void modes(Parameters &params)
+{
+  std::cout << "Starting mode extraction routine " << std::endl ;
+
+  omp_set_num_threads(params.m_threadsSize) ;
+
+  const ModeSource source(read_mode_source(params.m_modeDirName + "/modeSource.info")) ;
+
+  /* The modes have the scalar type of the chronos, recorded in their description */
+  const int scalar(read_matrix_scalar(source.chronosDirName + "/chronos.bin")) ;
+  if (scalar != SCALAR_DOUBLE)
+    std::cout << "Modes of " << scalar_name(scalar) << " values." << std::endl ;
+
+  if (scalar == SCALAR_FLOAT)
+    modes_scalar<float>(params, source) ;
+  else if (scalar == SCALAR_COMPLEX)
+    modes_scalar<std::complex<double>>(params, source) ;
+  else
+    modes_scalar<double>(params, source) ;
+}
+
+int main(int argc, const char *argv[])
+{
+  ez::ezOptionParser opt;
+
+  opt.overview = "Mode extraction routine";
+  opt.syntax = "Compute POD modes on demand after POD -lazy using [INPUTS] ...";
+  opt.example = "MODES -m modes -modes 0,1,2 -np 4\n\n";
+  opt.footer = "\nThis program is free and without warranty.\n";
+
+  opt.add(
+      "",                            // Default.
+      0,                             // Required?
+      0,                             // Number of args expected.
+      0,                             // Delimiter if expecting multiple args.
+      "Display usage instructions.", // Help description.
+      "-h"                          // Flag token.
+      );
+
+  opt.add(
+      "",                                                // Default.
+      1,                                                 // Required?
+      1,                                                 // Number of args expected.
+      0,                                                 // Delimiter if expecting multiple args.
+      "Modes directory (with modeSource.info).",         // Help description.
+      Parameters::m_modeDirNameOpt                       // Flag token.
+      );
+
+  ez::ezOptionValidator *vS4 = new ez::ezOptionValidator("s4", "ge", "0");
+  opt.add(
+      "",                            // Default.
+      1,                             // Required?
+      1,                             // Number of args expected.
+      0,                             // Delimiter if expecting multiple args.
+      "Number of parallel threads.", // Help description.
+      Parameters::m_threadsSizeOpt,  // Flag token.
+      vS4                            // Validate input
+      );
+
+  opt.add(
+      "",
+      0,
+      -1,
+      ',',
+      "Indices of the modes to compute (comma separated, default: all).",
+      Parameters::m_modeIndicesOpt
+      );
+
+  opt.add(
+      "",
+      0,
+      1,
+      0,
+      "File with the indices of the points to extract, one per line (default: all).",
+      Parameters::m_pointIndicesFileNameOpt
+      );
+
+  opt.add(
+      "",
+      0,
+      1,
+      0,
+      "Output file (default: modeDir/mode.bin for all the modes and points, modeDir/modeSelection.bin otherwise).",
+      Parameters::m_outFileNameOpt
+      );
+
+  // Perform the actual parsing of the command line.
+  opt.parse(argc, argv);
+
+  if (opt.isSet("-h"))
+  {
+    Usage(opt);
+    return 1;
+  }
+
+  // Perform validations of input parameters.
+  //
+  // Check if directories exist.
+  if (opt.isSet(Parameters::m_modeDirNameOpt))
+  {
+    std::string inputdir;
+    struct stat info;
+    opt.get(Parameters::m_modeDirNameOpt)->getString(inputdir);
+
+    if (stat(inputdir.c_str(), &info) != 0 || !(info.st_mode & S_IFDIR))
+    {
+      std::cerr << "ERROR: " << inputdir << " is not a directory.\n\n";
+      return 1;
+    }
+  }
+
+  std::vector<std::string> badOptions;
+  int i;
+  if (!opt.gotRequired(badOptions))
+  {
+    for (i = 0; i < badOptions.size(); ++i)
+      std::cerr << "ERROR: Missing required option " << badOptions[i] << ".\n\n";
+
+    Usage(opt);
+    return 1;
+  }
+
+  if (!opt.gotExpected(badOptions))
+  {
+    for (i = 0; i < badOptions.size(); ++i)
+      std::cerr << "ERROR: Got unexpected number of arguments for option " << badOptions[i] << ".\n\n";
+
+    Usage(opt);
+    return 1;
+  }
+
+  Parameters params(opt) ;
+  simd_kernels() ;
+
+  try
+  {
+    modes(params) ;
+  }
+  catch (const char *message)
+  {
+    std::cerr << "ERROR: " << message << ".\n\n";
+    return 1;
+  }
+
+  return 0;
+}
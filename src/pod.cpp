@@ -1,213 +1,537 @@
 #include <iostream>
+#include <memory>
+#include <filesystem>
 #include <Eigen/Dense>
 #include "ezOptionParser.hpp"
 #include <omp.h>
 #include <sys/stat.h>
 
 #include "utils.h"
+#include "simd.h"
+#include "taskgraph.h"
+#include "spod.h"
+#include "interpolation.h"
+#include "eigensolvers.h"
+#include "rsvd.h"
+#include "preview.h"
+#include "libpod.h"
+#include "shmsnapshots.h"
+
+/*
+Reference to the snapshot files for MODES, instead of the modes.
+*/
+static void write_lazy_source(const Parameters &params, const long rowsSize, const long timesSize)
+{
+  ModeSource source{std::filesystem::absolute(params.m_inputDirName).string(),
+                    std::filesystem::absolute(params.m_timesFileName).string(),
+                    params.m_dataFileName,
+                    std::filesystem::absolute(params.m_chronosDirName).string(),
+                    params.m_varSize, params.m_offset, params.m_layout,
+                    rowsSize, params.m_podSize, timesSize} ;
+  write_mode_source(params.m_modeDirName + "/modeSource.info", source) ;
+
+  /* Modes cached from a previous run are stale */
+  std::filesystem::remove_all(params.m_modeDirName + "/cache") ;
+}
 
-void pod(ez::ezOptionParser &opt)
+/*
+Chronos of Scalar values, described for the scalar types other than double.
+*/
+template <typename Scalar>
+static void write_chronos(const std::string &chronosDir, const ScalarMatrix<Scalar> &chronos)
 {
-  std::cout << "Starting POD routine " << std::endl ;
+  std::ofstream writeChronos(chronosDir + "/chronos.bin", std::ios::binary) ;
+  if(writeChronos.is_open()) {
+    writeChronos.write(reinterpret_cast<const char*>(chronos.data()), chronos.size() * sizeof(Scalar)) ;
+    writeChronos.close() ;
+  }
+  if (scalar_type_of<Scalar>() != SCALAR_DOUBLE)
+    write_matrix_info(chronosDir + "/chronos.bin", chronos.rows(), chronos.cols(), 1, LAYOUT_BLOCKED,
+                      scalar_type_of<Scalar>()) ;
+}
 
-  Parameters params(opt) ;
+/*
+Stages of the randomized SVD of the snapshot files pcfs streamed as Scalar
+values, added to graph and run.
+*/
+template <typename Scalar>
+static void pod_randomized(TaskGraph &graph, Parameters &params, const std::vector<std::string> &pcfs)
+{
+  const long timesSize(pcfs.size()) ;
+  if (params.m_spodType > 0)
+    std::cout << "SPOD is not available with the randomized SVD, filter ignored. " << std::endl ;
+
+  ScalarMatrix<Scalar> m ;
+  ScalarMatrix<Scalar> chronos ;
+  VectorXd snapNorm2 ;
+  VectorXd eigval ;
+  long pointSize(0) ;
+
+  const auto svdTask = graph.add("Computing randomized SVD", [&]() {
+    randomized_pod<Scalar>(pcfs, params, pointSize, eigval, m, chronos, snapNorm2) ;
+
+    /* The sum of all the eigenvalues is the trace, known from the norms.
+    The approximate eigenvalues may overestimate it, the RIC is clamped. */
+    const double trace(std::max(snapNorm2.sum() / timesSize, eigval.sum())) ;
+    params.m_podSize = ric_pod_size(eigval, trace, params.m_targetRic, params.m_podSize) ;
+    std::cout << "With given RIC, pod size = " << params.m_podSize << std::endl;
+  }) ;
+
+  graph.add("Writing eigenvalues and chronos", [&]() {
+    write_eigenvalues(params.m_chronosDirName, eigval, timesSize, snapNorm2.sum() / timesSize) ;
+    write_chronos<Scalar>(params.m_chronosDirName, chronos.topRows(params.m_podSize)) ;
+  }, {svdTask}) ;
+
+  if (params.m_errorCurves)
+  {
+    graph.add("Computing error curves", [&]() {
+      VectorXd globalError, energy ;
+      MatrixXd snapError(projection_error_curves<Scalar>(snapNorm2, chronos, globalError, energy)) ;
+      write_error_curves(params.m_chronosDirName, snapError, globalError, energy) ;
+    }, {svdTask}) ;
+  }
 
-  omp_set_num_threads(params.m_threadsSize) ;
+  graph.add("Writing POD modes", [&]() {
+    std::ofstream writeModes(params.m_modeDirName + "/mode.bin", std::ios::binary) ;
+    if(writeModes.is_open()) {
+      writeModes.write(reinterpret_cast<const char*>(m.data()), m.rows() * params.m_podSize * sizeof(Scalar)) ;
+      writeModes.close() ;
+    }
+    write_matrix_info(params.m_modeDirName + "/mode.bin", m.rows(), params.m_podSize, params.m_varSize, params.m_layout,
+                      scalar_type_of<Scalar>()) ;
+  }, {svdTask}) ;
 
-  // GENERATING TIME STRING
-  std::vector<std::string> t(read_timefile(params.m_timesFileName)) ;
+  graph.run() ;
+  graph.report(std::cout) ;
+}
 
-  long timesSize(t.size()) ; // Determine number of snapshots from time entry list
+/*
+Stages of the POD of the snapshot files pcfs (times t) held in memory as
+Scalar values, added to graph and run.
+*/
+template <typename Scalar>
+static void pod_snapshots(TaskGraph &graph, Parameters &params, const std::vector<std::string> &t,
+                          const std::vector<std::string> &pcfs)
+{
+  typedef Matrix<typename NumTraits<Scalar>::Real, Dynamic, 1> RealVector ;
+  const long timesSize(t.size()) ;
+
+  ScalarMatrix<Scalar> m ;
+  ScalarMatrix<Scalar> pm ;
+  ScalarMatrix<Scalar> pmUnfiltered ;
+  VectorXd snapNorm2 ;
+  RealVector eigval ;
+  ScalarMatrix<Scalar> eigvec ;
+  ScalarMatrix<Scalar> chronos ;
+  BasicSnapshotSource<Scalar> snapshots ;
+  SnapshotSegment segment ;
+  BasicPodBasis<Scalar> basis ;
+  long pointSize(0) ;
+  double readMemory(0.) ;
+  double eigValSum(0.) ;
 
-  /* Check whether the requested number of modes to write is larger than
-  the number of snapshots. If so, set the number of modes to the number of
-  snapshots. */
-  if (params.m_podSize > timesSize)
+  // READING INPUT FILES
+  const auto readTask = graph.add("Reading files", [&]() {
+    /* Snapshots of a shared segment, mapped without copy or published for the next processes */
+    if (!params.m_shmName.empty())
+    {
+      snapshots = shared_snapshots<Scalar>(segment, params.m_shmName, pcfs, params.m_varSize, params.m_offset,
+                                           params.m_layout) ;
+      pointSize = snapshots.rows() / params.m_varSize ;
+      readMemory = peak_memory_mb() ;
+      return ;
+    }
+
+    auto pointCloudInfo = read_pcfs_to_matrix(&m, &pcfs, (long)params.m_varSize, (long)params.m_offset, params.m_layout);
+    pointSize = pointCloudInfo.rows ;
+
+    /* Complex values take two columns each */
+    const long columnsSize(NumTraits<Scalar>::IsComplex ? 2 * params.m_varSize : params.m_varSize) ;
+    std::cout << "File contains " << pointCloudInfo.rows << " rows and " << pointCloudInfo.columns << " columns. "
+    << "Read data from columns " << (params.m_offset + 1) << " to " << (params.m_offset + columnsSize) << "."
+    << std::endl;
+ 
+    snapshots = BasicSnapshotSource<Scalar>(m.data(), m.rows(), m.cols()) ;
+    readMemory = peak_memory_mb() ;
+  }) ;
+
+  // FREQUENCY-DOMAIN SPOD
+
+  if (params.m_spodType == SPOD_FREQUENCY)
   {
-    std::cout << "Modes to write exceed available snapshots. Adjusted. " << std::endl ;
-    params.m_podSize = timesSize ;
+    VectorXd tv(times_to_vector(t)) ;
+    if (!is_uniform(tv))
+      std::cout << "Snapshot times are not equally spaced, using their mean spacing for SPOD. " << std::endl ;
+    const double dt(timesSize > 1 ? (tv(timesSize - 1) - tv(0)) / (timesSize - 1) : 1.) ;
+
+    graph.add("Computing frequency-domain SPOD", [&, dt]() {
+      frequency_spod<Scalar>(snapshots.matrix(), dt, params) ;
+    }, {readTask}) ;
+
+    graph.run() ;
+    graph.report(std::cout) ;
+    return ;
   }
 
-  // READING INPUT FILES
+  /* The descending eigenpairs are read from the ascending ones of the solvers
+  through these views */
+  const auto eigvalDesc(eigval.reverse()) ;
+  const auto eigvecDesc(eigvec.rowwise().reverse()) ;
 
-  /* Build a string array with all file names to be read into the matrix */
-  std::vector<std::string> pcfs ;
-  for (std::vector<std::string>::iterator it = t.begin(); it != t.end(); ++it)
+  // SPATIAL COVARIANCE POD
+
+  /* With fewer degrees of freedom than snapshots, the N x N spatial covariance
+  matrix is smaller than the T x T correlation matrix. Its eigenvectors are the
+  modes, with the same eigenvalues (padded with zeros to T), and the chronos
+  are the projections of the snapshots on the modes. The SPOD filters act on
+  the correlation matrix and keep the method of snapshots. */
+  bool spatial(params.m_covariance == COV_SPATIAL) ;
+  if (params.m_covariance == COV_AUTO)
   {
-    std::string name_temp = params.m_inputDirName + "/" + *it + "/" + params.m_dataFileName ;
-    pcfs.push_back(name_temp);
+    const long dofSize(read_pcf_info(pcfs[0]).rows * params.m_varSize) ;
+    spatial = dofSize < timesSize ;
+    std::cout << "Degrees of freedom: " << dofSize << ", snapshots: " << timesSize << ", decomposing the "
+              << (spatial ? "spatial covariance matrix." : "correlation matrix (method of snapshots).") << std::endl ;
+  }
+  if (spatial && (params.m_spodType > 0 || !params.m_spodStudyWidths.empty()))
+  {
+    std::cout << "SPOD filters the correlation matrix, using the method of snapshots. " << std::endl ;
+    spatial = false ;
   }
 
-  MatrixXd m ;
-  double start(omp_get_wtime()) ;
-  std::cout << "Reading files..." << std::flush ;
-  auto pointCloudInfo = read_pcfs_to_matrix(&m, &pcfs, (long)params.m_varSize, (long)params.m_offset);
-  auto pointSize(pointCloudInfo.rows) ;
-  double end(omp_get_wtime()) ;
-  std::cout << "\t\t\t\t Done in " << end - start << "s \n" << std::endl ;
+  if (spatial)
+  {
+    const auto eigenTask = graph.add("Computing spatial covariance eigenvalues and modes", [&]() {
+      if (params.m_errorCurves)
+        snapNorm2 = snapshots.matrix().colwise().squaredNorm().transpose().template cast<double>() ;
+
+      covariance_matrix<Scalar>(snapshots.matrix(), pm) ;
+      eigValSum = pod_eigen<Scalar>(pm, params.m_eigSolver, params.m_podSize, params.m_targetRic, readMemory,
+                                    eigval, eigvec) ;
+
+      params.m_podSize = ric_pod_size(eigvalDesc, eigValSum, params.m_targetRic, params.m_podSize) ;
+      std::cout << "With given RIC, pod size = " << params.m_podSize << std::endl;
+
+      /* chronos(i, j) = phi_i^H m_j, snapshots split over the threads */
+      chronos.resize(params.m_podSize, timesSize) ;
+      const ScalarMatrix<Scalar> podModes(eigvecDesc.leftCols(params.m_podSize)) ;
+      const long chunkSize(256) ;
+#pragma omp parallel for schedule(dynamic)
+      for (long t0 = 0; t0 < timesSize; t0 += chunkSize)
+      {
+        const long chunk(std::min(chunkSize, timesSize - t0)) ;
+        chronos.middleCols(t0, chunk).noalias() = podModes.adjoint() * snapshots.matrix().middleCols(t0, chunk) ;
+      }
+    }, {readTask}) ;
+
+    graph.add("Writing eigenvalues and chronos", [&]() {
+      /* All the eigenvalues of the correlation matrix, N of which are non-zero */
+      VectorXd values(eigvalDesc.template cast<double>()) ;
+      if (eigval.size() == pointSize * params.m_varSize)
+        values.conservativeResizeLike(VectorXd::Zero(timesSize)) ;
+      write_eigenvalues(params.m_chronosDirName, values, timesSize, eigValSum) ;
+      write_chronos<Scalar>(params.m_chronosDirName, chronos) ;
+    }, {eigenTask}) ;
+
+    if (params.m_errorCurves)
+    {
+      /* The error vanishes beyond rank N, the curves stop there */
+      graph.add("Computing error curves", [&]() {
+        const ScalarMatrix<Scalar> coeffs(eigvecDesc.adjoint() * snapshots.matrix()) ;
+        VectorXd globalError, energy ;
+        MatrixXd snapError(projection_error_curves<Scalar>(snapNorm2, coeffs, globalError, energy)) ;
+        write_error_curves(params.m_chronosDirName, snapError, globalError, energy) ;
+      }, {eigenTask}) ;
+    }
+
+    if (params.m_lazyModes)
+    {
+      graph.add("Writing mode source", [&]() {
+        write_lazy_source(params, pointSize * params.m_varSize, timesSize) ;
+      }, {eigenTask}) ;
+    }
+    else
+    {
+      graph.add("Writing POD modes", [&]() {
+        const ScalarMatrix<Scalar> podModes(eigvecDesc.leftCols(params.m_podSize)) ;
+        std::ofstream writeModes(params.m_modeDirName + "/mode.bin", std::ios::binary) ;
+        if(writeModes.is_open()) {
+          writeModes.write(reinterpret_cast<const char*>(podModes.data()), podModes.size() * sizeof(Scalar)) ;
+          writeModes.close() ;
+        }
+        write_matrix_info(params.m_modeDirName + "/mode.bin", podModes.rows(), params.m_podSize, params.m_varSize,
+                          params.m_layout, scalar_type_of<Scalar>()) ;
+      }, {eigenTask}) ;
+    }
 
-  std::cout << "File contains " << pointCloudInfo.rows << " rows and " << pointCloudInfo.columns << " columns. "
-  << "Read data from columns " << (params.m_offset + 1) << " to " << (params.m_offset + params.m_varSize) << ".\n"
-  << std::endl;
+    graph.run() ;
+    graph.report(std::cout) ;
+    return ;
+  }
 
   // COMPUTING NORMALISED PROJECTION MATRIX
-  start = omp_get_wtime();
-  std::cout << "Computing projection matrix..." << std::flush ;
-  MatrixXd pm = MatrixXd::Zero(timesSize, timesSize) ;
-  pm = (1.0 / timesSize) * m.transpose() * m ;
-  end = omp_get_wtime() ;
-  std::cout << "\t\t\t Done in " << end - start << "s \n"
-  << std::endl;
+  auto correlationTask = graph.add("Computing projection matrix", [&]() {
+    BasicGramAccumulator<Scalar> gram ;
+    gram.update(snapshots) ;
+    gram.release(pm) ;
+
+    /* Squared snapshot norms, read from the diagonal before any filtering */
+    if (params.m_errorCurves)
+      snapNorm2 = timesSize * pm.diagonal().real().template cast<double>() ;
+
+    /* Unfiltered matrix kept for the SPOD width study */
+    if (!params.m_spodStudyWidths.empty())
+      pmUnfiltered = pm ;
+  }, {readTask}) ;
 
   // APPLY SPECTRAL POD FILTER IF DESIRED
 
   if (params.m_spodType > 0)
   {
-    start = omp_get_wtime();
-    std::cout << "Filtering projection matrix for SPOD..." << std::flush;
+    correlationTask = graph.add("Filtering projection matrix for SPOD", [&]() {
+      spod_filter(pm, {spod_filter_weights(params.m_spodType, params.m_spodWidth)},
+                  params.m_spodBoundary, {&pm}) ;
+    }, {correlationTask}) ;
+  }
+
+  // COMPUTING SORTED EIGENVALUES AND EIGENVECTORS
+
+  TaskGraph::TaskId eigenTask ;
+  std::ofstream writeMode ;
+  std::array<ScalarMatrix<Scalar>, 2> modeBuffers ;
+
+  eigenTask = graph.add("Computing eigenvalues and eigenvectors", [&]() {
+    /* The pod size is adjusted according to the ric */
+    basis = BasicPodBasis<Scalar>(pm, params.m_podSize, params.m_targetRic, params.m_eigSolver, readMemory) ;
+    params.m_podSize = basis.size() ;
+    std::cout << "With given RIC, pod size = " << params.m_podSize << std::endl;
+
+    chronos = basis.chronos() ;
 
-    int nfSize = 2 * params.m_spodWidth + 1;
+    // WRITING SORTED EIGENVALUES
 
-    VectorXd g = VectorXd::Ones(nfSize);
+    graph.add("Writing eigenvalues", [&]() {
+      write_eigenvalues(params.m_chronosDirName, basis.eigenvalues().template cast<double>(), basis.times(),
+                        basis.trace()) ;
+    }, {eigenTask}) ;
 
-    if (params.m_spodType == 2)
+    // WRITING CHRONOS
+
+    graph.add("Writing chronos", [&]() {
+      write_chronos<Scalar>(params.m_chronosDirName, chronos) ;
+    }, {eigenTask}) ;
+
+    // SPOD PARAMETER STUDY
+
+    /* Eigenvalue spectra of the correlation matrix filtered with every
+    requested width, all filters being applied in one sweep */
+    if (!params.m_spodStudyWidths.empty())
     {
-      VectorXd gauss = VectorXd::LinSpaced(nfSize, -2.285, 2.285);
-      g = exp(-square(gauss.array()));
+      graph.add("Filtering and solving SPOD width study", [&]() {
+        const int type(params.m_spodType > 0 ? params.m_spodType : SPOD_BOX) ;
+        const auto widthsSize(params.m_spodStudyWidths.size()) ;
+        std::vector<VectorXd> filters ;
+        std::vector<ScalarMatrix<Scalar>> spms(widthsSize) ;
+        std::vector<ScalarMatrix<Scalar>*> spmPtrs ;
+        for (size_t f = 0; f < widthsSize; f++)
+        {
+          filters.push_back(spod_filter_weights(type, params.m_spodStudyWidths[f])) ;
+          spmPtrs.push_back(&spms[f]) ;
+        }
+        spod_filter(pmUnfiltered, filters, params.m_spodBoundary, spmPtrs) ;
+        pmUnfiltered.resize(0, 0) ;
+
+        const FlushDenormals flush(std::is_same<Scalar, float>::value) ;
+        for (size_t f = 0; f < widthsSize; f++)
+        {
+          RealVector studyValues ;
+          selfadjoint_eigen_inplace(spms[f], studyValues, false) ;
+          spms[f].resize(0, 0) ;
+          VectorXd studyEigval = studyValues.reverse().template cast<double>() ;
+          std::ofstream writeStudy(params.m_chronosDirName + "/eigenValues.spodW"
+                                   + std::to_string(params.m_spodStudyWidths[f]) + ".bin", std::ios::binary) ;
+          if (writeStudy.is_open()) {
+            writeStudy.write(reinterpret_cast<const char*>(studyEigval.data()), studyEigval.size() * sizeof(double)) ;
+            writeStudy.close() ;
+          }
+        }
+      }, {eigenTask}) ;
     }
 
-    g = g / g.sum();
+    // COMPUTING ERROR CURVES
 
-    size_t idx = 0;
+    if (params.m_errorCurves)
+    {
+      if (params.m_spodType > 0)
+      {
+        std::cout << "SPOD modes are not orthonormal, error curves skipped. REC -ec computes them with the Gram matrix of the modes." << std::endl;
+      }
+      else
+      {
+        graph.add("Computing error curves", [&]() {
+          /* Coefficients of every snapshot on every mode: sqrt(lambda_i T) conj(v_ji) */
+          ScalarMatrix<Scalar> coeffs(basis.chronos(basis.eigenvalues().size())) ;
+          VectorXd globalError, energy ;
+          MatrixXd snapError(projection_error_curves<Scalar>(snapNorm2, coeffs, globalError, energy)) ;
+          write_error_curves(params.m_chronosDirName, snapError, globalError, energy) ;
+        }, {eigenTask}) ;
+      }
+    }
 
-    MatrixXd spm = MatrixXd::Zero(timesSize, timesSize);
-    MatrixXd pmExt = MatrixXd::Zero(timesSize * 3, timesSize * 3);
+    // REFERENCE FOR MODES ON DEMAND
 
-    pmExt = pm.replicate(3, 3).block(timesSize - params.m_spodWidth,
-                                     timesSize - params.m_spodWidth,
-                                     timesSize + 2 * params.m_spodWidth,
-                                     timesSize + 2 * params.m_spodWidth);
+    /* The modes are not computed: the snapshot files, the eigenvalues and the
+    chronos (scaled eigenvectors) are enough for MODES to compute any of them */
+    if (params.m_lazyModes)
+    {
+      graph.add("Writing mode source", [&]() {
+        write_lazy_source(params, pointSize * params.m_varSize, timesSize) ;
+      }, {eigenTask}) ;
+      return ;
+    }
 
-    for (int i = 0; i < timesSize; i++)
+    // COMPUTING AND WRITING POD MODES
+
+    /* The modes are the product Phi = M W, W = V Lambda^-1/2 / sqrt(T). Phi is
+    computed by blocks of rows, so that every row of the snapshot matrix is
+    read once for all the modes, into two alternating buffers. Block b can be
+    computed once block b-2 has been written out of its buffer, and is written
+    to every mode (column) of the file at its row offset. -mb (modes per
+    block) sets a buffer of that many whole modes, -mrb its rows directly. */
+    const long MVSIZE(pointSize * params.m_varSize) ;
+    long blockSize(std::max((MVSIZE + 3) / 4, 1L)) ;
+    if (params.m_modeRowBlockSize > 0)
+      blockSize = std::min((long)params.m_modeRowBlockSize, MVSIZE) ;
+    else if (params.m_modeBlockSize > 0)
+      blockSize = std::max(std::min(params.m_modeBlockSize * MVSIZE / std::max(params.m_podSize, 1), MVSIZE), 1L) ;
+    const long blocksSize((MVSIZE + blockSize - 1) / blockSize) ;
+
+    writeMode.open(params.m_modeDirName + "/mode.bin", std::ios::binary) ;
+    std::vector<TaskGraph::TaskId> computeTasks, writeTasks ;
+
+    for (long b = 0; b < blocksSize; b++)
     {
-      for (int j = 0; j < timesSize; j++)
-      {
-        for (int k = -params.m_spodWidth; k < params.m_spodWidth + 1; k++)
+      const long first(b * blockSize) ;
+      const long rows(std::min(blockSize, MVSIZE - first)) ;
+      const std::string range(std::to_string(first) + "-" + std::to_string(first + rows - 1)) ;
+
+      std::vector<TaskGraph::TaskId> deps = {eigenTask} ;
+      if (b > 0)
+        deps.push_back(computeTasks[b - 1]) ;
+      if (b > 1)
+        deps.push_back(writeTasks[b - 2]) ;
+
+      computeTasks.push_back(graph.add("Computing POD mode rows " + range, [&, b, first, rows]() {
+        basis.mode_rows(snapshots, first, rows, modeBuffers[b % 2]) ;
+      }, deps)) ;
+
+      deps = {computeTasks[b]} ;
+      if (b > 0)
+        deps.push_back(writeTasks[b - 1]) ;
+
+      writeTasks.push_back(graph.add("Writing POD mode rows " + range, [&, b, first, MVSIZE]() {
+        const ScalarMatrix<Scalar> &pod(modeBuffers[b % 2]) ;
+        if(writeMode.is_open())
         {
-          spm(i, j) += g(idx) * pmExt(i + k + params.m_spodWidth, j + k + params.m_spodWidth);
-          idx++;
+          for (long i = 0; i < pod.cols(); i++)
+          {
+            writeMode.seekp((i * MVSIZE + first) * sizeof(Scalar)) ;
+            writeMode.write(reinterpret_cast<const char*>(pod.col(i).data()), pod.rows() * sizeof(Scalar)) ;
+          }
         }
-        idx = 0;
-      }
+      }, deps)) ;
     }
 
-    pm = spm;
+    graph.add("Closing mode file", [&, MVSIZE]() {
+      writeMode.close() ;
+      write_matrix_info(params.m_modeDirName + "/mode.bin", MVSIZE, params.m_podSize, params.m_varSize, params.m_layout,
+                        scalar_type_of<Scalar>()) ;
+    }, writeTasks) ;
+  }, {correlationTask}) ;
 
-    end = omp_get_wtime();
-    std::cout << "\t\t Done in " << end - start << "s \n"
-    << std::endl;
-  }
+  graph.run() ;
+  graph.report(std::cout) ;
+}
 
-  // COMPUTING SORTED EIGENVALUES AND EIGENVECTORS
+void pod(ez::ezOptionParser &opt)
+{
+  std::cout << "Starting POD routine " << std::endl ;
 
-  start = omp_get_wtime();
-  std::cout << "Computing eigenvalues and eigenvectors..." << std::flush;
-  SelfAdjointEigenSolver<MatrixXd> eigensolver(pm);
-  if (eigensolver.info() != Success)
-    abort();
-
-  VectorXd eigval = eigensolver.eigenvalues().reverse();
-  MatrixXd eigvec = eigensolver.eigenvectors().rowwise().reverse();
-  end = omp_get_wtime();
-  std::cout << "\t Done in " << end - start << "s \n"
-  << std::endl;
-
-  // Adjust params.m_podSize according to the ric
-  auto eigValSum(0.) ;
-  for(auto i(0) ; i < eigval.size() ; ++i) {
-    eigValSum += std::fabs(eigval(i)) ;
+  Parameters params(opt) ;
+
+  omp_set_num_threads(params.m_threadsSize) ;
+
+  // GENERATING TIME STRING
+  std::vector<std::string> t(read_timefile(params.m_timesFileName)) ;
+
+  long timesSize(t.size()) ; // Determine number of snapshots from time entry list
+
+  /* Check whether the requested number of modes to write is larger than
+  the number of snapshots. If so, set the number of modes to the number of
+  snapshots. */
+  if (params.m_podSize > timesSize)
+  {
+    std::cout << "Modes to write exceed available snapshots. Adjusted. " << std::endl ;
+    params.m_podSize = timesSize ;
   }
 
-  auto ric(0) ;
-  auto podSizeWithRIC(0) ;
-  while(ric < params.m_targetRic * eigValSum && podSizeWithRIC < eigval.size()) {
-    ric += std::fabs(eigval(podSizeWithRIC)) ;
-    ++podSizeWithRIC ;
+  /* Build a string array with all file names to be read into the matrix */
+  std::vector<std::string> pcfs ;
+  for (std::vector<std::string>::iterator it = t.begin(); it != t.end(); ++it)
+  {
+    std::string name_temp = params.m_inputDirName + "/" + *it + "/" + params.m_dataFileName ;
+    pcfs.push_back(name_temp);
   }
-  params.m_podSize=std::min(podSizeWithRIC, params.m_podSize) ;
-  std::cout << "With given RIC, pod size = " << params.m_podSize << std::endl;
 
-  // COMPUTING POD MODES
+  /* The stages of the POD are run as a dependency graph. Computing stages
+  follow each other, but the outputs are written as soon as they are
+  available: eigenvalues and chronos right after the eigen-solve, and the
+  modes block by block (double-buffered) while the next block is computed. */
+  TaskGraph graph(3, params.m_threadsSize) ;
 
-  start = omp_get_wtime();
-  std::cout << "Computing POD modes..." << std::flush;
+  if (!params.m_shmName.empty() && (params.m_rsvd || params.m_previewPoints > 0))
+    std::cout << "The snapshots are streamed with -rsvd and -preview, -shm ignored. " << std::endl ;
 
-  /* Define matrices to store scalar or vector values*/
-  // For scalar or vector define one matrix
-  const auto MVSIZE(pointSize*params.m_varSize) ;
-  MatrixXd pod(MatrixXd::Zero(MVSIZE, params.m_podSize)) ;
-  MatrixXd chronos(MatrixXd::Zero(params.m_podSize, timesSize)) ;
+  // RANDOMIZED SVD
 
-#pragma omp parallel
-#pragma omp for
-  for (size_t i = 0; i < params.m_podSize; i++)
+  /* The snapshots are streamed from the files, neither the snapshot matrix
+  nor the correlation matrix is stored */
+  if (params.m_rsvd)
   {
-    for (size_t j = 0; j < timesSize; j++)
-    {
-      const auto factor(eigval(i) * timesSize) ;
-      chronos(i, j) =  sqrt(factor) * eigvec(j, i) ;
-      pod.col(i) += chronos(i, j) / factor * m.block(0, j, MVSIZE, 1);
-    }
-  }
-  end = omp_get_wtime();
-  std::cout << "\t\t\t\t Done in " << end - start << "s \n"
-  << std::endl;
-
-  // WRITING SORTED EIGENVALUES
-
-  start = omp_get_wtime();
-  std::cout << "Writing eigenvalues..." << std::flush;
-  std::ofstream writeEigval(params.m_chronosDirName + "/eigenValues.bin", std::ios::binary);
-  if (writeEigval.is_open()) {
-    const auto size(eigval.size()) ;
-    //writeEigval.write(reinterpret_cast<const char*>(&size), sizeof(size)) ;
-    writeEigval.write(reinterpret_cast<const char*>(eigval.data()), size*sizeof(double)) ;
-    writeEigval.close();
+    if (params.m_scalar == SCALAR_FLOAT)
+      pod_randomized<float>(graph, params, pcfs) ;
+    else if (params.m_scalar == SCALAR_COMPLEX)
+      pod_randomized<std::complex<double>>(graph, params, pcfs) ;
+    else
+      pod_randomized<double>(graph, params, pcfs) ;
+    return ;
   }
-  end = omp_get_wtime();
-  std::cout << "\t\t\t\t Done in " << end - start << "s \n"
-  << std::endl;
-
-  // WRITING CHRONOS
-  start = omp_get_wtime();
-  std::cout << "Writing chronos..." << std::flush;
-  std::ofstream writeChronos(params.m_chronosDirName + "/chronos.bin", std::ios::binary) ;
-  if(writeChronos.is_open()) {
-    //writeChronos.write(reinterpret_cast<const char*>(&params.m_podSize), sizeof(params.m_podSize)) ;
-    //writeChronos.write(reinterpret_cast<const char*>(&timesSize), sizeof(timesSize)) ;
-    //const auto chronosExtract(chronos.block(0, 0, params.m_podSize, timesSize)) ;
-    writeChronos.write(reinterpret_cast<const char*>(chronos.data()), chronos.size() * sizeof(double)) ;
-    writeChronos.close() ;
-  }
-  end = omp_get_wtime();
-  std::cout << "\t\t\t\t Done in " << end - start << "s \n"
-  << std::endl;
-
-  // WRITING POD MODES
-  start = omp_get_wtime();
-  std::cout << "Writing POD modes..." << std::flush;
-  std::ofstream writeMode(params.m_modeDirName + "/mode.bin", std::ios::binary);
-  if(writeMode.is_open()) {
-    const auto nbRows(pod.rows()) ;
-    const auto nbCols(pod.cols()) ;
-    //writeMode.write(reinterpret_cast<const char*>(&nbRows), sizeof(nbRows)) ;
-    //writeMode.write(reinterpret_cast<const char*>(&nbCols), sizeof(nbCols)) ;
-    writeMode.write(reinterpret_cast<const char*>(pod.data()), pod.size() * sizeof(double)) ;
-    writeMode.close() ;
+
+  // PREVIEW
+
+  /* Only a sample of the point rows is read, for estimates of the spectrum */
+  if (params.m_previewPoints > 0)
+  {
+    graph.add("Computing preview", [&]() {
+      if (params.m_scalar == SCALAR_FLOAT)
+        preview_pod<float>(pcfs, params) ;
+      else if (params.m_scalar == SCALAR_COMPLEX)
+        preview_pod<std::complex<double>>(pcfs, params) ;
+      else
+        preview_pod<double>(pcfs, params) ;
+    }) ;
+
+    graph.run() ;
+    graph.report(std::cout) ;
+    return ;
   }
-  end = omp_get_wtime();
-  std::cout << "\t\t\t\t Done in " << end - start << "s \n"
-  << std::endl;
+
+  if (params.m_scalar == SCALAR_FLOAT)
+    pod_snapshots<float>(graph, params, t, pcfs) ;
+  else if (params.m_scalar == SCALAR_COMPLEX)
+    pod_snapshots<std::complex<double>>(graph, params, t, pcfs) ;
+  else
+    pod_snapshots<double>(graph, params, t, pcfs) ;
 }
 
 int main(int argc, const char *argv[])
@@ -329,7 +653,7 @@ int main(int argc, const char *argv[])
   ez::ezOptionValidator *vS1 = new ez::ezOptionValidator("s1", "ge", "0");
 
   opt.add(
-      "0", // 0 : No SPOD, 1 : SPOD with box filter, 2 : SPOD with Gauss filter
+      "0", // 0 : No SPOD, 1 : SPOD with box filter, 2 : SPOD with Gauss filter, 3 : Frequency-domain SPOD
       0,
       1,
       0,
@@ -348,6 +672,214 @@ int main(int argc, const char *argv[])
       vS1
       );
 
+  opt.add(
+      "",                                                                    // Default.
+      0,                                                                     // Required?
+      0,                                                                     // Number of args expected.
+      0,                                                                     // Delimiter if expecting multiple args.
+      "Write projection error curves for every rank to the chronos directory.", // Help description.
+      Parameters::m_errorCurvesOpt                                           // Flag token.
+      );
+
+  opt.add(
+      "0",                                                        // Default.
+      0,                                                          // Required?
+      1,                                                          // Number of args expected.
+      0,                                                          // Delimiter if expecting multiple args.
+      "Number of modes computed and written per block (0: automatic).", // Help description.
+      Parameters::m_modeBlockSizeOpt,                             // Flag token.
+      vS4                                                         // Validate input
+      );
+
+  opt.add(
+      "0",                                                        // Default.
+      0,                                                          // Required?
+      1,                                                          // Number of args expected.
+      0,                                                          // Delimiter if expecting multiple args.
+      "Number of mode rows computed and written per block, overrides -mb (0: automatic).", // Help description.
+      Parameters::m_modeRowBlockSizeOpt,                          // Flag token.
+      vS4                                                         // Validate input
+      );
+
+  ez::ezOptionValidator *vBc = new ez::ezOptionValidator("s1", "gele", "0,1");
+  opt.add(
+      "0", // 0 : Periodic, 1 : Zero padding
+      0,
+      1,
+      0,
+      "SPOD filter boundary treatment",
+      Parameters::m_spodBoundaryOpt,
+      vBc
+      );
+
+  opt.add(
+      "",
+      0,
+      -1,
+      ',',
+      "SPOD filter widths of a parameter study (comma separated). Eigenvalues are written to eigenValues.spodW<width>.bin",
+      Parameters::m_spodStudyWidthsOpt
+      );
+
+  opt.add(
+      "0",
+      0,
+      1,
+      0,
+      "Frequency-domain SPOD: snapshots per block (0: a quarter of the snapshots)",
+      Parameters::m_fspodNfftOpt,
+      vS4
+      );
+
+  opt.add(
+      "-1",
+      0,
+      1,
+      0,
+      "Frequency-domain SPOD: overlap of the blocks in snapshots (default: half a block)",
+      Parameters::m_fspodOverlapOpt
+      );
+
+  opt.add(
+      "",
+      0,
+      -1,
+      ',',
+      "Frequency-domain SPOD: frequency bins to solve (comma separated, default: all)",
+      Parameters::m_fspodFreqsOpt
+      );
+
+  ez::ezOptionValidator *vEig = new ez::ezOptionValidator("s1", "gele", "0,2");
+  opt.add(
+      "0", // 0 : Full eigen-decomposition, 1 : Thick-restart Lanczos (leading eigenpairs up to -nm or -ric), 2 : Multithreaded divide and conquer (all eigenpairs)
+      0,
+      1,
+      0,
+      "Eigen-solver for the projection matrix.",
+      Parameters::m_eigSolverOpt,
+      vEig
+      );
+
+  opt.add(
+      "",
+      0,
+      0,
+      0,
+      "Randomized SVD of the snapshots streamed from the files, without the projection matrix (leading -nm modes).",
+      Parameters::m_rsvdOpt
+      );
+
+  opt.add(
+      "1",
+      0,
+      1,
+      0,
+      "Randomized SVD: number of power iterations, the files are read q + 2 times (0: single pass, faster but the eigenvalues are overestimated for slowly decaying spectra).",
+      Parameters::m_rsvdPowerOpt,
+      vS4
+      );
+
+  opt.add(
+      "10",
+      0,
+      1,
+      0,
+      "Randomized SVD: oversampling of the range sketch.",
+      Parameters::m_rsvdOversamplingOpt,
+      vS4
+      );
+
+  opt.add(
+      "",
+      0,
+      0,
+      0,
+      "Do not compute the modes, only write a reference to the snapshots for MODES (modeDir/modeSource.info).",
+      Parameters::m_lazyModesOpt
+      );
+
+  ez::ezOptionValidator *vCov = new ez::ezOptionValidator("s1", "gele", "0,2");
+  opt.add(
+      "0", // 0 : Smaller of the two, 1 : T x T correlation matrix (method of snapshots), 2 : N x N spatial covariance matrix
+      0,
+      1,
+      0,
+      "Matrix decomposed by the POD.",
+      Parameters::m_covarianceOpt,
+      vCov
+      );
+
+  opt.add(
+      "0",
+      0,
+      1,
+      0,
+      "Preview: number of points drawn from every file to estimate the spectrum with error bars (0: full POD).",
+      Parameters::m_previewPointsOpt,
+      vS4
+      );
+
+  opt.add(
+      "1",
+      0,
+      1,
+      0,
+      "Preview: use every n-th snapshot only.",
+      Parameters::m_previewStrideOpt,
+      vS4
+      );
+
+  ez::ezOptionValidator *vSampling = new ez::ezOptionValidator("s1", "gele", "0,1");
+  opt.add(
+      "1", // 0 : Uniform, 1 : Leverage scores of a pilot set of snapshots, mixed with uniform
+      0,
+      1,
+      0,
+      "Preview: sampling of the points.",
+      Parameters::m_previewSamplingOpt,
+      vSampling
+      );
+
+  opt.add(
+      "",
+      0,
+      0,
+      0,
+      "Preview: compute the modes from the full rows of the previewed snapshots in one more pass.",
+      Parameters::m_previewModesOpt
+      );
+
+  ez::ezOptionValidator *vScalar = new ez::ezOptionValidator("s1", "gele", "0,2");
+  opt.add(
+      "0", // 0 : double, 1 : float, 2 : complex (pairs of columns: real, imaginary)
+      0,
+      1,
+      0,
+      "Scalar type of the snapshots, chronos and modes.",
+      Parameters::m_scalarOpt,
+      vScalar
+      );
+
+  ez::ezOptionValidator *vLayout = new ez::ezOptionValidator("s1", "gele", "0,1");
+  opt.add(
+      "0", // 0 : Component-blocked (x of all points, then y...), 1 : Point-interleaved (x, y, z of each point)
+      0,
+      1,
+      0,
+      "Row layout of the snapshot and mode matrices.",
+      Parameters::m_layoutOpt,
+      vLayout
+      );
+
+  opt.add(
+      "",                                                                     // Default.
+      0,                                                                      // Required?
+      1,                                                                      // Number of args expected.
+      0,                                                                      // Delimiter if expecting multiple args.
+      "Shared snapshot segment: attached if published from the same files, else read and published (see PODSHM).", // Help description.
+      Parameters::m_shmNameOpt                                                // Flag token.
+      );
+
   // Perform the actual parsing of the command line.
   opt.parse(argc, argv);
 
@@ -407,6 +939,16 @@ int main(int argc, const char *argv[])
   if (opt.firstArgs.size() > 0)
     firstArg = *opt.firstArgs[0];
 
-  pod(opt);
+  simd_kernels() ;
+
+  try
+  {
+    pod(opt);
+  }
+  catch (const char *message)
+  {
+    std::cerr << "ERROR: " << message << ".\n\n";
+    return 1;
+  }
   return 0;
 }
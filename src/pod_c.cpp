@@ -0,0 +1,159 @@
+//
+// C interface of the in-memory POD library (libpod_c.so).
+//
+
+#include <string>
+#include <exception>
+#include <omp.h>
+
+#include "pod_c.h"
+#include "libpod.h"
+
+#define POD_C_EXPORT __attribute__((visibility("default")))
+
+/* Message of the last error, per calling thread */
+static thread_local std::string lastError ;
+
+/* Progress messages of the library, off unless asked for */
+static bool verbose(false) ;
+
+static int fail(const int status, const std::string &message)
+{
+  lastError = message ;
+  return status ;
+}
+
+/*
+Run f, turning the exceptions of the library into status codes: nothing may
+be thrown across the C boundary.
+*/
+template <typename F>
+static int guarded(F f)
+{
+  lastError.clear() ;
+  try
+  {
+    set_library_verbose(verbose) ;
+    return f() ;
+  }
+  catch (const char *e)
+  {
+    return fail(POD_C_FAILURE, e) ;
+  }
+  catch (const std::exception &e)
+  {
+    return fail(POD_C_FAILURE, e.what()) ;
+  }
+  catch (...)
+  {
+    return fail(POD_C_FAILURE, "Unknown error") ;
+  }
+}
+
+extern "C" {
+
+POD_C_EXPORT int pod_c_abi_version(void)
+{
+  return POD_C_ABI_VERSION ;
+}
+
+POD_C_EXPORT const char *pod_c_last_error(void)
+{
+  return lastError.c_str() ;
+}
+
+POD_C_EXPORT void pod_c_set_threads(const int threads)
+{
+  if (threads > 0)
+    omp_set_num_threads(threads) ;
+}
+
+POD_C_EXPORT void pod_c_set_verbose(const int v)
+{
+  verbose = v != 0 ;
+}
+
+POD_C_EXPORT int pod_c_compute(const double *snapshots, const long rows, const long cols,
+                               const int podSize, const double targetRic, const int eigSolver,
+                               int *outPodSize, double *eigval, double *chronos, double *modes)
+{
+  return guarded([&]() {
+    if (!snapshots || !outPodSize || rows <= 0 || cols <= 0 || podSize <= 0)
+      return fail(POD_C_INVALID_ARGUMENT, "pod_c_compute: null snapshots or POD size, or empty snapshots") ;
+    if (eigSolver < EIG_FULL || eigSolver > EIG_DIVIDE_CONQUER)
+      return fail(POD_C_INVALID_ARGUMENT, "pod_c_compute: unknown eigen-solver") ;
+
+    const SnapshotSource source(snapshots, rows, cols) ;
+    GramAccumulator gram ;
+    gram.update(source) ;
+    MatrixXd pm ;
+    gram.release(pm) ;
+    const PodBasis basis(pm, podSize, targetRic, eigSolver) ;
+    const int size(basis.size()) ;
+
+    if (eigval)
+    {
+      Map<VectorXd> values(eigval, cols) ;
+      const VectorXd computed(basis.eigenvalues()) ;
+      values.setZero() ;
+      values.head(computed.size()) = computed ;
+    }
+    if (chronos)
+      Map<MatrixXd>(chronos, cols, size) = basis.chronos().transpose() ;
+    if (modes)
+      basis.mode_rows(source, 0, rows, Map<MatrixXd>(modes, rows, size)) ;
+
+    *outPodSize = size ;
+    return (int)POD_C_OK ;
+  }) ;
+}
+
+POD_C_EXPORT int pod_c_project(const double *modes, const long rows, const long modesSize,
+                               const double *snapshots, const long cols, double *coeffs)
+{
+  return guarded([&]() {
+    if (!modes || !snapshots || !coeffs || rows <= 0 || modesSize <= 0 || cols < 0)
+      return fail(POD_C_INVALID_ARGUMENT, "pod_c_project: null buffer or empty modes") ;
+
+    const Projector projector(modes, rows, modesSize) ;
+    projector.coefficients(Map<const MatrixXd>(snapshots, rows, cols), Map<MatrixXd>(coeffs, modesSize, cols)) ;
+    return (int)POD_C_OK ;
+  }) ;
+}
+
+POD_C_EXPORT int pod_c_reconstruct(const double *modes, const long rows, const long modesSize,
+                                   const double *coeffs, const long cols, double *fields)
+{
+  return guarded([&]() {
+    if (!modes || !coeffs || !fields || rows <= 0 || modesSize <= 0 || cols < 0)
+      return fail(POD_C_INVALID_ARGUMENT, "pod_c_reconstruct: null buffer or empty modes") ;
+
+    const Projector projector(modes, rows, modesSize) ;
+    projector.reconstruct(Map<const MatrixXd>(coeffs, modesSize, cols), Map<MatrixXd>(fields, rows, cols)) ;
+    return (int)POD_C_OK ;
+  }) ;
+}
+
+POD_C_EXPORT int pod_c_projection_error(const double *snapshots, const long rows, const long cols,
+                                        const double *coeffs, const long modesSize,
+                                        double *snapError, double *globalError, double *energy)
+{
+  return guarded([&]() {
+    if (!snapshots || !coeffs || rows <= 0 || cols <= 0 || modesSize <= 0)
+      return fail(POD_C_INVALID_ARGUMENT, "pod_c_projection_error: null buffer or empty snapshots") ;
+
+    const Map<const MatrixXd> m(snapshots, rows, cols) ;
+    VectorXd global, captured ;
+    const MatrixXd errors(projection_error_curves<double>(m.colwise().squaredNorm().transpose(),
+                                                          Map<const MatrixXd>(coeffs, modesSize, cols), global, captured)) ;
+    if (snapError)
+      Map<MatrixXd>(snapError, modesSize, cols) = errors ;
+    if (globalError)
+      Map<VectorXd>(globalError, modesSize) = global ;
+    if (energy)
+      Map<VectorXd>(energy, modesSize) = captured ;
+    return (int)POD_C_OK ;
+  }) ;
+}
+
+}
@@ -0,0 +1,104 @@
+//
+// C interface of the in-memory POD library (libpod_c.so).
+//
+
+#ifndef POD_POD_C_H
+#define POD_POD_C_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+Stable C ABI over libpod, for callers in C or in languages with a C foreign
+function interface (Python ctypes and NumPy arrays, Fortran, Julia, ...).
+
+All the matrices are caller-allocated contiguous buffers of doubles in
+column-major order, read and written in place without any copy or
+serialisation: a rows x cols matrix is cols columns of rows values one after
+the other, i.e. a C-ordered NumPy array of shape (cols, rows). Snapshots are
+the columns (one field of rows values per time), as in the binary files of
+POD.
+
+Every function returns POD_C_OK, or an error code with a message available
+from pod_c_last_error(); the library neither throws nor aborts the host
+process. It prints nothing unless pod_c_set_verbose is called. Threads are
+the OpenMP ones.
+*/
+
+#define POD_C_ABI_VERSION 1
+
+enum PodCStatus {
+  POD_C_OK = 0,                // Success
+  POD_C_INVALID_ARGUMENT = 1,  // Null buffer or inconsistent sizes
+  POD_C_FAILURE = 2            // Failure of the computation
+};
+
+/*
+ABI version the library was built with (POD_C_ABI_VERSION).
+*/
+int pod_c_abi_version(void) ;
+
+/*
+Message of the last error of the calling thread, empty if none.
+*/
+const char *pod_c_last_error(void) ;
+
+/*
+Number of OpenMP threads of the following calls.
+*/
+void pod_c_set_threads(int threads) ;
+
+/*
+Print the progress messages of the library (eigen-solver, kernel selection)
+to the standard output if verbose is non-zero. Off by default.
+*/
+void pod_c_set_verbose(int verbose) ;
+
+/*
+POD of cols snapshots of rows values with the given eigen-solver (0 full,
+1 Lanczos, 2 divide-and-conquer, as -eig), keeping the smallest number of
+modes reaching the relative information content targetRic, and at most
+podSize. *outPodSize gets that number k, and the first k columns of the
+buffers are written:
+  eigval   cols             eigenvalues, descending, zero beyond the ones
+                            computed by Lanczos (NULL to skip)
+  chronos  cols x podSize   chronos of mode i in column i (NULL to skip)
+  modes    rows x podSize   mode i in column i (NULL to skip)
+The chronos are stored times x modes, the transpose of chronos.bin, so that
+both the modes and the chronos of mode i are contiguous.
+*/
+int pod_c_compute(const double *snapshots, long rows, long cols,
+                  int podSize, double targetRic, int eigSolver,
+                  int *outPodSize, double *eigval, double *chronos, double *modes) ;
+
+/*
+Coefficients (modesSize x cols) of cols snapshots on orthonormal modes
+(rows x modesSize).
+*/
+int pod_c_project(const double *modes, long rows, long modesSize,
+                  const double *snapshots, long cols, double *coeffs) ;
+
+/*
+Fields (rows x cols) reconstructed from coefficients (modesSize x cols) on
+the modes (rows x modesSize).
+*/
+int pod_c_reconstruct(const double *modes, long rows, long modesSize,
+                      const double *coeffs, long cols, double *fields) ;
+
+/*
+Projection error of cols snapshots for every rank 1..modesSize, from their
+coefficients (modesSize x cols) on an orthonormal basis, as REC -err:
+  snapError    modesSize x cols  relative error of snapshot j at rank i+1 (NULL to skip)
+  globalError  modesSize         relative error of the snapshot set (NULL to skip)
+  energy       modesSize         fraction of the energy captured (NULL to skip)
+*/
+int pod_c_projection_error(const double *snapshots, long rows, long cols,
+                           const double *coeffs, long modesSize,
+                           double *snapError, double *globalError, double *energy) ;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //POD_POD_C_H
@@ -0,0 +1,528 @@
+//
+// POD and REC jobs of a manifest run in one process: the snapshots of a job
+// are read while the previous job computes, and every time directory is
+// traversed once for all the fields read from it.
+//
+
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <Eigen/Dense>
+#include "ezOptionParser.hpp"
+#include <omp.h>
+#include <sys/stat.h>
+
+#include "utils.h"
+#include "simd.h"
+#include "taskgraph.h"
+#include "rawformat.h"
+#include "libpod.h"
+
+/*
+Snapshot matrix of the jobs reading the same files the same way, at the same
+times.
+*/
+struct BatchInput {
+  std::string dataFileName ;
+  long varSize ;
+  long offset ;
+  int layout ;
+  std::vector<std::string> times ;
+  size_t group ;
+  std::vector<long> columns ;  // time directory of the group of every snapshot
+  MatrixXd snapshots ;
+  long users ;          // jobs still to use the snapshots, freed after the last one
+} ;
+
+/*
+Inputs read from the same input directory: the union of their time lists is
+traversed once.
+*/
+struct BatchGroup {
+  std::string inputDirName ;
+  std::vector<std::string> times ;
+  std::vector<size_t> inputs ;
+  double start ;
+  double end ;
+  double megabytes ;
+} ;
+
+struct BatchJob {
+  BatchJob(const std::string &name, const bool pod, ez::ezOptionParser &opt) :
+  m_name(name), m_pod(pod), m_params(opt), m_input(0), m_start(0.), m_end(0.), m_resident(0.), m_peak(0.) {}
+
+  std::string m_name ;
+  bool m_pod ;          // POD, else REC
+  Parameters m_params ;
+  size_t m_input ;
+  double m_start ;
+  double m_end ;
+  double m_resident ;   // MB at the end of the job
+  double m_peak ;
+} ;
+
+/*
+Options of the job lines, as on the command lines of POD and REC.
+*/
+static void add_job_options(ez::ezOptionParser &opt)
+{
+  for (auto flag : {Parameters::m_varSizeOpt, Parameters::m_offsetOpt, Parameters::m_podSizeOpt,
+                    Parameters::m_inputDirNameOpt, Parameters::m_chronosDirNameOpt, Parameters::m_modeDirNameOpt,
+                    Parameters::m_timesFileNameOpt, Parameters::m_dataFileNameOpt, Parameters::m_targetRicOpt,
+                    Parameters::m_recDirNameOpt, Parameters::m_pointsFileNameOpt, Parameters::m_layoutOpt,
+                    Parameters::m_eigSolverOpt})
+    opt.add("", 0, 1, 0, "", flag) ;
+  for (auto flag : {Parameters::m_errorCurvesOpt, Parameters::m_writeRawOpt})
+    opt.add("", 0, 0, 0, "", flag) ;
+}
+
+static void check_directory(const std::string &dir, const std::string &job)
+{
+  struct stat info ;
+  if (stat(dir.c_str(), &info) != 0 || !(info.st_mode & S_IFDIR))
+  {
+    std::cerr << "ERROR: " << dir << " (job " << job << ") is not a directory.\n\n" ;
+    throw "Invalid manifest" ;
+  }
+}
+
+/*
+Jobs of the manifest: one per line, "<name> POD|REC <options>", '#' starting
+a comment.
+*/
+static std::vector<std::unique_ptr<BatchJob>> read_manifest(const std::string &fname)
+{
+  std::ifstream manifest(fname) ;
+  if (!manifest.is_open())
+    throw "Could not open the manifest" ;
+
+  std::vector<std::unique_ptr<BatchJob>> jobs ;
+  std::string line ;
+  while (std::getline(manifest, line))
+  {
+    line = line.substr(0, line.find('#')) ;
+    std::istringstream tokens(line) ;
+    std::string name, program, token ;
+    if (!(tokens >> name))
+      continue ;
+    if (!(tokens >> program) || (program != "POD" && program != "REC"))
+    {
+      std::cerr << "ERROR: Job " << name << " is neither POD nor REC.\n\n" ;
+      throw "Invalid manifest" ;
+    }
+
+    std::vector<std::string> args = {program} ;
+    while (tokens >> token)
+      args.push_back(token) ;
+    std::vector<const char*> argv ;
+    for (const auto &arg : args)
+      argv.push_back(arg.c_str()) ;
+
+    ez::ezOptionParser opt ;
+    add_job_options(opt) ;
+    opt.parse(argv.size(), argv.data()) ;
+    if (!opt.unknownArgs.empty() || !opt.lastArgs.empty())
+    {
+      std::cerr << "ERROR: Unsupported option or argument "
+                << *(opt.unknownArgs.empty() ? opt.lastArgs : opt.unknownArgs)[0] << " in job " << name << ".\n\n" ;
+      throw "Invalid manifest" ;
+    }
+
+    const bool pod(program == "POD") ;
+    std::vector<const char*> required = {Parameters::m_inputDirNameOpt, Parameters::m_timesFileNameOpt,
+                                         Parameters::m_dataFileNameOpt, Parameters::m_varSizeOpt,
+                                         Parameters::m_modeDirNameOpt} ;
+    if (pod)
+      required.insert(required.end(), {Parameters::m_chronosDirNameOpt, Parameters::m_podSizeOpt,
+                                       Parameters::m_targetRicOpt}) ;
+    else
+      required.push_back(Parameters::m_recDirNameOpt) ;
+    for (auto flag : required)
+    {
+      if (!opt.isSet(flag))
+      {
+        std::cerr << "ERROR: Missing option " << flag << " in job " << name << ".\n\n" ;
+        throw "Invalid manifest" ;
+      }
+    }
+
+    jobs.emplace_back(new BatchJob(name, pod, opt)) ;
+    const Parameters &params(jobs.back()->m_params) ;
+    check_directory(params.m_inputDirName, name) ;
+    check_directory(params.m_modeDirName, name) ;
+    check_directory(pod ? params.m_chronosDirName : params.m_recDirName, name) ;
+  }
+
+  if (jobs.empty())
+    throw "No job in the manifest" ;
+  return jobs ;
+}
+
+/*
+Read the snapshots of every input of the group, time directory by time
+directory, the directories being split over the threads. Every directory of
+the union of the time lists is visited once, for the inputs whose list holds
+it.
+*/
+static void read_group(BatchGroup &group, std::vector<BatchInput> &inputs)
+{
+  const long timesSize(group.times.size()) ;
+  std::vector<long> pointSizes ;
+  std::vector<std::vector<std::pair<size_t, long>>> readers(timesSize) ;
+  for (size_t k = 0; k < group.inputs.size(); k++)
+  {
+    BatchInput &input(inputs[group.inputs[k]]) ;
+    const pointCloudFileInfo info(read_pcf_info(group.inputDirName + "/" + input.times[0] + "/" + input.dataFileName)) ;
+    if (info.rows == 0)
+      throw "Could not read a snapshot file" ;
+    pointSizes.push_back(info.rows) ;
+    input.snapshots.resize(info.rows * input.varSize, input.times.size()) ;
+    group.megabytes += input.snapshots.size() * sizeof(double) / (1024. * 1024.) ;
+    for (size_t c = 0; c < input.columns.size(); c++)
+      readers[input.columns[c]].push_back({k, c}) ;
+  }
+
+#pragma omp parallel for schedule(dynamic)
+  for (long j = 0; j < timesSize; j++)
+  {
+    const std::string dir(group.inputDirName + "/" + group.times[j] + "/") ;
+    for (const auto &reader : readers[j])
+    {
+      BatchInput &input(inputs[group.inputs[reader.first]]) ;
+      read_pcf_to_column(dir + input.dataFileName, pointSizes[reader.first], input.varSize, input.offset,
+                         input.layout, input.snapshots.col(reader.second).data()) ;
+    }
+  }
+}
+
+static void run_pod(BatchJob &job, const MatrixXd &snapshots)
+{
+  Parameters &params(job.m_params) ;
+  const SnapshotSource source(snapshots.data(), snapshots.rows(), snapshots.cols()) ;
+  const long timesSize(source.size()) ;
+  if (params.m_podSize > timesSize)
+    params.m_podSize = timesSize ;
+
+  MatrixXd pm ;
+  GramAccumulator gram ;
+  gram.update(source) ;
+  gram.release(pm) ;
+  VectorXd snapNorm2 ;
+  if (params.m_errorCurves)
+    snapNorm2 = timesSize * pm.diagonal() ;
+
+  const PodBasis basis(pm, params.m_podSize, params.m_targetRic, params.m_eigSolver) ;
+  basis.write(source, params.m_chronosDirName, params.m_modeDirName, params.m_varSize, params.m_layout) ;
+
+  if (params.m_errorCurves)
+  {
+    VectorXd globalError, energy ;
+    MatrixXd snapError(projection_error_curves(snapNorm2, basis.chronos(basis.eigenvalues().size()),
+                                               globalError, energy)) ;
+    write_error_curves(params.m_chronosDirName, snapError, globalError, energy) ;
+  }
+  std::cout << "[" << job.m_name << "] " << basis.size() << " modes of " << timesSize << " snapshots written to "
+            << params.m_modeDirName << "." << std::endl ;
+}
+
+static void run_rec(BatchJob &job, const MatrixXd &snapshots)
+{
+  const Parameters &params(job.m_params) ;
+  const std::string modeFile(params.m_modeDirName + "/mode.bin") ;
+  const MatrixInfo info(read_matrix_info(modeFile)) ;
+  if (info.rows == 0)
+    throw "Missing mode file description (mode.bin.info)" ;
+  if (info.scalar != SCALAR_DOUBLE)
+    throw "Only modes of doubles are projected" ;
+  if (info.varSize > 0 && info.varSize != params.m_varSize)
+    throw "Values per point of the modes differ from -v" ;
+  if (info.rows != snapshots.rows())
+    throw "Snapshot size differs from the modes" ;
+  MatrixXd m(read_binary_matrix(modeFile, info.rows)) ;
+  convert_layout(m, params.m_varSize, info.layout, params.m_layout) ;
+
+  const Projector projector(m) ;
+  const MatrixXd c(projector.coefficients(snapshots)) ;
+  if (params.m_errorCurves)
+  {
+    VectorXd globalError, energy ;
+    MatrixXd snapError(projection_error_curves(snapshots.colwise().squaredNorm().transpose(), c,
+                                               globalError, energy, projector.gram())) ;
+    write_error_curves(params.m_recDirName, snapError, globalError, energy) ;
+  }
+
+  const MatrixXd rec(projector.reconstruct(c)) ;
+  std::ofstream writeField(params.m_recDirName + "/reconstruction.bin", std::ios::binary) ;
+  if (writeField.is_open()) {
+    writeField.write(reinterpret_cast<const char*>(rec.data()), rec.size() * sizeof(double)) ;
+    writeField.close() ;
+  }
+  write_matrix_info(params.m_recDirName + "/reconstruction.bin", rec.rows(), rec.cols(), params.m_varSize, params.m_layout) ;
+
+  if (params.m_writeRaw)
+  {
+    std::vector<std::string> coords ;
+    if (!params.m_pointsFileName.empty())
+      coords = read_point_coordinates(params.m_pointsFileName) ;
+    const std::string rawName(params.m_dataFileName.empty() ? "reconstruction.xy" : params.m_dataFileName) ;
+    write_raw_fields(params.m_recDirName, read_timefile(params.m_timesFileName), rawName, rec,
+                     params.m_varSize, params.m_layout, coords) ;
+  }
+  std::cout << "[" << job.m_name << "] " << rec.cols() << " snapshots reconstructed with " << m.cols()
+            << " modes in " << params.m_recDirName << "." << std::endl ;
+}
+
+static void report(std::ostream &out, const std::vector<std::unique_ptr<BatchJob>> &jobs,
+                   const std::vector<BatchGroup> &groups, const double origin, const double elapsed)
+{
+  double readingTime(0.), computingTime(0.) ;
+  out << std::fixed << std::setprecision(3) ;
+  out << "Reading (one traversal of the time directories per input directory):\n"
+      << std::setw(6) << "group" << std::setw(8) << "times" << std::setw(8) << "fields" << std::setw(12) << "MB"
+      << std::setw(10) << "start" << std::setw(10) << "end" << std::setw(10) << "time" << std::setw(10) << "MB/s"
+      << "  directory\n" ;
+  for (size_t g = 0; g < groups.size(); g++)
+  {
+    const BatchGroup &group(groups[g]) ;
+    const double time(group.end - group.start) ;
+    readingTime += time ;
+    out << std::setw(6) << g << std::setw(8) << group.times.size() << std::setw(8) << group.inputs.size()
+        << std::setw(12) << group.megabytes << std::setw(10) << group.start - origin << std::setw(10)
+        << group.end - origin << std::setw(10) << time << std::setw(10) << group.megabytes / std::max(time, 1.e-9)
+        << "  " << group.inputDirName << "\n" ;
+  }
+
+  out << "Jobs:\n"
+      << std::setw(16) << "name" << std::setw(6) << "prog" << std::setw(6) << "input" << std::setw(10) << "start"
+      << std::setw(10) << "end" << std::setw(10) << "time" << std::setw(14) << "resident MB" << std::setw(10)
+      << "peak MB" << "\n" ;
+  for (const auto &job : jobs)
+  {
+    computingTime += job->m_end - job->m_start ;
+    out << std::setw(16) << job->m_name << std::setw(6) << (job->m_pod ? "POD" : "REC") << std::setw(6)
+        << job->m_input << std::setw(10) << job->m_start - origin << std::setw(10) << job->m_end - origin
+        << std::setw(10) << job->m_end - job->m_start << std::setw(14) << job->m_resident << std::setw(10)
+        << job->m_peak << "\n" ;
+  }
+
+  double resident, peak ;
+  resident_memory_mb(resident, peak) ;
+  out << "Batch of " << jobs.size() << " jobs done in " << elapsed << "s (reading " << readingTime
+      << "s, computing " << computingTime << "s, " << std::max(readingTime + computingTime - elapsed, 0.)
+      << "s overlapped), peak memory " << peak << " MB." << std::endl ;
+  out << std::defaultfloat ;
+}
+
+void podbatch(ez::ezOptionParser &opt)
+{
+  const double origin(omp_get_wtime()) ;
+  Parameters params(opt) ;
+  omp_set_num_threads(params.m_threadsSize) ;
+
+  std::vector<std::unique_ptr<BatchJob>> jobs(read_manifest(params.m_manifestFileName)) ;
+
+  /* Inputs shared by the jobs reading the same files at the same times,
+  grouped by input directory over the union of their time lists */
+  std::vector<BatchInput> inputs ;
+  std::vector<BatchGroup> groups ;
+  std::vector<std::map<std::string, long>> groupColumns ;
+  for (size_t k = 0; k < jobs.size(); k++)
+  {
+    const Parameters &p(jobs[k]->m_params) ;
+    const std::vector<std::string> times(read_timefile(p.m_timesFileName)) ;
+    if (times.empty())
+      throw "Empty time list" ;
+
+    size_t g(0) ;
+    while (g < groups.size() && groups[g].inputDirName != p.m_inputDirName)
+      g++ ;
+    if (g == groups.size())
+    {
+      groups.push_back({p.m_inputDirName, {}, {}, 0., 0., 0.}) ;
+      groupColumns.emplace_back() ;
+    }
+
+    size_t i(0) ;
+    while (i < inputs.size() && !(inputs[i].group == g && inputs[i].dataFileName == p.m_dataFileName
+                                  && inputs[i].varSize == p.m_varSize && inputs[i].offset == p.m_offset
+                                  && inputs[i].layout == p.m_layout && inputs[i].times == times))
+      i++ ;
+    if (i == inputs.size())
+    {
+      inputs.push_back({p.m_dataFileName, p.m_varSize, p.m_offset, p.m_layout, times, g, {}, MatrixXd(), 0}) ;
+      groups[g].inputs.push_back(i) ;
+
+      /* Columns of the input in the union of the time lists of its group */
+      for (const auto &time : times)
+      {
+        const auto column(groupColumns[g].emplace(time, groups[g].times.size())) ;
+        if (column.second)
+          groups[g].times.push_back(time) ;
+        inputs[i].columns.push_back(column.first->second) ;
+      }
+    }
+    inputs[i].users++ ;
+    jobs[k]->m_input = i ;
+  }
+
+  std::cout << jobs.size() << " jobs reading " << inputs.size() << " snapshot sets from " << groups.size()
+            << " input directories.\n" << std::endl ;
+
+  /* Two lanes: the groups are read one after the other, and the jobs computed
+  one after the other in the order of the manifest (a REC job using the modes
+  of a POD job listed before it). A group is read while the job before its
+  first job computes, at most one group being read ahead. */
+  TaskGraph graph(2, params.m_threadsSize) ;
+  std::mutex inputsMutex ;
+  std::vector<TaskGraph::TaskId> jobTasks ;
+  std::vector<TaskGraph::TaskId> readTasks ;
+
+  for (size_t k = 0; k < jobs.size(); k++)
+  {
+    BatchJob &job(*jobs[k]) ;
+    BatchInput &input(inputs[job.m_input]) ;
+    if (input.group == readTasks.size())
+    {
+      const size_t g(input.group) ;
+      std::vector<TaskGraph::TaskId> deps ;
+      if (g > 0)
+        deps.push_back(readTasks[g - 1]) ;
+      if (k > 1)
+        deps.push_back(jobTasks[k - 2]) ;
+      readTasks.push_back(graph.add("Reading group " + std::to_string(g), [&, g]() {
+        groups[g].start = omp_get_wtime() ;
+        read_group(groups[g], inputs) ;
+        groups[g].end = omp_get_wtime() ;
+      }, deps)) ;
+    }
+
+    std::vector<TaskGraph::TaskId> deps = {readTasks[input.group]} ;
+    if (k > 0)
+      deps.push_back(jobTasks[k - 1]) ;
+    jobTasks.push_back(graph.add("Job " + job.m_name, [&]() {
+      job.m_start = omp_get_wtime() ;
+      if (job.m_pod)
+        run_pod(job, input.snapshots) ;
+      else
+        run_rec(job, input.snapshots) ;
+      {
+        std::lock_guard<std::mutex> lock(inputsMutex) ;
+        if (--input.users == 0)
+          input.snapshots = MatrixXd() ;
+      }
+      job.m_end = omp_get_wtime() ;
+      resident_memory_mb(job.m_resident, job.m_peak) ;
+    }, deps)) ;
+  }
+
+  graph.run() ;
+  graph.report(std::cout) ;
+  std::cout << std::endl ;
+
+  const double elapsed(omp_get_wtime() - origin) ;
+  report(std::cout, jobs, groups, origin, elapsed) ;
+  if (!params.m_outFileName.empty())
+  {
+    std::ofstream writeReport(params.m_outFileName) ;
+    if (writeReport.is_open())
+      report(writeReport, jobs, groups, origin, elapsed) ;
+  }
+}
+
+int main(int argc, const char *argv[])
+{
+  ez::ezOptionParser opt;
+
+  opt.overview = "Batch of POD and REC jobs";
+  opt.syntax = "Run the POD and REC jobs of a manifest in one process using [INPUTS] ...";
+  opt.example = "PODBATCH -manifest jobs.txt -np 4 -o batchReport.txt\n\n"
+                "with jobs.txt holding one job per line, as on the command lines of POD and REC:\n"
+                "podU POD -i postProcessing/internalField -tf times -pcfn cloud_U.xy -v 3 -nm 10 -ric 0.999 -c chronosU -m modesU\n"
+                "podP POD -i postProcessing/internalField -tf times -pcfn cloud_p.xy -v 1 -nm 10 -ric 0.999 -c chronosP -m modesP\n"
+                "recU REC -i postProcessing/internalField -tf times -pcfn cloud_U.xy -v 3 -m modesU -r recU -ec\n\n";
+  opt.footer = "\nThis program is free and without warranty.\n";
+
+  opt.add(
+      "",                            // Default.
+      0,                             // Required?
+      0,                             // Number of args expected.
+      0,                             // Delimiter if expecting multiple args.
+      "Display usage instructions.", // Help description.
+      "-h"                          // Flag token.
+      );
+
+  opt.add(
+      "",                                                          // Default.
+      1,                                                           // Required?
+      1,                                                           // Number of args expected.
+      0,                                                           // Delimiter if expecting multiple args.
+      "Manifest file: one job per line, \"<name> POD|REC <options>\".", // Help description.
+      Parameters::m_manifestFileNameOpt                            // Flag token.
+      );
+
+  ez::ezOptionValidator *vS4 = new ez::ezOptionValidator("s4", "ge", "0");
+  opt.add(
+      "1",                                           // Default.
+      0,                                             // Required?
+      1,                                             // Number of args expected.
+      0,                                             // Delimiter if expecting multiple args.
+      "Number of OpenMP threads.",                   // Help description.
+      Parameters::m_threadsSizeOpt,                  // Flag token.
+      vS4                                            // Validate input
+      );
+
+  opt.add(
+      "",                                             // Default.
+      0,                                              // Required?
+      1,                                              // Number of args expected.
+      0,                                              // Delimiter if expecting multiple args.
+      "File the timing and memory report is also written to.", // Help description.
+      Parameters::m_outFileNameOpt                    // Flag token.
+      );
+
+  // Perform the actual parsing of the command line.
+  opt.parse(argc, argv);
+
+  if (opt.isSet("-h"))
+  {
+    Usage(opt);
+    return 1;
+  }
+
+  std::vector<std::string> badOptions;
+  int i;
+  if (!opt.gotRequired(badOptions))
+  {
+    for (i = 0; i < badOptions.size(); ++i)
+      std::cerr << "ERROR: Missing required option " << badOptions[i] << ".\n\n";
+
+    Usage(opt);
+    return 1;
+  }
+
+  if (!opt.gotExpected(badOptions))
+  {
+    for (i = 0; i < badOptions.size(); ++i)
+      std::cerr << "ERROR: Got unexpected number of arguments for option " << badOptions[i] << ".\n\n";
+
+    Usage(opt);
+    return 1;
+  }
+
+  simd_kernels() ;
+
+  try
+  {
+    podbatch(opt) ;
+  }
+  catch (const char *message)
+  {
+    std::cerr << "ERROR: " << message << ".\n\n";
+    return 1;
+  }
+
+  return 0;
+}
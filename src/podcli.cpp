@@ -0,0 +1,457 @@
+//
+// Client of the resident basis server (PODSRV): projection of snapshot files,
+// reconstruction and probing of chronos, server counters, and a load
+// generator measuring the latency seen by the clients.
+//
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <Eigen/Dense>
+#include "ezOptionParser.hpp"
+#include <omp.h>
+#include <sys/stat.h>
+
+#include "utils.h"
+#include "simd.h"
+#include "libpod.h"
+#include "basisserver.h"
+
+/*
+One request of the selected kind for the columns in, on the first rank modes.
+*/
+static MatrixXd send_request(BasisClient &client, const int type, const Ref<const MatrixXd> &in, const long rank,
+                             const std::vector<int64_t> &points)
+{
+  if (type == BASIS_PROJECT)
+    return client.project(in, rank) ;
+  if (type == BASIS_RECONSTRUCT)
+    return client.reconstruct(in) ;
+  return client.probe(points, in) ;
+}
+
+/*
+Probe points from the point indices file (one index per line), or the first
+ten points.
+*/
+static std::vector<int64_t> probe_points(const Parameters &params)
+{
+  std::vector<int64_t> points ;
+  if (params.m_pointIndicesFileName.empty())
+  {
+    for (int64_t p = 0; p < 10; p++)
+      points.push_back(p) ;
+    return points ;
+  }
+  for (const auto &line : read_timefile(params.m_pointIndicesFileName))
+  {
+    if (!line.empty())
+      points.push_back(std::stol(line)) ;
+  }
+  return points ;
+}
+
+/*
+Closed-loop load: every connection sends its share of the requests one after
+the other. Prints the percentiles of the latencies and the throughput.
+*/
+static void benchmark(const Parameters &params, const BasisInfo &info, const int type, const long rank,
+                      const std::vector<int64_t> &points, const long batchSize, const long requestsSize,
+                      const int connectionsSize)
+{
+  std::vector<std::vector<double>> latencies(connectionsSize) ;
+  std::vector<std::string> errors(connectionsSize) ;
+
+  std::cout << "Sending " << requestsSize << " " << (type == BASIS_PROJECT ? "projection" : type == BASIS_RECONSTRUCT
+            ? "reconstruction" : "probe") << " requests of " << batchSize << " columns over " << connectionsSize
+            << " connections..." << std::flush ;
+  const double start(omp_get_wtime()) ;
+  std::vector<std::thread> threads ;
+  for (int k = 0; k < connectionsSize; k++)
+  {
+    threads.emplace_back([&, k]() {
+      try
+      {
+        BasisClient client(params.m_socketName) ;
+        const MatrixXd in(MatrixXd::Random(type == BASIS_PROJECT ? info.rows : rank, batchSize)) ;
+        for (long r = k; r < requestsSize; r += connectionsSize)
+        {
+          const double sent(omp_get_wtime()) ;
+          send_request(client, type, in, rank, points) ;
+          latencies[k].push_back(omp_get_wtime() - sent) ;
+        }
+      }
+      catch (const char *message)
+      {
+        errors[k] = message ;
+      }
+    }) ;
+  }
+  for (auto &thread : threads)
+    thread.join() ;
+  const double elapsed(omp_get_wtime() - start) ;
+  std::cout << "\t Done in " << elapsed << "s \n" << std::endl ;
+
+  for (const auto &error : errors)
+  {
+    if (!error.empty())
+      std::cerr << "ERROR: " << error << ".\n" << std::endl ;
+  }
+
+  std::vector<double> all ;
+  for (const auto &l : latencies)
+    all.insert(all.end(), l.begin(), l.end()) ;
+  if (all.empty())
+    return ;
+  std::sort(all.begin(), all.end()) ;
+  auto percentile = [&all](const double q) { return all[(long)(q * (all.size() - 1))] * 1.e3 ; } ;
+  std::cout << "Client latency p50 " << percentile(0.5) << " ms, p99 " << percentile(0.99) << " ms, max "
+            << all.back() * 1.e3 << " ms; " << all.size() / elapsed << " requests/s, "
+            << all.size() * batchSize / elapsed << " columns/s.\n" << std::endl ;
+}
+
+void podcli(ez::ezOptionParser &opt)
+{
+  Parameters params(opt) ;
+  BasisClient client(params.m_socketName) ;
+
+  if (opt.isSet("-stop"))
+  {
+    client.stop() ;
+    std::cout << "Server stopping." << std::endl ;
+    return ;
+  }
+
+  const BasisInfo info(client.info()) ;
+  std::cout << "Basis of " << info.modes << " modes of " << info.rows << " rows (" << info.varSize
+            << " values per point, " << layout_name(info.layout) << " layout).\n" << std::endl ;
+  if (opt.isSet("-info"))
+    return ;
+
+  const int type(opt.isSet("-reconstruct") ? BASIS_RECONSTRUCT : opt.isSet("-probe") ? BASIS_PROBE
+                 : opt.isSet("-project") || opt.isSet("-bench") ? BASIS_PROJECT : -1) ;
+  const long rank(params.m_recRank > 0 ? std::min<long>(params.m_recRank, info.modes) : info.modes) ;
+  const std::vector<int64_t> points(type == BASIS_PROBE ? probe_points(params) : std::vector<int64_t>()) ;
+  const long batchSize(opt.isSet(Parameters::m_batchColumnsOpt) ? params.m_batchColumns
+                       : opt.isSet("-bench") ? 1 : 256) ;
+
+  if (opt.isSet("-bench"))
+  {
+    int requestsSize(1000), connectionsSize(1) ;
+    opt.get("-bench")->getInt(requestsSize) ;
+    if (opt.isSet("-cc"))
+      opt.get("-cc")->getInt(connectionsSize) ;
+    benchmark(params, info, type, rank, points, batchSize, requestsSize, std::max(connectionsSize, 1)) ;
+  }
+  else if (type >= 0)
+  {
+    // READING THE INPUT COLUMNS
+    double start(omp_get_wtime()) ;
+    MatrixXd in ;
+    if (type == BASIS_PROJECT)
+    {
+      std::cout << "Reading snapshots files..." << std::flush ;
+      if (params.m_inputDirName.empty() || params.m_timesFileName.empty() || params.m_dataFileName.empty())
+        throw "Projecting needs -i, -tf and -pcfn" ;
+      std::vector<std::string> pcfs ;
+      for (const auto &time : read_timefile(params.m_timesFileName))
+        pcfs.push_back(params.m_inputDirName + "/" + time + "/" + params.m_dataFileName) ;
+      omp_set_num_threads(std::max(params.m_threadsSize, 1)) ;
+      in = SnapshotSource::read(pcfs, info.varSize, params.m_offset, info.layout).matrix() ;
+      if (in.rows() != info.rows)
+        throw "Snapshot size differs from the modes" ;
+    }
+    else
+    {
+      std::cout << "Reading chronos..." << std::flush ;
+      if (params.m_chronosDirName.empty())
+        throw "Reconstructing and probing need -c" ;
+      require_double_matrix(params.m_chronosDirName + "/chronos.bin") ;
+      in = read_binary_matrix(params.m_chronosDirName + "/chronos.bin", info.modes).topRows(rank) ;
+    }
+    std::cout << "\t\t\t Done in " << omp_get_wtime() - start << "s \n" << std::endl ;
+
+    // SENDING THE REQUESTS
+    start = omp_get_wtime() ;
+    std::cout << "Sending " << in.cols() << " columns in requests of " << batchSize << "..." << std::flush ;
+    MatrixXd out ;
+    for (long c0 = 0; c0 < in.cols(); c0 += batchSize)
+    {
+      const long cols(std::min(batchSize, in.cols() - c0)) ;
+      const MatrixXd part(send_request(client, type, in.middleCols(c0, cols), rank, points)) ;
+      if (c0 == 0)
+        out.resize(part.rows(), in.cols()) ;
+      out.middleCols(c0, cols) = part ;
+    }
+    const double elapsed(omp_get_wtime() - start) ;
+    const long requestsSize((in.cols() + batchSize - 1) / batchSize) ;
+    std::cout << "\t Done in " << elapsed << "s (" << elapsed * 1.e3 / std::max(requestsSize, 1L)
+              << " ms per request) \n" << std::endl ;
+
+    if (type == BASIS_PROJECT)
+      std::cout << "Relative residual: mean " << out.row(rank).mean() << ", max " << out.row(rank).maxCoeff()
+                << ".\n" << std::endl ;
+
+    if (!params.m_outFileName.empty())
+    {
+      std::ofstream writeOut(params.m_outFileName, std::ios::binary) ;
+      if (!writeOut.is_open())
+        throw "Could not write the output file" ;
+      writeOut.write(reinterpret_cast<const char*>(out.data()), out.size() * sizeof(double)) ;
+      writeOut.close() ;
+      if (type == BASIS_RECONSTRUCT)
+        write_matrix_info(params.m_outFileName, out.rows(), out.cols(), info.varSize, info.layout) ;
+      else
+        write_matrix_info(params.m_outFileName, out.rows(), out.cols(),
+                          type == BASIS_PROBE ? info.varSize : 1, LAYOUT_INTERLEAVED) ;
+      std::cout << "Wrote " << out.rows() << " x " << out.cols() << " values to " << params.m_outFileName << ".\n"
+                << std::endl ;
+    }
+  }
+
+  if (opt.isSet("-stats") || opt.isSet("-bench"))
+    std::cout << client.stats() << std::endl ;
+}
+
+int main(int argc, const char *argv[])
+{
+  ez::ezOptionParser opt;
+
+  opt.overview = "Resident basis server client";
+  opt.syntax = "Send projection, reconstruction or probe requests to PODSRV using [INPUTS] ...";
+  opt.example = "PODCLI -sock /tmp/pod.sock -project -i postProcessing/internalField -tf snapshotTimes -pcfn cloud_U.xy -o coeffs.bin\n"
+                "PODCLI -sock /tmp/pod.sock -probe -c chronos -pidx probes -rank 4 -o probes.bin\n"
+                "PODCLI -sock /tmp/pod.sock -bench 10000 -cc 8 -reconstruct\n\n";
+  opt.footer = "\nThis program is free and without warranty.\n";
+
+  opt.add(
+      "",                            // Default.
+      0,                             // Required?
+      0,                             // Number of args expected.
+      0,                             // Delimiter if expecting multiple args.
+      "Display usage instructions.", // Help description.
+      "-h"                          // Flag token.
+      );
+
+  opt.add(
+      "",                            // Default.
+      1,                             // Required?
+      1,                             // Number of args expected.
+      0,                             // Delimiter if expecting multiple args.
+      "Unix-domain socket path.",    // Help description.
+      Parameters::m_socketNameOpt    // Flag token.
+      );
+
+  opt.add(
+      "",
+      0,
+      0,
+      0,
+      "Describe the basis served.",
+      "-info"
+      );
+
+  opt.add(
+      "",
+      0,
+      0,
+      0,
+      "Print the counters of the server (request counts, throughputs and p50/p99 latencies).",
+      "-stats"
+      );
+
+  opt.add(
+      "",
+      0,
+      0,
+      0,
+      "Stop the server.",
+      "-stop"
+      );
+
+  opt.add(
+      "",
+      0,
+      0,
+      0,
+      "Project the snapshot files (-i, -tf, -pcfn): coefficients and relative residuals.",
+      "-project"
+      );
+
+  opt.add(
+      "",
+      0,
+      0,
+      0,
+      "Reconstruct the fields from the chronos (-c).",
+      "-reconstruct"
+      );
+
+  opt.add(
+      "",
+      0,
+      0,
+      0,
+      "Reconstruct the points of -pidx (the first ten by default) from the chronos (-c).",
+      "-probe"
+      );
+
+  ez::ezOptionValidator *vS4 = new ez::ezOptionValidator("s4", "ge", "0");
+  opt.add(
+      "",                                                                          // Default.
+      0,                                                                           // Required?
+      1,                                                                           // Number of args expected.
+      0,                                                                           // Delimiter if expecting multiple args.
+      "Send this many requests of random columns (projections by default) and report the latencies.", // Help description.
+      "-bench",                                                                    // Flag token.
+      vS4                                                                          // Validate input
+      );
+
+  opt.add(
+      "1",                                         // Default.
+      0,                                           // Required?
+      1,                                           // Number of args expected.
+      0,                                           // Delimiter if expecting multiple args.
+      "Number of concurrent connections (with -bench).", // Help description.
+      "-cc",                                       // Flag token.
+      vS4                                          // Validate input
+      );
+
+  ez::ezOptionValidator *vS4Pos = new ez::ezOptionValidator("s4", "gt", "0");
+  opt.add(
+      "",                                      // Default.
+      0,                                       // Required?
+      1,                                       // Number of args expected.
+      0,                                       // Delimiter if expecting multiple args.
+      "Number of columns per request (1 with -bench, 256 otherwise).", // Help description.
+      Parameters::m_batchColumnsOpt,           // Flag token.
+      vS4Pos                                   // Validate input
+      );
+
+  opt.add(
+      "",                                                   // Default.
+      0,                                                    // Required?
+      1,                                                    // Number of args expected.
+      0,                                                    // Delimiter if expecting multiple args.
+      "Number of modes used (all by default).",             // Help description.
+      Parameters::m_recRankOpt,                             // Flag token.
+      vS4                                                   // Validate input
+      );
+
+  opt.add(
+      "",                                                                // Default.
+      0,                                                                 // Required?
+      1,                                                                 // Number of args expected.
+      0,                                                                 // Delimiter if expecting multiple args.
+      "Directory where the time directories reside as sub-directories.", // Help description.
+      Parameters::m_inputDirNameOpt                                      // Flag token.
+      );
+
+  opt.add(
+      "",                             // Default.
+      0,                              // Required?
+      1,                              // Number of args expected.
+      0,                              // Delimiter if expecting multiple args.
+      "File with time snapshot list", // Help description.
+      Parameters::m_timesFileNameOpt  // Flag token.
+      );
+
+  opt.add(
+      "",                                             // Default.
+      0,                                              // Required?
+      1,                                              // Number of args expected.
+      0,                                              // Delimiter if expecting multiple args.
+      "Point cloud file name (in time directories).", // Help description.
+      Parameters::m_dataFileNameOpt                   // Flag token.
+      );
+
+  opt.add(
+      "0",                                                 // Default.
+      0,                                                   // Required?
+      1,                                                   // Number of args expected.
+      0,                                                   // Delimiter if expecting multiple args.
+      "Point cloud file column offset (for reading data)", // Help description.
+      Parameters::m_offsetOpt,                             // Flag token.
+      vS4                                                  // Validate input
+      );
+
+  opt.add(
+      "",                            // Default.
+      0,                             // Required?
+      1,                             // Number of args expected.
+      0,                             // Delimiter if expecting multiple args.
+      "Number of parallel threads (for reading).", // Help description.
+      Parameters::m_threadsSizeOpt,  // Flag token.
+      vS4                            // Validate input
+      );
+
+  opt.add(
+      "",                                  // Default.
+      0,                                   // Required?
+      1,                                   // Number of args expected.
+      0,                                   // Delimiter if expecting multiple args.
+      "Chronos directory (chronos.bin).",  // Help description.
+      Parameters::m_chronosDirNameOpt      // Flag token.
+      );
+
+  opt.add(
+      "",                                                // Default.
+      0,                                                 // Required?
+      1,                                                 // Number of args expected.
+      0,                                                 // Delimiter if expecting multiple args.
+      "File of the probe point indices, one per line.",  // Help description.
+      Parameters::m_pointIndicesFileNameOpt              // Flag token.
+      );
+
+  opt.add(
+      "",                                                             // Default.
+      0,                                                              // Required?
+      1,                                                              // Number of args expected.
+      0,                                                              // Delimiter if expecting multiple args.
+      "Output file of the answers (column-major doubles, with .info).", // Help description.
+      Parameters::m_outFileNameOpt                                    // Flag token.
+      );
+
+  // Perform the actual parsing of the command line.
+  opt.parse(argc, argv);
+
+  if (opt.isSet("-h") || argc < 2)
+  {
+    Usage(opt);
+    return 1;
+  }
+
+  std::vector<std::string> badOptions;
+  int i;
+  if (!opt.gotRequired(badOptions))
+  {
+    for (i = 0; i < badOptions.size(); ++i)
+      std::cerr << "ERROR: Missing required option " << badOptions[i] << ".\n\n";
+
+    Usage(opt);
+    return 1;
+  }
+
+  if (!opt.gotExpected(badOptions))
+  {
+    for (i = 0; i < badOptions.size(); ++i)
+      std::cerr << "ERROR: Got unexpected number of arguments for option " << badOptions[i] << ".\n\n";
+
+    Usage(opt);
+    return 1;
+  }
+
+  simd_kernels() ;
+
+  try
+  {
+    podcli(opt) ;
+  }
+  catch (const char *message)
+  {
+    std::cerr << "ERROR: " << message << ".\n\n";
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,540 @@
+//
+// POD, reconstruction, error metrics and VTK output of one snapshot set in a
+// single process (runscript.pod, runscript.pod.reconstruct and the plot
+// scripts), the snapshots being read once.
+//
+
+#include <iostream>
+#include <iomanip>
+#include <Eigen/Dense>
+#include "ezOptionParser.hpp"
+#include <omp.h>
+#include <sys/stat.h>
+
+#include "utils.h"
+#include "simd.h"
+#include "taskgraph.h"
+#include "rawformat.h"
+#include "vtkformat.h"
+#include "libpod.h"
+#include "shmsnapshots.h"
+
+/*
+Name of the field in the VTK files, from the point cloud file name
+(cloud_U.xy: U).
+*/
+static std::string field_name(const std::string &dataFileName)
+{
+  std::string name(dataFileName.substr(0, dataFileName.find_last_of('.'))) ;
+  if (name.compare(0, 6, "cloud_") == 0 && name.size() > 6)
+    name = name.substr(6) ;
+  return name ;
+}
+
+/*
+Error of the reconstruction of every snapshot, written to
+recDir/reconstructionError.dat (time, L2 error, relative L2 error, maximum
+pointwise error). Returns the normalised RMS error of cloudReconstructError.py,
+sum_j (|m_j - r_j| / |m_j|) / sqrt(T P).
+*/
+static double reconstruction_error(const Parameters &params,
+                                   const std::vector<std::string> &times,
+                                   const Map<const MatrixXd> &m,
+                                   const MatrixXd &rec)
+{
+  const long TSIZE(m.cols()) ;
+  const long pointSize(m.rows() / params.m_varSize) ;
+  VectorXd absError(TSIZE), relError(TSIZE), maxError(TSIZE) ;
+
+#pragma omp parallel for schedule(static)
+  for (long j = 0; j < TSIZE; j++)
+  {
+    const double norm(m.col(j).norm()) ;
+    absError(j) = (m.col(j) - rec.col(j)).norm() ;
+    relError(j) = norm > 0. ? absError(j) / norm : 0. ;
+    maxError(j) = (m.col(j) - rec.col(j)).cwiseAbs().maxCoeff() ;
+  }
+
+  std::ofstream writeError(params.m_recDirName + "/reconstructionError.dat") ;
+  if (writeError.is_open())
+  {
+    writeError << "# time L2 relativeL2 max" << std::endl ;
+    writeError << std::scientific << std::setprecision(8) ;
+    for (long j = 0; j < TSIZE; j++)
+      writeError << times[j] << " " << absError(j) << " " << relError(j) << " " << maxError(j) << std::endl ;
+    writeError.close() ;
+  }
+
+  return relError.sum() / std::sqrt((double)TSIZE * pointSize) ;
+}
+
+void podctl(Parameters &params)
+{
+  std::cout << "Starting POD workflow " << std::endl ;
+
+  omp_set_num_threads(params.m_threadsSize) ;
+  const double start(omp_get_wtime()) ;
+
+  const std::vector<std::string> t(read_timefile(params.m_timesFileName)) ;
+  const long timesSize(t.size()) ;
+  if (params.m_podSize > timesSize)
+  {
+    std::cout << "Modes to write exceed available snapshots. Adjusted. " << std::endl ;
+    params.m_podSize = timesSize ;
+  }
+
+  std::vector<std::string> pcfs ;
+  for (const auto &time : t)
+    pcfs.push_back(params.m_inputDirName + "/" + time + "/" + params.m_dataFileName) ;
+
+  const bool reconstruct(params.m_reconstruct || params.m_reconstructionError) ;
+  Matrix3Xd points ;
+  if (params.m_writeVtk)
+    points = read_point_positions(params.m_pointsFileName) ;
+
+  /* Every stage works on the matrices of the previous ones: the snapshots are
+  read once for the correlation matrix, the modes, the reconstruction and the
+  errors, and the reconstruction coefficients are the chronos. */
+  TaskGraph graph(3, params.m_threadsSize) ;
+
+  SnapshotSource snapshots ;
+  SnapshotSegment segment ;
+  MatrixXd pm ;
+  VectorXd snapNorm2 ;
+  PodBasis basis ;
+  MatrixXd chronos ;
+  MatrixXd phi ;
+  MatrixXd rec ;
+  long rank(0) ;
+  double readMemory(0.) ;
+
+  // READING INPUT FILES
+
+  const auto readTask = graph.add("Reading files", [&]() {
+    if (params.m_shmName.empty())
+      snapshots = SnapshotSource::read(pcfs, params.m_varSize, params.m_offset, params.m_layout) ;
+    else
+      snapshots = shared_snapshots(segment, params.m_shmName, pcfs, params.m_varSize, params.m_offset, params.m_layout) ;
+    std::cout << "Read " << snapshots.size() << " snapshots of " << snapshots.rows() << " values." << std::endl ;
+    if (params.m_writeVtk && points.cols() * params.m_varSize != snapshots.rows())
+      throw "The point coordinates do not match the snapshots" ;
+    readMemory = peak_memory_mb() ;
+  }) ;
+
+  // POD
+
+  const auto correlationTask = graph.add("Computing projection matrix", [&]() {
+    GramAccumulator gram ;
+    gram.update(snapshots) ;
+    gram.release(pm) ;
+    if (params.m_errorCurves)
+      snapNorm2 = timesSize * pm.diagonal() ;
+  }, {readTask}) ;
+
+  const auto eigenTask = graph.add("Computing eigenvalues and eigenvectors", [&]() {
+    basis = PodBasis(pm, params.m_podSize, params.m_targetRic, params.m_eigSolver, readMemory) ;
+    params.m_podSize = basis.size() ;
+    std::cout << "With given RIC, pod size = " << params.m_podSize << std::endl ;
+    chronos = basis.chronos() ;
+  }, {correlationTask}) ;
+
+  graph.add("Writing eigenvalues and chronos", [&]() {
+    write_eigenvalues(params.m_chronosDirName, basis.eigenvalues(), basis.times(), basis.trace()) ;
+
+    std::ofstream writeChronos(params.m_chronosDirName + "/chronos.bin", std::ios::binary) ;
+    if (writeChronos.is_open()) {
+      writeChronos.write(reinterpret_cast<const char*>(chronos.data()), chronos.size() * sizeof(double)) ;
+      writeChronos.close() ;
+    }
+  }, {eigenTask}) ;
+
+  if (params.m_errorCurves)
+  {
+    graph.add("Computing error curves", [&]() {
+      MatrixXd coeffs(basis.chronos(basis.eigenvalues().size())) ;
+      VectorXd globalError, energy ;
+      MatrixXd snapError(projection_error_curves(snapNorm2, coeffs, globalError, energy)) ;
+      write_error_curves(params.m_chronosDirName, snapError, globalError, energy) ;
+    }, {eigenTask}) ;
+  }
+
+  const auto modesTask = graph.add("Computing POD modes", [&]() {
+    phi = basis.modes(snapshots) ;
+  }, {eigenTask}) ;
+
+  graph.add("Writing POD modes", [&]() {
+    std::ofstream writeMode(params.m_modeDirName + "/mode.bin", std::ios::binary) ;
+    if (writeMode.is_open()) {
+      writeMode.write(reinterpret_cast<const char*>(phi.data()), phi.size() * sizeof(double)) ;
+      writeMode.close() ;
+    }
+    write_matrix_info(params.m_modeDirName + "/mode.bin", phi.rows(), phi.cols(), params.m_varSize, params.m_layout) ;
+  }, {modesTask}) ;
+
+  if (params.m_writeVtk)
+  {
+    graph.add("Writing VTK files of modes", [&]() {
+      std::vector<std::string> labels ;
+      for (long i = 0; i < phi.cols(); i++)
+        labels.push_back(std::to_string(i)) ;
+      write_vtk_fields(params.m_modeDirName + "/VTK", "mode_", labels, points, {"mode"}, {phi.data()},
+                       params.m_varSize, params.m_layout) ;
+    }, {modesTask}) ;
+  }
+
+  // RECONSTRUCTION
+
+  if (reconstruct)
+  {
+    /* The chronos are the coefficients of the snapshots on the modes */
+    const auto recTask = graph.add("Computing reconstructed fields", [&]() {
+      rank = params.m_recRank > 0 ? std::min((long)params.m_recRank, (long)phi.cols()) : phi.cols() ;
+      std::cout << "Reconstructing with " << rank << " modes." << std::endl ;
+      rec = Projector(phi.data(), phi.rows(), rank).reconstruct(chronos.topRows(rank)) ;
+    }, {modesTask}) ;
+
+    if (params.m_reconstruct)
+    {
+      graph.add("Writing reconstructed fields", [&]() {
+        std::ofstream writeField(params.m_recDirName + "/reconstruction.bin", std::ios::binary) ;
+        if (writeField.is_open()) {
+          writeField.write(reinterpret_cast<const char*>(rec.data()), rec.size() * sizeof(double)) ;
+          writeField.close() ;
+        }
+        write_matrix_info(params.m_recDirName + "/reconstruction.bin", rec.rows(), rec.cols(),
+                          params.m_varSize, params.m_layout) ;
+
+        if (params.m_writeRaw)
+        {
+          std::vector<std::string> coords ;
+          if (!params.m_pointsFileName.empty())
+            coords = read_point_coordinates(params.m_pointsFileName) ;
+          write_raw_fields(params.m_recDirName, t, "reconstruction.xy", rec, params.m_varSize, params.m_layout, coords) ;
+        }
+      }, {recTask}) ;
+
+      if (params.m_writeVtk)
+      {
+        graph.add("Writing VTK files of reconstructions", [&]() {
+          const std::string name(field_name(params.m_dataFileName)) ;
+          write_vtk_fields(params.m_recDirName + "/VTK", name + "_", t, points, {name, name + "_R"},
+                           {snapshots.matrix().data(), rec.data()},
+                           params.m_varSize, params.m_layout) ;
+        }, {recTask}) ;
+      }
+    }
+
+    if (params.m_reconstructionError)
+    {
+      graph.add("Computing reconstruction errors", [&]() {
+        const double nrmse(reconstruction_error(params, t, snapshots.matrix(), rec)) ;
+        std::cout << "NRMSE with " << rank << " modes = " << std::scientific << nrmse << std::defaultfloat << std::endl ;
+      }, {recTask}) ;
+    }
+  }
+
+  graph.run() ;
+  graph.report(std::cout) ;
+
+  std::cout << "Workflow done in " << omp_get_wtime() - start << "s, peak memory "
+            << peak_memory_mb() << " MB.\n" << std::endl ;
+}
+
+int main(int argc, const char *argv[])
+{
+  ez::ezOptionParser opt;
+
+  opt.overview = "POD workflow";
+  opt.syntax = "Perform POD, reconstruction, error metrics and VTK output, reading the snapshots once, using [INPUTS] ...";
+  opt.example = "PODCTL -i postProcessing/internalField -tf snapshotTimes -pcfn cloud_U.xy -v 3 -np 8 -ric 0.995 -nm 10000 "
+                "-c chronos -m mode -r reconstruct -rec -rank 10 -err -vtk -pts pointCloud.xy\n\n";
+  opt.footer = "\nThis program is free and without warranty.\n";
+
+  opt.add(
+      "",                            // Default.
+      0,                             // Required?
+      0,                             // Number of args expected.
+      0,                             // Delimiter if expecting multiple args.
+      "Display usage instructions.", // Help description.
+      "-h"                          // Flag token.
+      );
+
+  ez::ezOptionValidator *vS4 = new ez::ezOptionValidator("s4", "ge", "0");
+  opt.add(
+      "",                            // Default.
+      1,                             // Required?
+      1,                             // Number of args expected.
+      0,                             // Delimiter if expecting multiple args.
+      "Number of values per point.", // Help description.
+      Parameters::m_varSizeOpt,      // Flag token.
+      vS4                            // Validate input
+      );
+
+  opt.add(
+      "0",                                                 // Default.
+      0,                                                   // Required?
+      1,                                                   // Number of args expected.
+      0,                                                   // Delimiter if expecting multiple args.
+      "Point cloud file column offset (for reading data)", // Help description.
+      Parameters::m_offsetOpt,                             // Flag token.
+      vS4                                                  // Validate input
+      );
+
+  opt.add(
+      "",                          // Default.
+      1,                           // Required?
+      1,                           // Number of args expected.
+      0,                           // Delimiter if expecting multiple args.
+      "Number of modes to write.", // Help description.
+      Parameters::m_podSizeOpt,    // Flag token.
+      vS4                          // Validate input
+      );
+
+  opt.add(
+      "",                            // Default.
+      1,                             // Required?
+      1,                             // Number of args expected.
+      0,                             // Delimiter if expecting multiple args.
+      "Number of parallel threads.", // Help description.
+      Parameters::m_threadsSizeOpt,  // Flag token.
+      vS4                            // Validate input
+      );
+
+  ez::ezOptionValidator* vD = new ez::ezOptionValidator("d", "gele", "0,1");
+  opt.add(
+      "0.9",                      // Default.
+      1,                          // Required?
+      1,                          // Number of args expected.
+      0,                          // Delimiter if expecting multiple args.
+      "RIC",                      // Help description.
+      Parameters::m_targetRicOpt, // Flag token.
+      vD                          // Validate input
+      );
+
+  opt.add(
+      "",                                                                // Default.
+      1,                                                                 // Required?
+      1,                                                                 // Number of args expected.
+      0,                                                                 // Delimiter if expecting multiple args.
+      "Directory where the time directories reside as sub-directories.", // Help description.
+      Parameters::m_inputDirNameOpt                                      // Flag token.
+      );
+
+  opt.add(
+      "",                             // Default.
+      1,                              // Required?
+      1,                              // Number of args expected.
+      0,                              // Delimiter if expecting multiple args.
+      "File with time snapshot list", // Help description.
+      Parameters::m_timesFileNameOpt  // Flag token.
+      );
+
+  opt.add(
+      "",                                             // Default.
+      1,                                              // Required?
+      1,                                              // Number of args expected.
+      0,                                              // Delimiter if expecting multiple args.
+      "Point cloud file name (in time directories).", // Help description.
+      Parameters::m_dataFileNameOpt                   // Flag token.
+      );
+
+  opt.add(
+      "",                              // Default.
+      1,                               // Required?
+      1,                               // Number of args expected.
+      0,                               // Delimiter if expecting multiple args.
+      "Chronos directory.",            // Help description.
+      Parameters::m_chronosDirNameOpt  // Flag token.
+      );
+
+  opt.add(
+      "",                           // Default.
+      1,                            // Required?
+      1,                            // Number of args expected.
+      0,                            // Delimiter if expecting multiple args.
+      "Modes directory.",           // Help description.
+      Parameters::m_modeDirNameOpt  // Flag token.
+      );
+
+  opt.add(
+      "",                                              // Default.
+      0,                                               // Required?
+      1,                                               // Number of args expected.
+      0,                                               // Delimiter if expecting multiple args.
+      "Reconstruction output directory (with -rec and -err).", // Help description.
+      Parameters::m_recDirNameOpt                      // Flag token.
+      );
+
+  ez::ezOptionValidator *vEig = new ez::ezOptionValidator("s1", "gele", "0,2");
+  opt.add(
+      "0", // 0 : Full eigen-decomposition, 1 : Thick-restart Lanczos (leading eigenpairs up to -nm or -ric), 2 : Multithreaded divide and conquer (all eigenpairs)
+      0,
+      1,
+      0,
+      "Eigen-solver for the projection matrix.",
+      Parameters::m_eigSolverOpt,
+      vEig
+      );
+
+  ez::ezOptionValidator *vLayout = new ez::ezOptionValidator("s1", "gele", "0,1");
+  opt.add(
+      "0", // 0 : Component-blocked (x of all points, then y...), 1 : Point-interleaved (x, y, z of each point)
+      0,
+      1,
+      0,
+      "Row layout of the snapshot, mode and reconstruction matrices.",
+      Parameters::m_layoutOpt,
+      vLayout
+      );
+
+  opt.add(
+      "",                                                                       // Default.
+      0,                                                                        // Required?
+      0,                                                                        // Number of args expected.
+      0,                                                                        // Delimiter if expecting multiple args.
+      "Write projection error curves for every rank to the chronos directory.", // Help description.
+      Parameters::m_errorCurvesOpt                                              // Flag token.
+      );
+
+  opt.add(
+      "",                                                                            // Default.
+      0,                                                                             // Required?
+      0,                                                                             // Number of args expected.
+      0,                                                                             // Delimiter if expecting multiple args.
+      "Reconstruct the snapshots and write them to the reconstruction directory.", // Help description.
+      Parameters::m_reconstructOpt                                                   // Flag token.
+      );
+
+  opt.add(
+      "0",                                                          // Default.
+      0,                                                            // Required?
+      1,                                                            // Number of args expected.
+      0,                                                            // Delimiter if expecting multiple args.
+      "Number of modes of the reconstruction (0: all the modes).", // Help description.
+      Parameters::m_recRankOpt,                                     // Flag token.
+      vS4                                                           // Validate input
+      );
+
+  opt.add(
+      "",                                                                          // Default.
+      0,                                                                           // Required?
+      0,                                                                           // Number of args expected.
+      0,                                                                           // Delimiter if expecting multiple args.
+      "Write the reconstruction error of every snapshot and the NRMSE (as cloudReconstructError.py).", // Help description.
+      Parameters::m_reconstructionErrorOpt                                         // Flag token.
+      );
+
+  opt.add(
+      "",                                                                   // Default.
+      0,                                                                    // Required?
+      0,                                                                    // Number of args expected.
+      0,                                                                    // Delimiter if expecting multiple args.
+      "Write VTK files of the modes, and of the snapshots and reconstructions with -rec (needs -pts).", // Help description.
+      Parameters::m_writeVtkOpt                                             // Flag token.
+      );
+
+  opt.add(
+      "",                                                                      // Default.
+      0,                                                                       // Required?
+      0,                                                                       // Number of args expected.
+      0,                                                                       // Delimiter if expecting multiple args.
+      "Also write the reconstructions as raw point cloud files in <recDir>/<time>/.", // Help description.
+      Parameters::m_writeRawOpt                                                // Flag token.
+      );
+
+  opt.add(
+      "",                                                           // Default.
+      0,                                                            // Required?
+      1,                                                            // Number of args expected.
+      0,                                                            // Delimiter if expecting multiple args.
+      "Point coordinates file (pointCloud.xy or .dat).",            // Help description.
+      Parameters::m_pointsFileNameOpt                               // Flag token.
+      );
+
+  opt.add(
+      "",                                                                     // Default.
+      0,                                                                      // Required?
+      1,                                                                      // Number of args expected.
+      0,                                                                      // Delimiter if expecting multiple args.
+      "Shared snapshot segment: attached if published from the same files, else read and published (see PODSHM).", // Help description.
+      Parameters::m_shmNameOpt                                                // Flag token.
+      );
+
+  // Perform the actual parsing of the command line.
+  opt.parse(argc, argv);
+
+  if (opt.isSet("-h"))
+  {
+    Usage(opt);
+    return 1;
+  }
+
+  // Check if directories exist.
+  std::array<std::string, 4> dirflags = {Parameters::m_inputDirNameOpt, Parameters::m_chronosDirNameOpt,
+                                         Parameters::m_modeDirNameOpt, Parameters::m_recDirNameOpt};
+  for (auto &dirflag : dirflags)
+  {
+    if (opt.isSet(dirflag))
+    {
+      std::string inputdir;
+      struct stat info;
+      opt.get(dirflag.c_str())->getString(inputdir);
+
+      if (stat(inputdir.c_str(), &info) != 0 || !(info.st_mode & S_IFDIR))
+      {
+        std::cerr << "ERROR: " << inputdir << " is not a directory.\n\n";
+        return 1;
+      }
+    }
+  }
+
+  std::vector<std::string> badOptions;
+  int i;
+  if (!opt.gotRequired(badOptions))
+  {
+    for (i = 0; i < badOptions.size(); ++i)
+      std::cerr << "ERROR: Missing required option " << badOptions[i] << ".\n\n";
+
+    Usage(opt);
+    return 1;
+  }
+
+  if (!opt.gotExpected(badOptions))
+  {
+    for (i = 0; i < badOptions.size(); ++i)
+      std::cerr << "ERROR: Got unexpected number of arguments for option " << badOptions[i] << ".\n\n";
+
+    Usage(opt);
+    return 1;
+  }
+
+  // The reconstruction stages need its directory, the VTK files the point coordinates.
+  badOptions.clear() ;
+  if ((opt.isSet(Parameters::m_reconstructOpt) || opt.isSet(Parameters::m_reconstructionErrorOpt))
+      && !opt.isSet(Parameters::m_recDirNameOpt))
+    badOptions.push_back(Parameters::m_recDirNameOpt) ;
+  if (opt.isSet(Parameters::m_writeVtkOpt) && !opt.isSet(Parameters::m_pointsFileNameOpt))
+    badOptions.push_back(Parameters::m_pointsFileNameOpt) ;
+
+  for (auto &flag : badOptions)
+  {
+    std::cerr << "ERROR: Missing required option " << flag << ".\n\n";
+    Usage(opt);
+    return 1;
+  }
+
+  Parameters params(opt) ;
+  simd_kernels() ;
+
+  try
+  {
+    podctl(params) ;
+  }
+  catch (const char *message)
+  {
+    std::cerr << "ERROR: " << message << ".\n\n";
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,276 @@
+//
+// Publication, listing and removal of the shared snapshot segments used by
+// POD, REC and PODCTL -shm.
+//
+
+#include <iostream>
+#include <ctime>
+#include "ezOptionParser.hpp"
+#include <omp.h>
+#include <sys/stat.h>
+
+#include "utils.h"
+#include "simd.h"
+#include "shmsnapshots.h"
+
+static void print_segment(const std::string &name, const SegmentHeader &header)
+{
+  const time_t created(header.created) ;
+  char date[32] ;
+  std::strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", std::localtime(&created)) ;
+  std::cout << name << ": " << header.rows << " x " << header.cols << " snapshots ("
+            << header.size / (1024. * 1024.) << " MB), " << header.varSize << " values per point, offset "
+            << header.offset << ", " << layout_name(header.layout) << " layout, " << scalar_name(header.scalar)
+            << " values, published " << date
+            << " from " << header.source << std::endl ;
+}
+
+void podshm(ez::ezOptionParser &opt)
+{
+  Parameters params(opt) ;
+
+  if (opt.isSet("-list"))
+  {
+    for (const auto &name : SnapshotSegment::list())
+    {
+      SnapshotSegment segment ;
+      try
+      {
+        if (segment.attach(name))
+          print_segment(name, segment.header()) ;
+      }
+      catch (const char *message)
+      {
+        std::cout << name << ": " << message << std::endl ;
+      }
+    }
+    return ;
+  }
+
+  if (params.m_shmName.empty())
+    throw "Missing segment name (-shm)" ;
+
+  if (opt.isSet("-remove"))
+  {
+    if (!SnapshotSegment::remove(params.m_shmName))
+      throw "No such shared snapshot segment" ;
+    std::cout << "Removed shared snapshot segment " << params.m_shmName << "." << std::endl ;
+    return ;
+  }
+
+  if (opt.isSet("-info"))
+  {
+    SnapshotSegment segment ;
+    if (!segment.attach(params.m_shmName))
+      throw "No such shared snapshot segment" ;
+    print_segment(params.m_shmName, segment.header()) ;
+    return ;
+  }
+
+  if (opt.isSet("-publish"))
+  {
+    if (params.m_inputDirName.empty() || params.m_timesFileName.empty() || params.m_dataFileName.empty()
+        || params.m_varSize <= 0)
+      throw "Publishing needs -i, -tf, -pcfn and -v" ;
+
+    omp_set_num_threads(params.m_threadsSize > 0 ? params.m_threadsSize : 1) ;
+    std::vector<std::string> pcfs ;
+    for (const auto &time : read_timefile(params.m_timesFileName))
+      pcfs.push_back(params.m_inputDirName + "/" + time + "/" + params.m_dataFileName) ;
+
+    const double start(omp_get_wtime()) ;
+    SnapshotSegment segment ;
+    if (params.m_scalar == SCALAR_FLOAT)
+      shared_snapshots<float>(segment, params.m_shmName, pcfs, params.m_varSize, params.m_offset, params.m_layout) ;
+    else if (params.m_scalar == SCALAR_COMPLEX)
+      shared_snapshots<std::complex<double>>(segment, params.m_shmName, pcfs, params.m_varSize, params.m_offset,
+                                             params.m_layout) ;
+    else
+      shared_snapshots<double>(segment, params.m_shmName, pcfs, params.m_varSize, params.m_offset, params.m_layout) ;
+    print_segment(params.m_shmName, segment.header()) ;
+    std::cout << "Done in " << omp_get_wtime() - start << "s." << std::endl ;
+    return ;
+  }
+
+  throw "No command given (-publish, -info, -remove or -list)" ;
+}
+
+int main(int argc, const char *argv[])
+{
+  ez::ezOptionParser opt;
+
+  opt.overview = "Shared snapshot segments";
+  opt.syntax = "Publish, describe, list or remove the snapshot matrices shared by POD, REC and PODCTL -shm ...";
+  opt.example = "PODSHM -publish -shm U -i postProcessing/internalField -tf snapshotTimes -pcfn cloud_U.xy -v 3 -np 8\n"
+                "PODSHM -list\n"
+                "PODSHM -remove -shm U\n\n";
+  opt.footer = "\nThis program is free and without warranty.\n";
+
+  opt.add(
+      "",                            // Default.
+      0,                             // Required?
+      0,                             // Number of args expected.
+      0,                             // Delimiter if expecting multiple args.
+      "Display usage instructions.", // Help description.
+      "-h"                          // Flag token.
+      );
+
+  opt.add(
+      "",
+      0,
+      0,
+      0,
+      "Read the snapshot files and publish them to the segment (kept if already published from the same files).",
+      "-publish"
+      );
+
+  opt.add(
+      "",
+      0,
+      0,
+      0,
+      "Describe the segment.",
+      "-info"
+      );
+
+  opt.add(
+      "",
+      0,
+      0,
+      0,
+      "Remove the segment.",
+      "-remove"
+      );
+
+  opt.add(
+      "",
+      0,
+      0,
+      0,
+      "Describe the POSIX shared-memory segments (/dev/shm/pod.*).",
+      "-list"
+      );
+
+  opt.add(
+      "",                                                                   // Default.
+      0,                                                                    // Required?
+      1,                                                                    // Number of args expected.
+      0,                                                                    // Delimiter if expecting multiple args.
+      "Segment name (POSIX shared memory), or file path (e.g. on hugetlbfs).", // Help description.
+      Parameters::m_shmNameOpt                                              // Flag token.
+      );
+
+  ez::ezOptionValidator *vS4 = new ez::ezOptionValidator("s4", "ge", "0");
+  opt.add(
+      "",                            // Default.
+      0,                             // Required?
+      1,                             // Number of args expected.
+      0,                             // Delimiter if expecting multiple args.
+      "Number of values per point.", // Help description.
+      Parameters::m_varSizeOpt,      // Flag token.
+      vS4                            // Validate input
+      );
+
+  opt.add(
+      "0",                                                 // Default.
+      0,                                                   // Required?
+      1,                                                   // Number of args expected.
+      0,                                                   // Delimiter if expecting multiple args.
+      "Point cloud file column offset (for reading data)", // Help description.
+      Parameters::m_offsetOpt,                             // Flag token.
+      vS4                                                  // Validate input
+      );
+
+  opt.add(
+      "",                            // Default.
+      0,                             // Required?
+      1,                             // Number of args expected.
+      0,                             // Delimiter if expecting multiple args.
+      "Number of parallel threads.", // Help description.
+      Parameters::m_threadsSizeOpt,  // Flag token.
+      vS4                            // Validate input
+      );
+
+  opt.add(
+      "",                                                                // Default.
+      0,                                                                 // Required?
+      1,                                                                 // Number of args expected.
+      0,                                                                 // Delimiter if expecting multiple args.
+      "Directory where the time directories reside as sub-directories.", // Help description.
+      Parameters::m_inputDirNameOpt                                      // Flag token.
+      );
+
+  opt.add(
+      "",                             // Default.
+      0,                              // Required?
+      1,                              // Number of args expected.
+      0,                              // Delimiter if expecting multiple args.
+      "File with time snapshot list", // Help description.
+      Parameters::m_timesFileNameOpt  // Flag token.
+      );
+
+  opt.add(
+      "",                                             // Default.
+      0,                                              // Required?
+      1,                                              // Number of args expected.
+      0,                                              // Delimiter if expecting multiple args.
+      "Point cloud file name (in time directories).", // Help description.
+      Parameters::m_dataFileNameOpt                   // Flag token.
+      );
+
+  ez::ezOptionValidator *vLayout = new ez::ezOptionValidator("s1", "gele", "0,1");
+  opt.add(
+      "0", // 0 : Component-blocked (x of all points, then y...), 1 : Point-interleaved (x, y, z of each point)
+      0,
+      1,
+      0,
+      "Row layout of the snapshot matrix (as given to POD and REC).",
+      Parameters::m_layoutOpt,
+      vLayout
+      );
+
+  ez::ezOptionValidator *vScalar = new ez::ezOptionValidator("s1", "gele", "0,2");
+  opt.add(
+      "0", // 0 : double, 1 : float, 2 : complex (pairs of columns: real, imaginary)
+      0,
+      1,
+      0,
+      "Scalar type of the snapshots (as given to POD).",
+      Parameters::m_scalarOpt,
+      vScalar
+      );
+
+  // Perform the actual parsing of the command line.
+  opt.parse(argc, argv);
+
+  if (opt.isSet("-h") || argc < 2)
+  {
+    Usage(opt);
+    return 1;
+  }
+
+  std::vector<std::string> badOptions;
+  int i;
+  if (!opt.gotExpected(badOptions))
+  {
+    for (i = 0; i < badOptions.size(); ++i)
+      std::cerr << "ERROR: Got unexpected number of arguments for option " << badOptions[i] << ".\n\n";
+
+    Usage(opt);
+    return 1;
+  }
+
+  simd_kernels() ;
+
+  try
+  {
+    podshm(opt) ;
+  }
+  catch (const char *message)
+  {
+    std::cerr << "ERROR: " << message << ".\n\n";
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,167 @@
+//
+// Resident basis server: the modes of a POD run loaded once, answering the
+// projection, reconstruction and probe requests of local clients (PODCLI).
+//
+
+#include <csignal>
+#include <iostream>
+#include "ezOptionParser.hpp"
+#include <omp.h>
+#include <sys/stat.h>
+
+#include "utils.h"
+#include "simd.h"
+#include "basisserver.h"
+
+static void stop_on_signal(int)
+{
+  BasisServer::request_stop() ;
+}
+
+void podsrv(ez::ezOptionParser &opt)
+{
+  Parameters params(opt) ;
+
+  double start(omp_get_wtime()) ;
+  std::cout << "Loading modes..." << std::flush ;
+  BasisServer server(params.m_modeDirName + "/mode.bin", params.m_threadsSize,
+                     params.m_batchColumns, params.m_batchWait * 1.e-6) ;
+  const BasisInfo &info(server.info()) ;
+  std::cout << "\t\t Done in " << omp_get_wtime() - start << "s \n" << std::endl ;
+
+  std::cout << info.modes << " modes of " << info.rows << " rows (" << info.varSize << " values per point, "
+            << layout_name(info.layout) << " layout), "
+            << (server.pinned() ? "pinned in memory." : "not pinned (raise the memlock limit, ulimit -l).") << "\n"
+            << std::endl ;
+
+  std::signal(SIGINT, stop_on_signal) ;
+  std::signal(SIGTERM, stop_on_signal) ;
+
+  std::cout << "Serving on " << params.m_socketName << " with " << std::max(params.m_threadsSize, 1)
+            << " workers (batches of up to " << params.m_batchColumns << " columns)." << std::endl ;
+  server.run(params.m_socketName) ;
+
+  std::cout << "\nStopped.\n" << server.stats() << std::endl ;
+}
+
+int main(int argc, const char *argv[])
+{
+  ez::ezOptionParser opt;
+
+  opt.overview = "Resident basis server";
+  opt.syntax = "Serve projection, reconstruction and probe requests on a Unix-domain socket using [INPUTS] ...";
+  opt.example = "PODSRV -m modes -sock /tmp/pod.sock -np 4\n"
+                "PODCLI -sock /tmp/pod.sock -stats\n\n";
+  opt.footer = "\nThis program is free and without warranty.\n";
+
+  opt.add(
+      "",                            // Default.
+      0,                             // Required?
+      0,                             // Number of args expected.
+      0,                             // Delimiter if expecting multiple args.
+      "Display usage instructions.", // Help description.
+      "-h"                          // Flag token.
+      );
+
+  opt.add(
+      "",                                    // Default.
+      1,                                     // Required?
+      1,                                     // Number of args expected.
+      0,                                     // Delimiter if expecting multiple args.
+      "Modes directory (mode.bin and mode.bin.info).", // Help description.
+      Parameters::m_modeDirNameOpt           // Flag token.
+      );
+
+  opt.add(
+      "",                            // Default.
+      1,                             // Required?
+      1,                             // Number of args expected.
+      0,                             // Delimiter if expecting multiple args.
+      "Unix-domain socket path.",    // Help description.
+      Parameters::m_socketNameOpt    // Flag token.
+      );
+
+  ez::ezOptionValidator *vS4 = new ez::ezOptionValidator("s4", "ge", "0");
+  opt.add(
+      "1",                                           // Default.
+      0,                                             // Required?
+      1,                                             // Number of args expected.
+      0,                                             // Delimiter if expecting multiple args.
+      "Number of workers (one thread each).",        // Help description.
+      Parameters::m_threadsSizeOpt,                  // Flag token.
+      vS4                                            // Validate input
+      );
+
+  ez::ezOptionValidator *vS4Pos = new ez::ezOptionValidator("s4", "gt", "0");
+  opt.add(
+      "256",                                                     // Default.
+      0,                                                         // Required?
+      1,                                                         // Number of args expected.
+      0,                                                         // Delimiter if expecting multiple args.
+      "Maximum number of columns of the requests answered together.", // Help description.
+      Parameters::m_batchColumnsOpt,                             // Flag token.
+      vS4Pos                                                     // Validate input
+      );
+
+  opt.add(
+      "0",                                                                           // Default.
+      0,                                                                             // Required?
+      1,                                                                             // Number of args expected.
+      0,                                                                             // Delimiter if expecting multiple args.
+      "Time a worker waits for more requests to answer together, in microseconds.", // Help description.
+      Parameters::m_batchWaitOpt,                                                    // Flag token.
+      vS4                                                                            // Validate input
+      );
+
+  // Perform the actual parsing of the command line.
+  opt.parse(argc, argv);
+
+  if (opt.isSet("-h"))
+  {
+    Usage(opt);
+    return 1;
+  }
+
+  struct stat info;
+  std::string modeDir;
+  opt.get(Parameters::m_modeDirNameOpt)->getString(modeDir);
+  if (opt.isSet(Parameters::m_modeDirNameOpt) && (stat(modeDir.c_str(), &info) != 0 || !(info.st_mode & S_IFDIR)))
+  {
+    std::cerr << "ERROR: " << modeDir << " is not a directory.\n\n";
+    return 1;
+  }
+
+  std::vector<std::string> badOptions;
+  int i;
+  if (!opt.gotRequired(badOptions))
+  {
+    for (i = 0; i < badOptions.size(); ++i)
+      std::cerr << "ERROR: Missing required option " << badOptions[i] << ".\n\n";
+
+    Usage(opt);
+    return 1;
+  }
+
+  if (!opt.gotExpected(badOptions))
+  {
+    for (i = 0; i < badOptions.size(); ++i)
+      std::cerr << "ERROR: Got unexpected number of arguments for option " << badOptions[i] << ".\n\n";
+
+    Usage(opt);
+    return 1;
+  }
+
+  simd_kernels() ;
+
+  try
+  {
+    podsrv(opt) ;
+  }
+  catch (const char *message)
+  {
+    std::cerr << "ERROR: " << message << ".\n\n";
+    return 1;
+  }
+
+  return 0;
+}
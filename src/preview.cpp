@@ -0,0 +1,282 @@
+//
+// Fast preview of the POD spectrum from a sample of the point rows.
+//
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <omp.h>
+
+#include "preview.h"
+#include "eigensolvers.h"
+
+void read_pcf_points(const std::string &fname,
+                     const std::vector<long> &points,
+                     const long varSize,
+                     const long offset,
+                     double *values)
+{
+  std::ifstream file(fname, std::ios::binary | std::ios::ate) ;
+  if (!file.is_open())
+  {
+    std::cerr << "Unable to open file " << fname << std::endl;
+    return ;
+  }
+  const std::streamsize size(file.tellg()) ;
+  std::string buffer(size, '\0') ;
+  file.seekg(0) ;
+  file.read(&buffer[0], size) ;
+  file.close() ;
+
+  /* p points into line number line */
+  const char *p(buffer.c_str()) ;
+  const char *end(p + size) ;
+  long line(0) ;
+  char *next ;
+  for (size_t k = 0; k < points.size(); k++)
+  {
+    while (line < points[k] && p < end)
+    {
+      p = static_cast<const char*>(std::memchr(p, '\n', end - p)) ;
+      p = p ? p + 1 : end ;
+      line++ ;
+    }
+
+    for (long c = 0; c < offset; c++)
+    {
+      std::strtod(p, &next) ;
+      p = next ;
+    }
+    for (long j = 0; j < varSize; j++)
+    {
+      values[k * varSize + j] = std::strtod(p, &next) ;
+      p = next ;
+    }
+  }
+}
+
+template <typename Scalar>
+void read_pcf_points(const std::string &fname,
+                     const std::vector<long> &points,
+                     const long varSize,
+                     const long offset,
+                     Scalar *values)
+{
+  if constexpr (std::is_same<Scalar, double>::value)
+  {
+    read_pcf_points(fname, points, varSize, offset, static_cast<double*>(values)) ;
+  }
+  else
+  {
+    const long columnsSize(NumTraits<Scalar>::IsComplex ? 2 * varSize : varSize) ;
+    std::vector<double> read(points.size() * columnsSize) ;
+    read_pcf_points(fname, points, columnsSize, offset, read.data()) ;
+    for (size_t i = 0; i < points.size() * varSize; i++)
+    {
+      if constexpr (NumTraits<Scalar>::IsComplex)
+        values[i] = Scalar(read[2 * i], read[2 * i + 1]) ;
+      else
+        values[i] = Scalar(read[i]) ;
+    }
+  }
+}
+
+/*
+Leading eigenvalues (descending) of the symmetric (Hermitian) matrix a, and
+their eigenvectors if eigvec is given, a being overwritten.
+*/
+template <typename Scalar>
+static VectorXd leading_eigen(ScalarMatrix<Scalar> &a, const long nev, ScalarMatrix<Scalar> *eigvec = nullptr)
+{
+  Matrix<typename NumTraits<Scalar>::Real, Dynamic, 1> eigval ;
+  ScalarMatrix<Scalar> vectors ;
+  if (!lanczos_eigen(a, nev, 1., numext::real(a.trace()), eigval, vectors))
+  {
+    selfadjoint_eigen_inplace(a, eigval, eigvec != nullptr) ;
+    vectors.swap(a) ;
+  }
+
+  const long size(std::min(nev, (long)eigval.size())) ;
+  if (eigvec)
+    *eigvec = vectors.rightCols(size).rowwise().reverse() ;
+  return eigval.tail(size).reverse().template cast<double>() ;
+}
+
+template <typename Scalar>
+void preview_pod(const std::vector<std::string> &pcfs, const Parameters &params)
+{
+  typedef typename NumTraits<Scalar>::Real Real ;
+  const FlushDenormals flush(std::is_same<Scalar, float>::value) ;
+  const long pointSize(read_pcf_info(pcfs[0]).rows) ;
+  const long varSize(params.m_varSize) ;
+
+  std::vector<std::string> files ;
+  for (size_t i = 0; i < pcfs.size(); i += std::max(params.m_previewStride, 1))
+    files.push_back(pcfs[i]) ;
+  const long TSIZE(files.size()) ;
+  const long drawsSize(std::max((long)params.m_previewPoints, 2L)) ;
+  const long batchesSize(std::min(10L, drawsSize)) ;
+  const long nev(std::min((long)params.m_podSize, TSIZE)) ;
+
+  std::cout << "Preview from " << drawsSize << " draws among " << pointSize << " points ("
+            << (params.m_previewSampling == PREVIEW_LEVERAGE ? "leverage" : "uniform") << " sampling) and "
+            << TSIZE << " of " << pcfs.size() << " snapshots." << std::endl ;
+
+  // SAMPLING PROBABILITIES
+
+  VectorXd prob(VectorXd::Constant(pointSize, 1. / pointSize)) ;
+  if (params.m_previewSampling == PREVIEW_LEVERAGE)
+  {
+    /* Leverage of a point: squared norm of its rows in an orthonormal basis
+    of a few snapshots spread over the previewed ones */
+    const long pilotSize(std::min(16L, TSIZE)) ;
+    ScalarMatrix<Scalar> pilot(pointSize * varSize, pilotSize) ;
+#pragma omp parallel for
+    for (long j = 0; j < pilotSize; j++)
+      read_pcf_to_column(files[j * TSIZE / pilotSize], pointSize, varSize, params.m_offset, LAYOUT_BLOCKED, pilot.col(j).data()) ;
+
+    ColPivHouseholderQR<ScalarMatrix<Scalar>> qr(pilot) ;
+    const ScalarMatrix<Scalar> q(qr.householderQ() * ScalarMatrix<Scalar>::Identity(pilot.rows(), qr.rank())) ;
+    VectorXd leverage(VectorXd::Zero(pointSize)) ;
+    for (long j = 0; j < varSize; j++)
+      leverage += q.middleRows(j * pointSize, pointSize).rowwise().squaredNorm().template cast<double>() ;
+
+    /* Mixing with uniform bounds the rescaling of low-leverage points */
+    if (leverage.sum() > 0.)
+      prob = 0.5 * prob + 0.5 * leverage / leverage.sum() ;
+  }
+
+  std::mt19937 gen(1u) ;
+  std::discrete_distribution<long> distribution(prob.data(), prob.data() + pointSize) ;
+  std::vector<long> draws(drawsSize) ;
+  for (auto &d : draws)
+    d = distribution(gen) ;
+
+  std::vector<long> points(draws) ;
+  std::sort(points.begin(), points.end()) ;
+  points.erase(std::unique(points.begin(), points.end()), points.end()) ;
+
+  // READING THE SAMPLED ROWS
+
+  ScalarMatrix<Scalar> sampled(points.size() * varSize, TSIZE) ;
+#pragma omp parallel for schedule(dynamic)
+  for (long t = 0; t < TSIZE; t++)
+    read_pcf_points(files[t], points, varSize, params.m_offset, sampled.col(t).data()) ;
+
+  /* One row per draw and component, rescaled so that x^H x estimates m^H m */
+  ScalarMatrix<Scalar> x(drawsSize * varSize, TSIZE) ;
+  for (long d = 0; d < drawsSize; d++)
+  {
+    const long k(std::lower_bound(points.begin(), points.end(), draws[d]) - points.begin()) ;
+    x.middleRows(d * varSize, varSize) = sampled.middleRows(k * varSize, varSize)
+                                         / Real(std::sqrt(drawsSize * prob(draws[d]))) ;
+  }
+  sampled.resize(0, 0) ;
+
+  // ESTIMATED SPECTRUM
+
+  ScalarMatrix<Scalar> g ;
+  correlation_matrix(x, g) ;
+  const double trace(numext::real(g.trace())) ;
+
+  ScalarMatrix<Scalar> eigvec ;
+  ScalarMatrix<Scalar> a(g) ;
+  const VectorXd eigval(leading_eigen(a, nev, params.m_previewModes ? &eigvec : nullptr)) ;
+  const long size(eigval.size()) ;
+
+  // JACKKNIFE ERROR BARS
+
+  /* Replicate b leaves the draws of batch b out: G_-b = (G - G_b) B / (B - 1) */
+  MatrixXd replicates(MatrixXd::Zero(size, batchesSize)) ;
+  MatrixXd replicateRics(MatrixXd::Zero(size, batchesSize)) ;
+  VectorXd replicateModes(batchesSize) ;
+  for (long b = 0; b < batchesSize; b++)
+  {
+    const long first(b * drawsSize / batchesSize) ;
+    const long last((b + 1) * drawsSize / batchesSize) ;
+    const ScalarMatrix<Scalar> xb(x.middleRows(first * varSize, (last - first) * varSize)) ;
+    correlation_matrix(xb, a) ;
+    a = Real(batchesSize / (batchesSize - 1.)) * (g - a) ;
+
+    const double traceB(numext::real(a.trace())) ;
+    const VectorXd values(leading_eigen(a, nev)) ;
+    const long valuesSize(std::min(size, (long)values.size())) ;
+    replicates.col(b).head(valuesSize) = values.head(valuesSize) ;
+    double ric(0.) ;
+    for (long i = 0; i < valuesSize; i++)
+    {
+      ric += std::fabs(values(i)) ;
+      replicateRics(i, b) = ric / traceB ;
+    }
+    replicateModes(b) = ric_pod_size(values, traceB, params.m_targetRic, nev) ;
+  }
+
+  auto jackknife = [batchesSize](const VectorXd &r) {
+    return std::sqrt((batchesSize - 1.) / batchesSize * (r.array() - r.mean()).square().sum()) ;
+  } ;
+
+  const int podSize(ric_pod_size(eigval, trace, params.m_targetRic, nev)) ;
+  std::cout << "Estimated pod size for RIC " << params.m_targetRic << ": " << podSize
+            << " +- " << jackknife(replicateModes) << " (" << replicateModes.minCoeff() << " to "
+            << replicateModes.maxCoeff() << " over the jackknife replicates)" << std::endl ;
+
+  std::ofstream writePreview(params.m_chronosDirName + "/previewEigenValues.dat") ;
+  if (writePreview.is_open())
+    writePreview << "# mode eigenvalue stdError ric ricStdError" << std::endl ;
+  double ric(0.) ;
+  for (long i = 0; i < size; i++)
+  {
+    ric += std::fabs(eigval(i)) ;
+    const double error(jackknife(replicates.row(i).transpose())) ;
+    const double ricError(jackknife(replicateRics.row(i).transpose())) ;
+    if (i < 10)
+      std::cout << "  lambda_" << i + 1 << " = " << eigval(i) << " +- " << error
+                << ", RIC " << ric / trace << " +- " << ricError << std::endl ;
+    if (writePreview.is_open())
+      writePreview << std::scientific << std::setprecision(8) << i + 1 << " " << eigval(i) << " " << error << " "
+                   << ric / trace << " " << ricError << std::endl ;
+  }
+  writePreview.close() ;
+
+  // MODES FROM THE FULL ROWS
+
+  if (params.m_previewModes)
+  {
+    const long NSIZE(pointSize * varSize) ;
+    const long batchSize(std::min(std::max(4L * params.m_threadsSize, 16L), TSIZE)) ;
+    ScalarMatrix<Scalar> y(ScalarMatrix<Scalar>::Zero(NSIZE, podSize)) ;
+    stream_snapshots<Scalar>(files, pointSize, varSize, params.m_offset, params.m_layout, batchSize,
+                             [&](const long first, const Ref<const ScalarMatrix<Scalar>> &b) {
+      y.noalias() += b * eigvec.block(first, 0, b.cols(), podSize) ;
+    }) ;
+
+    for (long i = 0; i < podSize; i++)
+    {
+      const double norm(y.col(i).norm()) ;
+      std::cout << "  mode " << i + 1 << ": Rayleigh quotient " << norm * norm / TSIZE
+                << " (estimated " << eigval(i) << ")" << std::endl ;
+      if (norm > 0.)
+        y.col(i) /= Real(norm) ;
+    }
+
+    std::ofstream writeModes(params.m_modeDirName + "/mode.bin", std::ios::binary) ;
+    if (writeModes.is_open()) {
+      writeModes.write(reinterpret_cast<const char*>(y.data()), y.size() * sizeof(Scalar)) ;
+      writeModes.close() ;
+    }
+    write_matrix_info(params.m_modeDirName + "/mode.bin", NSIZE, podSize, varSize, params.m_layout,
+                      scalar_type_of<Scalar>()) ;
+  }
+}
+
+template void read_pcf_points<float>(const std::string&, const std::vector<long>&, const long, const long, float*) ;
+template void read_pcf_points<std::complex<double>>(const std::string&, const std::vector<long>&, const long,
+                                                    const long, std::complex<double>*) ;
+
+template void preview_pod<float>(const std::vector<std::string>&, const Parameters&) ;
+template void preview_pod<double>(const std::vector<std::string>&, const Parameters&) ;
+template void preview_pod<std::complex<double>>(const std::vector<std::string>&, const Parameters&) ;
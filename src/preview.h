@@ -0,0 +1,66 @@
+//
+// Fast preview of the POD spectrum from a sample of the point rows.
+//
+
+#ifndef POD_PREVIEW_H
+#define POD_PREVIEW_H
+
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+
+#include "utils.h"
+
+using namespace Eigen;
+
+/*
+Sampling of the point rows for the preview (as given to -preview-sampling).
+*/
+enum PreviewSampling {
+  PREVIEW_UNIFORM = 0,  // Uniform over the points
+  PREVIEW_LEVERAGE = 1  // Leverage scores of a pilot set of snapshots, mixed with uniform
+};
+
+/*
+Read the given points (row indices, sorted in ascending order and unique) of a
+point cloud file: varSize values after offset columns for each of them,
+point after point. The file is read in one block and its lines are located
+by their line feeds, only the requested lines being parsed.
+*/
+void read_pcf_points(const std::string &fname,
+                     const std::vector<long> &points,
+                     const long varSize,
+                     const long offset,
+                     double *values) ;
+
+/*
+Same, converted to Scalar. Complex components are read from two columns each,
+real then imaginary part, as by read_pcf_to_column.
+*/
+template <typename Scalar>
+void read_pcf_points(const std::string &fname,
+                     const std::vector<long> &points,
+                     const long varSize,
+                     const long offset,
+                     Scalar *values) ;
+
+/*
+Estimate the leading eigenvalues of the correlation matrix from -preview
+sampled points of every -preview-stride-th snapshot, without parsing the whole
+files. Points are drawn with replacement, uniformly or with probabilities
+mixing uniform and the leverage scores of a pilot set of snapshots, and the
+sampled rows are rescaled by 1 / sqrt(draws * probability), so that their
+correlation matrix is an unbiased estimate of the full one. The draws are
+split into batches, and the error bars are the jackknife standard errors over
+the batches of the eigenvalues, the RIC and the number of modes reaching
+-ric. They are printed and written to chronosDir/previewEigenValues.dat.
+
+With -preview-modes, the leading modes are then computed from the full rows
+of the previewed snapshots, in one streaming pass: phi_i = M v_i / ||M v_i||,
+the Rayleigh quotients ||M v_i||^2 / T refining the estimated eigenvalues.
+Instantiated for float, double and std::complex<double> snapshots.
+*/
+template <typename Scalar>
+void preview_pod(const std::vector<std::string> &pcfs, const Parameters &params) ;
+
+#endif //POD_PREVIEW_H
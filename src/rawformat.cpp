@@ -0,0 +1,103 @@
+//
+// Point cloud files in the OpenFOAM raw sample format (cloud_*.xy).
+//
+
+#include <charconv>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+
+#include "rawformat.h"
+#include "components.h"
+
+/* Separator written by the OpenFOAM raw set writer between two values */
+static const char rawSeparator[] = " \t" ;
+
+std::vector<std::string> read_point_coordinates(const std::string &fname)
+{
+  std::vector<std::string> coords ;
+  std::ifstream file(fname) ;
+  if (!file.is_open())
+  {
+    std::cerr << "Unable to open file " << fname << std::endl ;
+    return coords ;
+  }
+
+  std::string line ;
+  while (getline(file, line))
+  {
+    /* Drop the parentheses of the dictionary format */
+    for (auto &ch : line)
+      if (ch == '(' || ch == ')')
+        ch = ' ' ;
+
+    std::istringstream tokens(line) ;
+    std::string token, prefix ;
+    while (tokens >> token)
+      prefix += token + rawSeparator ;
+
+    if (!prefix.empty())
+      coords.push_back(prefix) ;
+  }
+  file.close() ;
+
+  return coords ;
+}
+
+void write_raw_fields(const std::string &dir,
+                      const std::vector<std::string> &times,
+                      const std::string &fname,
+                      const MatrixXd &fields,
+                      const long varSize,
+                      const int layout,
+                      const std::vector<std::string> &coords)
+{
+  const long pointSize(fields.rows() / varSize) ;
+  const bool withCoords(!coords.empty()) ;
+
+  if (withCoords && (long)coords.size() != pointSize)
+    std::cerr << "Coordinates (" << coords.size() << " points) do not match the fields ("
+              << pointSize << " points), writing components only." << std::endl ;
+  const bool useCoords(withCoords && (long)coords.size() == pointSize) ;
+
+  /* Upper bound of the size of one line: shortest round-trip doubles are at
+  most 24 characters long */
+  size_t lineSize(varSize * (24 + sizeof(rawSeparator))) ;
+  if (useCoords)
+  {
+    size_t coordSize(0) ;
+    for (const auto &c : coords)
+      coordSize = std::max(coordSize, c.size()) ;
+    lineSize += coordSize ;
+  }
+
+  const FormatPointsKernel format(component_kernels(varSize).format[layout]) ;
+
+#pragma omp parallel
+  {
+    std::vector<char> buffer(pointSize * lineSize) ;
+
+#pragma omp for schedule(dynamic)
+    for (long k = 0; k < (long)times.size(); k++)
+    {
+      const char *ptr(format(buffer.data(), fields.col(k).data(), pointSize, varSize,
+                             useCoords ? &coords : nullptr, rawSeparator)) ;
+
+      const std::string timeDir(dir + "/" + times[k]) ;
+      mkdir(timeDir.c_str(), 0755) ;
+      std::FILE *file(std::fopen((timeDir + "/" + fname).c_str(), "wb")) ;
+      if (file)
+      {
+        std::fwrite(buffer.data(), 1, ptr - buffer.data(), file) ;
+        std::fclose(file) ;
+      }
+      else
+      {
+#pragma omp critical
+        std::cerr << "Unable to write file " << timeDir + "/" + fname << std::endl ;
+      }
+    }
+  }
+}
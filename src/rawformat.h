@@ -0,0 +1,41 @@
+//
+// Point cloud files in the OpenFOAM raw sample format (cloud_*.xy).
+//
+
+#ifndef POD_RAWFORMAT_H
+#define POD_RAWFORMAT_H
+
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+
+#include "utils.h"
+
+using namespace Eigen;
+
+/*
+Read the coordinates of the sampling points, either from a raw file
+(pointCloud.xy, "x y z" per line) or from the point list included in the
+sampling dictionary (pointCloud.dat, "( x y z )" per line). Each entry holds
+the coordinates of one point as a line prefix of the raw format, so that they
+are copied verbatim into the output files.
+*/
+std::vector<std::string> read_point_coordinates(const std::string &fname) ;
+
+/*
+Write the columns of fields (one per time, rows in the given layout as in the
+snapshot matrix) to dir/<time>/fname in the raw format: one line per point
+with the coordinates (if any) followed by the varSize components. Values are
+formatted with the shortest round-trip representation into a buffer per
+thread, by the kernel specialised on varSize (components.h), and the times are
+written in parallel.
+*/
+void write_raw_fields(const std::string &dir,
+                      const std::vector<std::string> &times,
+                      const std::string &fname,
+                      const MatrixXd &fields,
+                      const long varSize,
+                      const int layout,
+                      const std::vector<std::string> &coords) ;
+
+#endif //POD_RAWFORMAT_H
@@ -2,6 +2,7 @@
 // Created by encheryg on 22/04/2022.
 //
 
+#include <csignal>
 #include <iostream>
 #include <Eigen/Dense>
 #include "ezOptionParser.hpp"
@@ -9,16 +10,292 @@
 #include <sys/stat.h>
 
 #include "utils.h"
+#include "simd.h"
+#include "interpolation.h"
+#include "rawformat.h"
+#include "libpod.h"
+#include "shmsnapshots.h"
+#include "snapshotwatcher.h"
 
-void reconstruct(ez::ezOptionParser &opt) {
-  std::cout << "Starting reconstruction routine " << std::endl ;
+static volatile std::sig_atomic_t watchStopped(0) ;
 
-  Parameters params(opt) ;
+static void stop_watching(int)
+{
+  watchStopped = 1 ;
+}
+
+/*
+Write the reconstructed fields as raw point cloud files, one per time, in
+recDir/<time>/: doubles, and for complex fields the real and imaginary parts
+of every component, point after point, as read. Returns the elapsed time.
+*/
+template <typename Scalar>
+double writeRawReconstruction(const Parameters &params,
+                              const std::vector<std::string> &times,
+                              const ScalarMatrix<Scalar> &rec) {
+  double start(omp_get_wtime()) ;
+  std::cout << "Writing raw point cloud files..." << std::flush;
+  std::vector<std::string> coords ;
+  if (!params.m_pointsFileName.empty())
+    coords = read_point_coordinates(params.m_pointsFileName) ;
+
+  const std::string rawName(params.m_dataFileName.empty() ? "reconstruction.xy" : params.m_dataFileName) ;
+  if constexpr (NumTraits<Scalar>::IsComplex)
+  {
+    const long varSize(params.m_varSize) ;
+    const long pointSize(rec.rows() / varSize) ;
+    MatrixXd parts(2 * rec.rows(), rec.cols()) ;
+#pragma omp parallel for
+    for (long k = 0; k < rec.cols(); k++)
+      for (long i = 0; i < pointSize; i++)
+        for (long j = 0; j < varSize; j++)
+        {
+          const Scalar value(rec(layout_row(params.m_layout, i, j, pointSize, varSize), k)) ;
+          parts(2 * (j + varSize * i), k) = value.real() ;
+          parts(2 * (j + varSize * i) + 1, k) = value.imag() ;
+        }
+    write_raw_fields(params.m_recDirName, times, rawName, parts, 2 * varSize, LAYOUT_INTERLEAVED, coords) ;
+  }
+  else
+  {
+    write_raw_fields(params.m_recDirName, times, rawName, rec.template cast<double>(), params.m_varSize,
+                     params.m_layout, coords) ;
+  }
+  double end(omp_get_wtime()) ;
+  std::cout << "\t\t Done in " << end - start << "s \n"
+  << std::endl;
+
+  return end - start ;
+}
+
+/*
+Reconstruct the fields at arbitrary output times. The chronos are interpolated
+in time from the snapshot times and the fields are synthesised from the modes,
+so that no snapshot file has to be read. Complex chronos are interpolated by
+their real and imaginary parts.
+*/
+template <typename Scalar>
+void reconstructAtTimes(Parameters &params) {
+  omp_set_num_threads(params.m_threadsSize);
+
+  VectorXd t(times_to_vector(read_timefile(params.m_timesFileName))) ;
+  std::vector<std::string> tOutList(read_timefile(params.m_outTimesFileName)) ;
+  VectorXd tOut(times_to_vector(tOutList)) ;
+  const long TSIZE(t.size()) ;
+
+  if (tOut.minCoeff() < t.minCoeff() || tOut.maxCoeff() > t.maxCoeff())
+    std::cout << "Some output times lie outside the snapshot times and will be extrapolated. " << std::endl ;
+
+  // READING CHRONOS AND MODE FILES
+  double start(omp_get_wtime()) ;
+  std::cout << "Reading chronos and modes..." << std::flush;
+  ScalarMatrix<Scalar> chronos(read_binary_matrix<Scalar>(params.m_chronosDirName + "/chronos.bin", 1)) ;
+  const long NSIZE(chronos.size() / TSIZE) ;
+  chronos.resize(NSIZE, TSIZE) ;
+
+  std::ifstream readMode(params.m_modeDirName + "/mode.bin", std::ios::binary) ;
+  if (!readMode.is_open())
+    throw "Could not open mode file" ;
+  readMode.seekg(0, std::ios::end);
+  const long MVSIZE(readMode.tellg() / (NSIZE * (long)sizeof(Scalar))) ;
+  readMode.close() ;
+  ScalarMatrix<Scalar> m(read_binary_matrix<Scalar>(params.m_modeDirName + "/mode.bin", MVSIZE)) ;
+  convert_layout(m, params.m_varSize, read_matrix_layout(params.m_modeDirName + "/mode.bin"), params.m_layout) ;
+  double end(omp_get_wtime()) ;
+  const auto readingTime(end - start) ;
+  std::cout << "\t\t\t Done in " << readingTime << "s \n"
+  << std::endl;
+
+  std::cout << "Using " << NSIZE << " modes of size " << MVSIZE << " sampled at " << TSIZE << " times.\n"
+  << std::endl;
+
+  // INTERPOLATING CHRONOS
+  start = omp_get_wtime();
+  std::cout << "Interpolating chronos..." << std::flush;
+  if (params.m_interpType == INTERP_BAND_LIMITED && !is_uniform(t))
+  {
+    std::cout << "\n\t Snapshot times are not equally spaced, using cubic spline..." << std::flush;
+    params.m_interpType = INTERP_CUBIC_SPLINE ;
+  }
+
+  auto interpolate = [&](const MatrixXd &x) {
+    return params.m_interpType == INTERP_BAND_LIMITED ? interpolate_band_limited(t, x, tOut)
+                                                       : interpolate_cubic_spline(t, x, tOut) ;
+  } ;
+  ScalarMatrix<Scalar> c ;
+  if constexpr (NumTraits<Scalar>::IsComplex)
+    c = interpolate(chronos.real()).template cast<Scalar>()
+        + Scalar(0., 1.) * interpolate(chronos.imag()).template cast<Scalar>() ;
+  else
+    c = interpolate(chronos.template cast<double>()).template cast<Scalar>() ;
+  end = omp_get_wtime();
+  const auto interpTime(end - start) ;
+  std::cout << "\t\t\t Done in " << interpTime << "s \n"
+  << std::endl;
+
+  // COMPUTE RECONSTRUCTED FIELDS
+  start = omp_get_wtime();
+  std::cout << "Computing reconstructed fields..." << std::flush;
+  ScalarMatrix<Scalar> rec(BasicProjector<Scalar>(m).reconstruct(c)) ;
+  end = omp_get_wtime();
+  const auto recComputingTime(end - start) ;
+  std::cout << "\t\t Done in " << recComputingTime << "s \n" << std::endl;
+
+  // WRITE RECONSTRUCTED FIELDS
+  start = omp_get_wtime();
+  std::cout << "Writing reconstructed fields..." << std::flush;
+  std::ofstream writeField(params.m_recDirName + "/reconstruction.bin", std::ios::binary);
+  if(writeField.is_open()) {
+    writeField.write(reinterpret_cast<const char*>(rec.data()), rec.size() * sizeof(Scalar)) ;
+    writeField.close() ;
+  }
+  write_matrix_info(params.m_recDirName + "/reconstruction.bin", rec.rows(), rec.cols(), params.m_varSize, params.m_layout,
+                    scalar_type_of<Scalar>()) ;
+  std::ofstream writeChronos(params.m_recDirName + "/chronos.bin", std::ios::binary);
+  if(writeChronos.is_open()) {
+    writeChronos.write(reinterpret_cast<const char*>(c.data()), c.size() * sizeof(Scalar)) ;
+    writeChronos.close() ;
+  }
+  if (scalar_type_of<Scalar>() != SCALAR_DOUBLE)
+    write_matrix_info(params.m_recDirName + "/chronos.bin", c.rows(), c.cols(), 1, LAYOUT_BLOCKED,
+                      scalar_type_of<Scalar>()) ;
+  end = omp_get_wtime();
+  auto resWritingTime(end - start) ;
+  std::cout << "\t\t\t Done in " << resWritingTime << "s \n"
+  << std::endl;
+
+  if (params.m_writeRaw)
+    resWritingTime += writeRawReconstruction<Scalar>(params, tOutList, rec) ;
+
+  const auto globalTime(readingTime+interpTime+recComputingTime+resWritingTime) ;
+  std::cout << "Everything done in " << globalTime << "s \n" << std::endl;
+}
 
+/*
+Project the snapshots of a running solver as their files are completed
+(SnapshotWatcher), the ones already written first. The coefficients on the
+first -rank modes and the relative residual of every snapshot are appended to
+recDir/watchCoefficients.bin (rank + 1 values of the scalar type of the modes
+per snapshot) and its time,
+residual and latency (from the detection of the file to the append) to
+recDir/watchTimes.dat. Runs until interrupted, or for -watch-idle seconds
+without a new snapshot.
+*/
+template <typename Scalar>
+void watchSnapshots(const Parameters &params) {
+  omp_set_num_threads(params.m_threadsSize);
+
+  // READING MODE FILE
+  double start(omp_get_wtime()) ;
+  std::cout << "Reading modes..." << std::flush;
+  const std::string modeFile(params.m_modeDirName + "/mode.bin") ;
+  const MatrixInfo info(read_matrix_info(modeFile)) ;
+  if (info.rows == 0)
+    throw "Missing mode file description (mode.bin.info)" ;
+  if (info.varSize > 0 && info.varSize != params.m_varSize)
+    throw "Values per point of the modes differ from -v" ;
+  if (info.rows % params.m_varSize != 0)
+    throw "Mode size is not a multiple of the number of values per point" ;
+  ScalarMatrix<Scalar> m(read_binary_matrix<Scalar>(modeFile, info.rows)) ;
+  convert_layout(m, params.m_varSize, info.layout, params.m_layout) ;
+  const long pointSize(m.rows() / params.m_varSize) ;
+  const long rank(params.m_recRank > 0 ? std::min<long>(params.m_recRank, m.cols()) : m.cols()) ;
+  const BasicProjector<Scalar> projector(m.data(), m.rows(), rank) ;
+  const ScalarMatrix<Scalar> gram(projector.gram()) ;
+  std::cout << "\t\t\t\t Done in " << omp_get_wtime() - start << "s \n" << std::endl;
+
+  // WATCHING THE TIME DIRECTORIES
+  SnapshotWatcher watcher(params.m_inputDirName, params.m_dataFileName, pointSize, params.m_watchPoll) ;
+  std::cout << "Watching " << params.m_inputDirName << "/<time>/" << params.m_dataFileName
+            << (watcher.notified() ? " (inotify)" : " (polling)") << ", projecting on " << rank
+            << " modes. Interrupt to stop.\n" << std::endl;
+
+  const std::string coeffsName(params.m_recDirName + "/watchCoefficients.bin") ;
+  std::ofstream writeCoeffs(coeffsName, std::ios::binary | std::ios::trunc) ;
+  std::ofstream writeTimes(params.m_recDirName + "/watchTimes.dat") ;
+  if (!writeCoeffs.is_open() || !writeTimes.is_open())
+    throw "Could not write the watch files" ;
+  writeTimes << "# time relativeResidual latency(ms)" << std::endl ;
+
+  std::signal(SIGINT, stop_watching) ;
+  std::signal(SIGTERM, stop_watching) ;
+
+  long count(0) ;
+  std::vector<double> latencies ;
+  double lastSnapshot(omp_get_wtime()) ;
+  while (!watchStopped)
+  {
+    const std::vector<WatchedSnapshot> snapshots(watcher.wait(0.25)) ;
+    if (snapshots.empty())
+    {
+      if (params.m_watchIdle > 0. && omp_get_wtime() - lastSnapshot > params.m_watchIdle)
+        break ;
+      continue ;
+    }
+
+    /* Snapshots completed together are parsed in parallel and projected at once */
+    const long cols(snapshots.size()) ;
+    ScalarMatrix<Scalar> batch(m.rows(), cols) ;
+#pragma omp parallel for schedule(dynamic)
+    for (long j = 0; j < cols; j++)
+      read_pcf_to_column(snapshots[j].fname, pointSize, params.m_varSize, params.m_offset, params.m_layout,
+                         batch.col(j).data()) ;
+
+    ScalarMatrix<Scalar> out(rank + 1, cols) ;
+    auto c(out.topRows(rank)) ;
+    projector.coefficients(batch, c) ;
+    const VectorXd residuals(projector.residuals(batch, c, gram)) ;
+    out.row(rank) = residuals.transpose().template cast<Scalar>() ;
+
+    writeCoeffs.write(reinterpret_cast<const char*>(out.data()), out.size() * sizeof(Scalar)) ;
+    writeCoeffs.flush() ;
+    count += cols ;
+    write_matrix_info(coeffsName, rank + 1, count, 1, LAYOUT_INTERLEAVED, scalar_type_of<Scalar>()) ;
+
+    lastSnapshot = omp_get_wtime() ;
+    for (long j = 0; j < cols; j++)
+    {
+      const double latency(lastSnapshot - snapshots[j].detected) ;
+      latencies.push_back(latency) ;
+      writeTimes << snapshots[j].time << " " << residuals(j) << " " << latency * 1.e3 << "\n" ;
+      std::cout << "Time " << snapshots[j].time << ": relative residual " << residuals(j) << ", projected in "
+                << latency * 1.e3 << " ms" << std::endl ;
+    }
+    writeTimes.flush() ;
+  }
+
+  std::cout << "\nProjected " << count << " snapshots" ;
+  if (!latencies.empty())
+  {
+    std::sort(latencies.begin(), latencies.end()) ;
+    std::cout << ", latency p50 " << latencies[latencies.size() / 2] * 1.e3 << " ms, max "
+              << latencies.back() * 1.e3 << " ms" ;
+  }
+  std::cout << ".\n" << std::endl;
+}
+
+/*
+Snapshots read from the files, or mapped from the shared segment named by
+-shm.
+*/
+template <typename Scalar>
+static BasicSnapshotSource<Scalar> readSnapshots(SnapshotSegment &segment,
+                                                 const Parameters &params,
+                                                 const std::vector<std::string> &pcfs) {
+  if (params.m_shmName.empty())
+    return BasicSnapshotSource<Scalar>::read(pcfs, params.m_varSize, params.m_offset, params.m_layout) ;
+
+  return shared_snapshots<Scalar>(segment, params.m_shmName, pcfs, params.m_varSize, params.m_offset, params.m_layout) ;
+}
+
+/*
+Project the snapshots on the modes and reconstruct them.
+*/
+template <typename Scalar>
+void reconstructSnapshots(Parameters &params) {
   std::vector<std::string> t;
 
   t = read_timefile(params.m_timesFileName);
-  long TSIZE = t.size();
 
   // READING INPUT FILES
 
@@ -30,18 +307,21 @@ void reconstruct(ez::ezOptionParser &opt) {
     pcfs.push_back(name_temp);
   }
 
-  MatrixXd snapshots;
   double start(omp_get_wtime()) ;
   std::cout << "Reading snapshots files..." << std::flush;
-  auto pointCloudInfo = read_pcfs_to_matrix(&snapshots, &pcfs, (long)params.m_varSize, (long)params.m_offset);
-  auto REF_MSIZE = pointCloudInfo.rows;
+  SnapshotSegment segment ;
+  const BasicSnapshotSource<Scalar> source(readSnapshots<Scalar>(segment, params, pcfs)) ;
+  const auto &snapshots(source.matrix()) ;
+  const pointCloudFileInfo pointCloudInfo(read_pcf_info(pcfs[0])) ;
   double end(omp_get_wtime());
   const auto snapsReadingTime(end - start) ;
   std::cout << "\t\t\t\t Done in " << snapsReadingTime << "s \n"
   << std::endl;
 
+  /* Complex values take two columns each */
+  const long columnsSize(NumTraits<Scalar>::IsComplex ? 2 * params.m_varSize : params.m_varSize) ;
   std::cout << "File contains " << pointCloudInfo.rows << " rows and " << pointCloudInfo.columns << " columns. "
-  << "Read data from columns " << (params.m_offset + 1) << " to " << (params.m_offset + params.m_varSize) << ".\n"
+  << "Read data from columns " << (params.m_offset + 1) << " to " << (params.m_offset + columnsSize) << ".\n"
   << std::endl;
 
   // READING MODE FILES
@@ -49,15 +329,8 @@ void reconstruct(ez::ezOptionParser &opt) {
   start = omp_get_wtime();
   const auto MVSIZE(pointCloudInfo.rows * params.m_varSize) ;
   std::cout << "Reading modes..." << std::flush;
-  std::ifstream readMode(params.m_modeDirName + "/mode.bin", std::ios::binary) ;
-  if (!readMode.is_open())
-    throw "Could not open mode file" ;
-
-  readMode.seekg(0, std::ios::end);
-  const auto NSIZE(readMode.tellg() / MVSIZE) ;
-  MatrixXd m(MVSIZE, NSIZE);
-  readMode.seekg(0, std::ios::beg);
-  readMode.read(reinterpret_cast<char*>(m.data()), m.size() * sizeof(double)) ;
+  ScalarMatrix<Scalar> m(read_binary_matrix<Scalar>(params.m_modeDirName + "/mode.bin", MVSIZE)) ;
+  convert_layout(m, params.m_varSize, read_matrix_layout(params.m_modeDirName + "/mode.bin"), params.m_layout) ;
 
   end = omp_get_wtime();
   const auto modesReadingTime(end - start) ;
@@ -67,38 +340,33 @@ void reconstruct(ez::ezOptionParser &opt) {
   // COMPUTING BASES COEFFICIENTS
   start = omp_get_wtime();
   std::cout << "Computing coefficients..." << std::flush;
-  MatrixXd c = MatrixXd::Zero(TSIZE, NSIZE);
-#pragma omp parallel
-#pragma omp for
-  for (size_t l = 0; l < NSIZE; l++)
-  {
-    for (size_t k = 0; k < TSIZE; k++)
-    {
-      for (size_t j = 0; j < params.m_varSize ; j++){
-        for(auto i = 0; i < REF_MSIZE; i++) {
-          c(k, l) += m(i + REF_MSIZE * j, l) * snapshots(i + REF_MSIZE * j, k) ;
-        }
-      }
-    }
-  }
+  const BasicProjector<Scalar> projector(m) ;
+  const ScalarMatrix<Scalar> c(projector.coefficients(snapshots)) ;
   end = omp_get_wtime();
   const auto coeffComputingTime(end - start) ;
   std::cout << "\t\t\t\t Done in " << coeffComputingTime << "s \n"
   << std::endl;
 
+  // COMPUTING ERROR CURVES
+  auto errorComputingTime(0.) ;
+  if (params.m_errorCurves)
+  {
+    start = omp_get_wtime();
+    std::cout << "Computing error curves..." << std::flush;
+    VectorXd globalError, energy ;
+    MatrixXd snapError(projection_error_curves<Scalar>(snapshots.colwise().squaredNorm().transpose().template cast<double>(),
+                                                       c, globalError, energy, projector.gram())) ;
+    write_error_curves(params.m_recDirName, snapError, globalError, energy) ;
+    end = omp_get_wtime();
+    errorComputingTime = end - start ;
+    std::cout << "\t\t\t Done in " << errorComputingTime << "s \n"
+    << std::endl;
+  }
+
   // COMPUTE RECONSTRUCTED FIELDS
   start = omp_get_wtime();
   std::cout << "Computing reconstructed fields..." << std::flush;
-  MatrixXd rec = MatrixXd::Zero(MVSIZE, TSIZE);
-#pragma omp parallel
-#pragma omp for
-  for (size_t i = 0; i < TSIZE; i++)
-  {
-    for (size_t j = 0; j < NSIZE; j++)
-    {
-      rec.col(i) = rec.col(i) + c(i, j) * m.block(0, j, MVSIZE, 1);
-    }
-  }
+  const ScalarMatrix<Scalar> rec(projector.reconstruct(c)) ;
   end = omp_get_wtime();
   const auto recComputingTime(end - start) ;
   std::cout << "\t\t Done in " << recComputingTime << "s \n" << std::endl;
@@ -108,18 +376,61 @@ void reconstruct(ez::ezOptionParser &opt) {
   std::cout << "Writing reconstructed fields..." << std::flush;
   std::ofstream writeField(params.m_recDirName + "/reconstruction.bin", std::ios::binary);
   if(writeField.is_open()) {
-    writeField.write(reinterpret_cast<const char*>(rec.data()), rec.size() * sizeof(double)) ;
+    writeField.write(reinterpret_cast<const char*>(rec.data()), rec.size() * sizeof(Scalar)) ;
     writeField.close() ;
   }
+  write_matrix_info(params.m_recDirName + "/reconstruction.bin", rec.rows(), rec.cols(), params.m_varSize, params.m_layout,
+                    scalar_type_of<Scalar>()) ;
   end = omp_get_wtime();
-  const auto resWritingTime(end - start) ;
+  auto resWritingTime(end - start) ;
   std::cout << "\t\t\t Done in " << resWritingTime << "s \n"
   << std::endl;
 
-  const auto globalTime(snapsReadingTime+modesReadingTime+coeffComputingTime+recComputingTime+resWritingTime) ;
+  if (params.m_writeRaw)
+    resWritingTime += writeRawReconstruction<Scalar>(params, t, rec) ;
+
+  const auto globalTime(snapsReadingTime+modesReadingTime+coeffComputingTime+errorComputingTime+recComputingTime+resWritingTime) ;
   std::cout << "Everything done in " << globalTime << "s \n" << std::endl;
 }
 
+/*
+Reconstruction with modes of Scalar values.
+*/
+template <typename Scalar>
+void reconstructScalar(Parameters &params) {
+  if (!params.m_outTimesFileName.empty())
+  {
+    reconstructAtTimes<Scalar>(params) ;
+    return ;
+  }
+
+  if (params.m_watch)
+  {
+    watchSnapshots<Scalar>(params) ;
+    return ;
+  }
+
+  reconstructSnapshots<Scalar>(params) ;
+}
+
+void reconstruct(ez::ezOptionParser &opt) {
+  std::cout << "Starting reconstruction routine " << std::endl ;
+
+  Parameters params(opt) ;
+
+  /* The scalar type of the modes is recorded in their description */
+  const int scalar(read_matrix_scalar(params.m_modeDirName + "/mode.bin")) ;
+  if (scalar != SCALAR_DOUBLE)
+    std::cout << "Modes of " << scalar_name(scalar) << " values." << std::endl ;
+
+  if (scalar == SCALAR_FLOAT)
+    reconstructScalar<float>(params) ;
+  else if (scalar == SCALAR_COMPLEX)
+    reconstructScalar<std::complex<double>>(params) ;
+  else
+    reconstructScalar<double>(params) ;
+}
+
 int main(int argc, const char *argv[])
 {
   ez::ezOptionParser opt;
@@ -172,7 +483,7 @@ int main(int argc, const char *argv[])
 
   opt.add(
       "",                                                                // Default.
-      1,                                                                 // Required?
+      0,                                                                 // Required?
       1,                                                                 // Number of args expected.
       0,                                                                 // Delimiter if expecting multiple args.
       "Directory where the time directories reside as sub-directories.", // Help description.
@@ -199,7 +510,7 @@ int main(int argc, const char *argv[])
 
   opt.add(
       "",                             // Default.
-      1,                              // Required?
+      0,                              // Required?
       1,                              // Number of args expected.
       0,                              // Delimiter if expecting multiple args.
       "File with time snapshot list", // Help description.
@@ -208,13 +519,129 @@ int main(int argc, const char *argv[])
 
   opt.add(
       "",                                             // Default.
-      1,                                              // Required?
+      0,                                              // Required?
       1,                                              // Number of args expected.
       0,                                              // Delimiter if expecting multiple args.
       "Point cloud file name (in time directories).", // Help description.
       Parameters::m_dataFileNameOpt// Flag token.
       );
 
+  opt.add(
+      "",                   // Default.
+      0,                    // Required?
+      1,                    // Number of args expected.
+      0,                    // Delimiter if expecting multiple args.
+      "Chronos directory (with -ot).", // Help description.
+      Parameters::m_chronosDirNameOpt                 // Flag token.
+      );
+
+  opt.add(
+      "",                                                            // Default.
+      0,                                                             // Required?
+      1,                                                             // Number of args expected.
+      0,                                                             // Delimiter if expecting multiple args.
+      "File with output time list. Chronos are interpolated at these times instead of projecting the snapshots.", // Help description.
+      Parameters::m_outTimesFileNameOpt                              // Flag token.
+      );
+
+  ez::ezOptionValidator *vInterp = new ez::ezOptionValidator("s1", "gele", "1,2");
+  opt.add(
+      "1", // 1 : Cubic spline, 2 : Band-limited (Lanczos-windowed sinc, equally spaced snapshots)
+      0,
+      1,
+      0,
+      "Chronos interpolation type (with -ot).",
+      Parameters::m_interpTypeOpt,
+      vInterp
+      );
+
+  opt.add(
+      "",                                                                         // Default.
+      0,                                                                          // Required?
+      0,                                                                          // Number of args expected.
+      0,                                                                          // Delimiter if expecting multiple args.
+      "Write projection error curves for every rank to the reconstruction directory.", // Help description.
+      Parameters::m_errorCurvesOpt                                                // Flag token.
+      );
+
+  opt.add(
+      "",                                                                 // Default.
+      0,                                                                  // Required?
+      0,                                                                  // Number of args expected.
+      0,                                                                  // Delimiter if expecting multiple args.
+      "Also write the reconstructions as raw point cloud files in <recDir>/<time>/.", // Help description.
+      Parameters::m_writeRawOpt                                           // Flag token.
+      );
+
+  opt.add(
+      "",                                                         // Default.
+      0,                                                          // Required?
+      1,                                                          // Number of args expected.
+      0,                                                          // Delimiter if expecting multiple args.
+      "Point coordinates file (pointCloud.xy or .dat) prepended to the raw files.", // Help description.
+      Parameters::m_pointsFileNameOpt                             // Flag token.
+      );
+
+  ez::ezOptionValidator *vLayout = new ez::ezOptionValidator("s1", "gele", "0,1");
+  opt.add(
+      "0", // 0 : Component-blocked (x of all points, then y...), 1 : Point-interleaved (x, y, z of each point)
+      0,
+      1,
+      0,
+      "Row layout of the snapshots and reconstructions (modes are converted if needed).",
+      Parameters::m_layoutOpt,
+      vLayout
+      );
+
+  opt.add(
+      "",                                                                     // Default.
+      0,                                                                      // Required?
+      1,                                                                      // Number of args expected.
+      0,                                                                      // Delimiter if expecting multiple args.
+      "Shared snapshot segment: attached if published from the same files, else read and published (see PODSHM).", // Help description.
+      Parameters::m_shmNameOpt                                                // Flag token.
+      );
+
+  opt.add(
+      "",                                                                        // Default.
+      0,                                                                         // Required?
+      0,                                                                         // Number of args expected.
+      0,                                                                         // Delimiter if expecting multiple args.
+      "Project the snapshots of -i as the solver completes them, appending the coefficients and residuals to <recDir>/watchCoefficients.bin.", // Help description.
+      Parameters::m_watchOpt                                                     // Flag token.
+      );
+
+  ez::ezOptionValidator *vPos = new ez::ezOptionValidator("d", "gt", "0");
+  opt.add(
+      "",                                                                   // Default.
+      0,                                                                    // Required?
+      1,                                                                    // Number of args expected.
+      0,                                                                    // Delimiter if expecting multiple args.
+      "Poll the time directories every given seconds instead of using inotify (with -watch).", // Help description.
+      Parameters::m_watchPollOpt,                                           // Flag token.
+      vPos                                                                  // Validate input
+      );
+
+  opt.add(
+      "",                                                                   // Default.
+      0,                                                                    // Required?
+      1,                                                                    // Number of args expected.
+      0,                                                                    // Delimiter if expecting multiple args.
+      "Stop watching after the given seconds without a new snapshot (with -watch).", // Help description.
+      Parameters::m_watchIdleOpt,                                           // Flag token.
+      vPos                                                                  // Validate input
+      );
+
+  opt.add(
+      "",                                                            // Default.
+      0,                                                             // Required?
+      1,                                                             // Number of args expected.
+      0,                                                             // Delimiter if expecting multiple args.
+      "Number of modes projected on (with -watch; all by default).", // Help description.
+      Parameters::m_recRankOpt,                                      // Flag token.
+      vS4                                                            // Validate input
+      );
+
   // Perform the actual parsing of the command line.
   opt.parse(argc, argv);
 
@@ -227,8 +654,8 @@ int main(int argc, const char *argv[])
   // Perform validations of input parameters.
   //
   // Check if directories exist.
-  std::array<std::string, 3> dirflags = {Parameters::m_inputDirNameOpt, Parameters::m_modeDirNameOpt,
-                                         Parameters::m_recDirNameOpt};
+  std::array<std::string, 4> dirflags = {Parameters::m_inputDirNameOpt, Parameters::m_modeDirNameOpt,
+                                         Parameters::m_recDirNameOpt, Parameters::m_chronosDirNameOpt};
   for (auto &dirflag : dirflags)
   {
     if (opt.isSet(dirflag))
@@ -271,11 +698,40 @@ int main(int argc, const char *argv[])
     return 1;
   }
 
+  // Snapshots are only needed when projecting, chronos only when interpolating,
+  // and the snapshot times are discovered when watching.
+  if (opt.isSet(Parameters::m_outTimesFileNameOpt))
+    badOptions = {Parameters::m_timesFileNameOpt, Parameters::m_chronosDirNameOpt} ;
+  else if (opt.isSet(Parameters::m_watchOpt))
+    badOptions = {Parameters::m_inputDirNameOpt, Parameters::m_dataFileNameOpt} ;
+  else
+    badOptions = {Parameters::m_timesFileNameOpt, Parameters::m_inputDirNameOpt, Parameters::m_dataFileNameOpt} ;
+
+  for (auto &flag : badOptions)
+  {
+    if (!opt.isSet(flag))
+    {
+      std::cerr << "ERROR: Missing required option " << flag << ".\n\n";
+      Usage(opt);
+      return 1;
+    }
+  }
+
   std::string firstArg;
   if (opt.firstArgs.size() > 0)
     firstArg = *opt.firstArgs[0];
 
-  reconstruct(opt) ;
+  simd_kernels() ;
+
+  try
+  {
+    reconstruct(opt) ;
+  }
+  catch (const char *message)
+  {
+    std::cerr << "ERROR: " << message << ".\n\n";
+    return 1;
+  }
 
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,186 @@
+//
+// Randomized SVD of the snapshot matrix, streamed from the point cloud files.
+//
+
+#include <cmath>
+#include <random>
+#include <fstream>
+#include <iostream>
+#include <functional>
+#include <omp.h>
+
+#include "rsvd.h"
+
+/*
+Rows first..first+rows-1 of a Gaussian test matrix. Every row is drawn from
+its own seed, so that the matrix is never stored and any batch of rows can be
+regenerated.
+*/
+template <typename Scalar>
+static ScalarMatrix<Scalar> gaussian_rows(const long first, const long rows, const long cols, const unsigned seed)
+{
+  ScalarMatrix<Scalar> g(rows, cols) ;
+
+  for (long r = 0; r < rows; r++)
+  {
+    std::mt19937 gen(seed + 7919u * (unsigned)(first + r)) ;
+    std::normal_distribution<double> normal ;
+    for (long c = 0; c < cols; c++)
+    {
+      /* Complex entries: real then imaginary part */
+      const double re(normal(gen)) ;
+      if constexpr (NumTraits<Scalar>::IsComplex)
+        g(r, c) = Scalar(re, normal(gen)) ;
+      else
+        g(r, c) = Scalar(re) ;
+    }
+  }
+
+  return g ;
+}
+
+template <typename Scalar>
+static ScalarMatrix<Scalar> orthonormal_basis(const ScalarMatrix<Scalar> &y)
+{
+  HouseholderQR<ScalarMatrix<Scalar>> qr(y) ;
+  return qr.householderQ() * ScalarMatrix<Scalar>::Identity(y.rows(), y.cols()) ;
+}
+
+template <typename Scalar>
+void randomized_pod(const std::vector<std::string> &pcfs,
+                    const Parameters &params,
+                    long &pointSize,
+                    VectorXd &eigval,
+                    ScalarMatrix<Scalar> &modes,
+                    ScalarMatrix<Scalar> &chronos,
+                    VectorXd &snapNorm2)
+{
+  typedef typename NumTraits<Scalar>::Real Real ;
+  const FlushDenormals flush(std::is_same<Scalar, float>::value) ;
+  const long TSIZE(pcfs.size()) ;
+  const pointCloudFileInfo info(read_pcf_info(pcfs[0])) ;
+  pointSize = info.rows ;
+  const long NSIZE(pointSize * params.m_varSize) ;
+
+  const long sketchSize(std::min((long)params.m_podSize + params.m_rsvdOversampling, std::min(NSIZE, TSIZE))) ;
+  const long coSketchSize(std::min(2 * sketchSize + 1, NSIZE)) ;
+  const long probesSize(10) ;
+  const bool singlePass(params.m_rsvdPower == 0) ;
+  const long batchSize(std::min(std::max(4L * params.m_threadsSize, 16L), TSIZE)) ;
+
+  std::cout << "Randomized SVD: rank " << sketchSize << " (oversampling " << params.m_rsvdOversampling << "), "
+            << params.m_rsvdPower << " power iterations, " << (singlePass ? 1 : params.m_rsvdPower + 2)
+            << " passes over the files." << std::endl ;
+
+  auto stream = [&](const std::function<void(long, const Ref<const ScalarMatrix<Scalar>>&)> &process) {
+    stream_snapshots<Scalar>(pcfs, pointSize, params.m_varSize, params.m_offset, params.m_layout, batchSize, process) ;
+  } ;
+
+  // SKETCHING PASS
+
+  /* Range sketch, followed by independent probes for the error estimate */
+  ScalarMatrix<Scalar> y(ScalarMatrix<Scalar>::Zero(NSIZE, sketchSize + probesSize)) ;
+  ScalarMatrix<Scalar> psi, w ;
+  if (singlePass)
+  {
+    psi = gaussian_rows<Scalar>(0, coSketchSize, NSIZE, 2u) ;
+    w.resize(coSketchSize, TSIZE) ;
+  }
+  snapNorm2.resize(TSIZE) ;
+
+  stream([&](const long first, const Ref<const ScalarMatrix<Scalar>> &b) {
+    y.noalias() += b * gaussian_rows<Scalar>(first, b.cols(), sketchSize + probesSize, 1u) ;
+    if (singlePass)
+      w.middleCols(first, b.cols()).noalias() = psi * b ;
+    snapNorm2.segment(first, b.cols()) = b.colwise().squaredNorm().transpose().template cast<double>() ;
+  }) ;
+
+  const ScalarMatrix<Scalar> probes(y.rightCols(probesSize)) ;
+  ScalarMatrix<Scalar> q(orthonormal_basis<Scalar>(y.leftCols(sketchSize))) ;
+  y.resize(0, 0) ;
+
+  // POWER ITERATIONS
+
+  for (int it = 0; it < params.m_rsvdPower; it++)
+  {
+    ScalarMatrix<Scalar> z(ScalarMatrix<Scalar>::Zero(NSIZE, sketchSize)) ;
+    stream([&](const long, const Ref<const ScalarMatrix<Scalar>> &b) {
+      z.noalias() += b * (b.adjoint() * q) ;
+    }) ;
+    q = orthonormal_basis<Scalar>(z) ;
+  }
+
+  // PROJECTION OF THE SNAPSHOTS ON THE RANGE
+
+  ScalarMatrix<Scalar> b(sketchSize, TSIZE) ;
+  if (singlePass)
+  {
+    b = (psi * q).colPivHouseholderQr().solve(w) ;
+    psi.resize(0, 0) ;
+    w.resize(0, 0) ;
+  }
+  else
+  {
+    stream([&](const long first, const Ref<const ScalarMatrix<Scalar>> &s) {
+      b.middleCols(first, s.cols()).noalias() = q.adjoint() * s ;
+    }) ;
+  }
+
+  /* SVD of the small projection B = U S V^H through the eigen-decomposition
+  of B B^H: modes Q U, eigenvalues S^2 / T and chronos U^H B = S V^H */
+  SelfAdjointEigenSolver<ScalarMatrix<Scalar>> eigensolver(b * b.adjoint()) ;
+  if (eigensolver.info() != Success)
+    throw "Eigen-solver of the randomized SVD did not converge" ;
+  const ScalarMatrix<Scalar> u = eigensolver.eigenvectors().rowwise().reverse() ;
+  eigval = (eigensolver.eigenvalues().reverse().array().max(Real(0)) / Real(TSIZE)).template cast<double>() ;
+  modes = q * u ;
+  chronos = u.adjoint() * b ;
+
+  // ERROR ESTIMATES
+
+  /* ||(I - Q Q^H) M||_2 <= 10 sqrt(2/pi) max_i ||(I - Q Q^H) M omega_i||
+  with probability 1 - 10^-probes (Halko et al., 2011, eq. 4.3) */
+  const ScalarMatrix<Scalar> residual(probes - q * (q.adjoint() * probes)) ;
+  const double bound(10. * std::sqrt(2. / M_PI) * residual.colwise().norm().maxCoeff()) ;
+  const double sigma1(std::sqrt(eigval(0) * TSIZE)) ;
+  std::cout << "Randomized SVD error estimate: ||M - Q Q^H M||_2 <= " << bound << " (" << bound / sigma1
+            << " of the largest singular value) with probability 1 - 1e-" << probesSize << "." << std::endl ;
+
+  /* Relative Frobenius residual of the rank-r truncation. Exact when the
+  snapshots are projected on the range in a last pass, an estimate when the
+  projection is recovered from the co-range sketch. */
+  const double norm2(snapNorm2.sum()) ;
+  std::ofstream writeError(params.m_chronosDirName + "/rsvdError.dat") ;
+  if (writeError.is_open())
+  {
+    writeError << "# rank relativeFrobeniusError" << (singlePass ? " (estimate)" : "") << std::endl ;
+    double captured(0.) ;
+    for (long r = 0; r < sketchSize; r++)
+    {
+      captured += eigval(r) * TSIZE ;
+      writeError << r + 1 << " " << std::sqrt(std::max(norm2 - captured, 0.) / norm2) << std::endl ;
+    }
+    writeError.close() ;
+  }
+
+  /* Singular values below the bound are not resolved by the sketch and the
+  single pass overestimates them: only the modes above it are kept */
+  long resolved(1) ;
+  while (resolved < sketchSize && std::sqrt(eigval(resolved) * TSIZE) > bound)
+    ++resolved ;
+  if (resolved < sketchSize)
+  {
+    std::cout << "Randomized SVD: " << resolved << " modes above the error estimate kept"
+              << (resolved < params.m_podSize ? ", increase -rsvd-q or -rsvd-p for more" : "") << "." << std::endl ;
+    eigval.conservativeResize(resolved) ;
+    modes.conservativeResize(NoChange, resolved) ;
+    chronos.conservativeResize(resolved, NoChange) ;
+  }
+}
+
+template void randomized_pod<float>(const std::vector<std::string>&, const Parameters&, long&, VectorXd&, MatrixXf&,
+                                    MatrixXf&, VectorXd&) ;
+template void randomized_pod<double>(const std::vector<std::string>&, const Parameters&, long&, VectorXd&, MatrixXd&,
+                                     MatrixXd&, VectorXd&) ;
+template void randomized_pod<std::complex<double>>(const std::vector<std::string>&, const Parameters&, long&,
+                                                   VectorXd&, MatrixXcd&, MatrixXcd&, VectorXd&) ;
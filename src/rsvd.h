@@ -0,0 +1,52 @@
+//
+// Randomized SVD of the snapshot matrix, streamed from the point cloud files.
+//
+
+#ifndef POD_RSVD_H
+#define POD_RSVD_H
+
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+
+#include "utils.h"
+
+using namespace Eigen;
+
+/*
+Leading POD of the snapshots stored in the files pcfs by a randomized range
+finder (Halko, Martinsson & Tropp, 2011), without forming the T x T
+correlation matrix. The snapshots are streamed in batches of columns, read in
+parallel, and multiplied on the fly by Gaussian test matrices generated per
+snapshot, so that only N x (k + p) and (k + p) x T matrices are stored, k
+being -nm and p the oversampling -rsvd-p.
+
+With -rsvd-q 0 the files are read once: the range sketch Y = M Omega and a
+co-range sketch W = Psi M are accumulated together and the projection of the
+snapshots on the range is recovered from W (Tropp et al., 2017). With q > 0,
+q power iterations Y = (M M^H)^q M Omega sharpen the range for slowly decaying
+spectra, each reading the files once, and a last pass projects the snapshots
+exactly; the files are read q + 2 times. The single pass is the cheapest but
+its eigenvalues are overestimated when the spectrum decays slowly, one power
+iteration (the default) is usually enough to resolve the leading modes.
+
+On return eigval holds the approximate eigenvalues of the correlation matrix
+whose singular value exceeds the error estimate (at most k + p), modes the
+orthonormal modes, chronos their coefficients (modes x times, as in the
+method of snapshots) and snapNorm2 the squared norms of the snapshots, whose
+sum gives the trace. The error estimates (probe bound on the spectral norm of
+the residual, Frobenius residual per rank) are printed and written to
+chronosDir/rsvdError.dat. Instantiated for float, double and
+std::complex<double> snapshots (complex Gaussian test matrices, adjoints for
+the transposes).
+*/
+template <typename Scalar>
+void randomized_pod(const std::vector<std::string> &pcfs,
+                    const Parameters &params,
+                    long &pointSize,
+                    VectorXd &eigval,
+                    ScalarMatrix<Scalar> &modes,
+                    ScalarMatrix<Scalar> &chronos,
+                    VectorXd &snapNorm2) ;
+
+#endif //POD_RSVD_H
@@ -0,0 +1,275 @@
+//
+// Snapshot matrices published in shared memory, for the next processes.
+//
+
+#include <atomic>
+#include <cerrno>
+#include <complex>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+#include "shmsnapshots.h"
+
+static const char segmentMagic[8] = {'P', 'O', 'D', 'S', 'H', 'M', '0', '2'} ;
+static const char shmPrefix[] = "pod." ;
+static const int64_t pageSize(4096) ;
+
+static bool is_file_name(const std::string &name)
+{
+  return name.find('/') != std::string::npos ;
+}
+
+static std::string shm_name(const std::string &name)
+{
+  return std::string("/") + shmPrefix + name ;
+}
+
+static int64_t scalar_size(const int64_t scalar)
+{
+  return scalar == SCALAR_FLOAT ? sizeof(float) :
+         scalar == SCALAR_COMPLEX ? sizeof(std::complex<double>) : sizeof(double) ;
+}
+
+/* FNV-1a */
+static void hash_bytes(uint64_t &hash, const void *data, const size_t size)
+{
+  const unsigned char *bytes(static_cast<const unsigned char*>(data)) ;
+  for (size_t i = 0; i < size; i++)
+  {
+    hash ^= bytes[i] ;
+    hash *= 1099511628211ull ;
+  }
+}
+
+SnapshotSegment::SnapshotSegment() :
+m_base(nullptr),
+m_size(0),
+m_header(nullptr) {
+}
+
+SnapshotSegment::~SnapshotSegment()
+{
+  detach() ;
+}
+
+void SnapshotSegment::detach()
+{
+  if (m_base)
+    munmap(m_base, m_size) ;
+  m_base = nullptr ;
+  m_header = nullptr ;
+  m_size = 0 ;
+}
+
+void SnapshotSegment::map(const int fd, const size_t size, const bool writable)
+{
+  void *base(mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0)) ;
+  if (base == MAP_FAILED)
+    throw "Could not map the shared snapshot segment" ;
+  m_base = base ;
+  m_size = size ;
+  m_header = static_cast<const SegmentHeader*>(base) ;
+}
+
+bool SnapshotSegment::attach(const std::string &name)
+{
+  detach() ;
+  const int fd(is_file_name(name) ? open(name.c_str(), O_RDONLY)
+                                  : shm_open(shm_name(name).c_str(), O_RDONLY, 0)) ;
+  if (fd < 0)
+  {
+    if (errno == ENOENT)
+      return false ;
+    throw "Could not open the shared snapshot segment" ;
+  }
+
+  struct stat info ;
+  if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(SegmentHeader))
+  {
+    close(fd) ;
+    throw "Shared snapshot segment is being published or is not a snapshot segment" ;
+  }
+
+  map(fd, info.st_size, false) ;
+  close(fd) ;
+
+  std::atomic_thread_fence(std::memory_order_acquire) ;
+  if (std::memcmp(m_header->magic, segmentMagic, sizeof(segmentMagic)) != 0
+      || m_header->dataOffset + m_header->rows * m_header->cols * scalar_size(m_header->scalar) > (int64_t)m_size)
+  {
+    detach() ;
+    throw "Shared snapshot segment is being published or is not a snapshot segment" ;
+  }
+  return true ;
+}
+
+template <typename Scalar>
+void SnapshotSegment::publish(const std::string &name,
+                              const std::vector<std::string> &pcfs,
+                              const long varSize,
+                              const long offset,
+                              const int layout)
+{
+  detach() ;
+  const pointCloudFileInfo info(read_pcf_info(pcfs[0])) ;
+  const int64_t rows(info.rows * varSize) ;
+  const int64_t cols(pcfs.size()) ;
+
+  const bool file(is_file_name(name)) ;
+  const int fd(file ? open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600)
+                    : shm_open(shm_name(name).c_str(), O_RDWR | O_CREAT | O_EXCL, 0600)) ;
+  if (fd < 0)
+    throw errno == EEXIST ? "Shared snapshot segment already exists" : "Could not create the shared snapshot segment" ;
+
+  /* Header on its own page; files (hugetlbfs) are sized in blocks of the file system */
+  int64_t size(pageSize + rows * cols * (int64_t)sizeof(Scalar)) ;
+  struct statvfs fsInfo ;
+  if (file && fstatvfs(fd, &fsInfo) == 0 && fsInfo.f_bsize > 0)
+    size = (size + fsInfo.f_bsize - 1) / fsInfo.f_bsize * fsInfo.f_bsize ;
+
+  try
+  {
+    if (ftruncate(fd, size) != 0)
+      throw "Could not size the shared snapshot segment" ;
+    map(fd, size, true) ;
+    close(fd) ;
+
+    SegmentHeader *header(static_cast<SegmentHeader*>(m_base)) ;
+    Scalar *data(reinterpret_cast<Scalar*>(static_cast<char*>(m_base) + pageSize)) ;
+
+#pragma omp parallel for schedule(dynamic)
+    for (int64_t j = 0; j < cols; j++)
+      read_pcf_to_column<Scalar>(pcfs[j], info.rows, varSize, offset, layout, data + j * rows) ;
+
+    header->fingerprint = fingerprint(pcfs, varSize, offset, layout, scalar_type_of<Scalar>()) ;
+    header->rows = rows ;
+    header->cols = cols ;
+    header->varSize = varSize ;
+    header->offset = offset ;
+    header->layout = layout ;
+    header->scalar = scalar_type_of<Scalar>() ;
+    header->dataOffset = pageSize ;
+    header->size = size ;
+    header->created = std::time(nullptr) ;
+    std::strncpy(header->source, pcfs[0].c_str(), sizeof(header->source) - 1) ;
+
+    /* Complete segment, then the magic */
+    std::atomic_thread_fence(std::memory_order_release) ;
+    std::memcpy(header->magic, segmentMagic, sizeof(segmentMagic)) ;
+    msync(m_base, pageSize, MS_ASYNC) ;
+  }
+  catch (...)
+  {
+    if (!m_base)
+      close(fd) ;
+    detach() ;
+    remove(name) ;
+    throw ;
+  }
+}
+
+template <typename Scalar>
+BasicSnapshotSource<Scalar> SnapshotSegment::source() const
+{
+  if (!m_base)
+    throw "No shared snapshot segment attached" ;
+  if (m_header->scalar != scalar_type_of<Scalar>())
+    throw "The shared snapshot segment holds another scalar type (-scalar)" ;
+  const Scalar *data(reinterpret_cast<const Scalar*>(static_cast<const char*>(m_base) + m_header->dataOffset)) ;
+  return BasicSnapshotSource<Scalar>(data, m_header->rows, m_header->cols) ;
+}
+
+uint64_t SnapshotSegment::fingerprint(const std::vector<std::string> &pcfs,
+                                      const long varSize,
+                                      const long offset,
+                                      const int layout,
+                                      const int scalar)
+{
+  uint64_t hash(14695981039346656037ull) ;
+  const int64_t settings[4] = {varSize, offset, layout, scalar} ;
+  hash_bytes(hash, settings, sizeof(settings)) ;
+
+  for (const auto &fname : pcfs)
+  {
+    const std::string path(std::filesystem::absolute(fname).lexically_normal().string()) ;
+    hash_bytes(hash, path.data(), path.size() + 1) ;
+
+    struct stat info ;
+    if (stat(fname.c_str(), &info) != 0)
+      throw "Could not stat a snapshot file" ;
+    const int64_t file[3] = {(int64_t)info.st_size, (int64_t)info.st_mtim.tv_sec, (int64_t)info.st_mtim.tv_nsec} ;
+    hash_bytes(hash, file, sizeof(file)) ;
+  }
+  return hash ;
+}
+
+bool SnapshotSegment::remove(const std::string &name)
+{
+  return (is_file_name(name) ? unlink(name.c_str()) : shm_unlink(shm_name(name).c_str())) == 0 ;
+}
+
+std::vector<std::string> SnapshotSegment::list()
+{
+  std::vector<std::string> names ;
+  std::error_code error ;
+  for (const auto &entry : std::filesystem::directory_iterator("/dev/shm", error))
+  {
+    const std::string fname(entry.path().filename().string()) ;
+    if (fname.compare(0, sizeof(shmPrefix) - 1, shmPrefix) == 0)
+      names.push_back(fname.substr(sizeof(shmPrefix) - 1)) ;
+  }
+  return names ;
+}
+
+template <typename Scalar>
+BasicSnapshotSource<Scalar> shared_snapshots(SnapshotSegment &segment,
+                                             const std::string &name,
+                                             const std::vector<std::string> &pcfs,
+                                             const long varSize,
+                                             const long offset,
+                                             const int layout)
+{
+  const uint64_t fingerprint(SnapshotSegment::fingerprint(pcfs, varSize, offset, layout, scalar_type_of<Scalar>())) ;
+  if (segment.attach(name))
+  {
+    if (segment.header().fingerprint != fingerprint)
+      throw "The shared snapshot segment was published from other files or options (remove it with PODSHM -remove)" ;
+    std::cout << "Attached shared snapshot segment " << name << "." << std::endl ;
+    return segment.source<Scalar>() ;
+  }
+
+  try
+  {
+    segment.publish<Scalar>(name, pcfs, varSize, offset, layout) ;
+    std::cout << "Published shared snapshot segment " << name << "." << std::endl ;
+    return segment.source<Scalar>() ;
+  }
+  catch (const char *message)
+  {
+    /* Published concurrently by another process */
+    if (std::strcmp(message, "Shared snapshot segment already exists") != 0)
+      throw ;
+    std::cout << "Shared snapshot segment " << name << " is being published by another process, "
+              << "reading the files." << std::endl ;
+    return BasicSnapshotSource<Scalar>::read(pcfs, varSize, offset, layout) ;
+  }
+}
+
+#define POD_INSTANTIATE_SHMSNAPSHOTS(Scalar) \
+  template void SnapshotSegment::publish<Scalar>(const std::string&, const std::vector<std::string>&, const long, \
+                                                 const long, const int) ; \
+  template BasicSnapshotSource<Scalar> SnapshotSegment::source<Scalar>() const ; \
+  template BasicSnapshotSource<Scalar> shared_snapshots<Scalar>(SnapshotSegment&, const std::string&, \
+                                                                const std::vector<std::string>&, const long, \
+                                                                const long, const int) ;
+
+POD_INSTANTIATE_SHMSNAPSHOTS(float)
+POD_INSTANTIATE_SHMSNAPSHOTS(double)
+POD_INSTANTIATE_SHMSNAPSHOTS(std::complex<double>)
@@ -0,0 +1,127 @@
+//
+// Snapshot matrices published in shared memory, for the next processes.
+//
+
+#ifndef POD_SHMSNAPSHOTS_H
+#define POD_SHMSNAPSHOTS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "libpod.h"
+
+/*
+Description at the start of a segment, the snapshots (column-major values of
+the scalar type, ScalarType) following at dataOffset. The magic is written
+last, once the snapshots are in place, so that a segment being published is
+not attached.
+*/
+struct SegmentHeader {
+  char magic[8] ;
+  uint64_t fingerprint ;
+  int64_t rows ;
+  int64_t cols ;
+  int64_t varSize ;
+  int64_t offset ;
+  int64_t layout ;
+  int64_t scalar ;
+  int64_t dataOffset ;
+  int64_t size ;
+  int64_t created ;     // seconds since the epoch
+  char source[1024] ;   // first snapshot file, for listings
+} ;
+
+/*
+Snapshot matrix of point cloud files parsed once into a named segment that
+later processes on the node map read-only, without copy. A name without '/'
+is a POSIX shared-memory object (/dev/shm/pod.<name>); a path is a file, e.g.
+on a hugetlbfs mount (/dev/hugepages/<name>) for huge pages, its size being
+rounded to the block size of the file system.
+
+A segment outlives the processes: it is removed explicitly (PODSHM -remove)
+or at reboot. It records a fingerprint of the files it was read from (names,
+sizes and modification times, number of values, offset and layout), checked
+when attaching, so that a process never uses snapshots of another time list or
+of rewritten files. The snapshots are held as Scalar values (-scalar), the
+type being part of the fingerprint.
+*/
+class SnapshotSegment {
+public:
+  SnapshotSegment() ;
+  ~SnapshotSegment() ;
+
+  SnapshotSegment(const SnapshotSegment&) = delete ;
+  SnapshotSegment &operator=(const SnapshotSegment&) = delete ;
+
+  /*
+  Map the segment read-only. Returns false if there is no such segment; throws
+  if it is not a complete snapshot segment.
+  */
+  bool attach(const std::string &name) ;
+
+  /*
+  Create the segment (which must not exist) and parse the files into it as
+  Scalar values, in parallel. The segment is removed if reading fails.
+  */
+  template <typename Scalar>
+  void publish(const std::string &name,
+               const std::vector<std::string> &pcfs,
+               const long varSize,
+               const long offset,
+               const int layout) ;
+
+  void detach() ;
+
+  bool attached() const { return m_base != nullptr ; }
+  const SegmentHeader &header() const { return *m_header ; }
+
+  /*
+  View of the snapshots, valid while the segment is attached. Throws if they
+  are not Scalar values.
+  */
+  template <typename Scalar = double>
+  BasicSnapshotSource<Scalar> source() const ;
+
+  /*
+  Fingerprint of the files and of the way they are read.
+  */
+  static uint64_t fingerprint(const std::vector<std::string> &pcfs,
+                              const long varSize,
+                              const long offset,
+                              const int layout,
+                              const int scalar = SCALAR_DOUBLE) ;
+
+  /*
+  Remove the segment; returns false if there was none.
+  */
+  static bool remove(const std::string &name) ;
+
+  /*
+  Names of the POSIX shared-memory segments (not the files).
+  */
+  static std::vector<std::string> list() ;
+
+private:
+  void map(const int fd, const size_t size, const bool writable) ;
+
+  void *m_base ;
+  size_t m_size ;
+  const SegmentHeader *m_header ;
+} ;
+
+/*
+Scalar snapshots of the segment name if it exists and was published from the
+same files as the same type (else throws), or read from the files and
+published to it. If another process is publishing the segment, the files are
+read without it.
+*/
+template <typename Scalar = double>
+BasicSnapshotSource<Scalar> shared_snapshots(SnapshotSegment &segment,
+                                             const std::string &name,
+                                             const std::vector<std::string> &pcfs,
+                                             const long varSize,
+                                             const long offset,
+                                             const int layout) ;
+
+#endif //POD_SHMSNAPSHOTS_H
@@ -0,0 +1,59 @@
+//
+// Hot kernels compiled for several instruction sets, dispatched at run time.
+//
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "simd.h"
+#include "utils.h"
+
+static const SimdKernels *simdTables[] = {&simdKernelsSse2, &simdKernelsAvx2, &simdKernelsAvx512} ;
+
+int simd_supported_path()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init() ;
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq"))
+    return SIMD_AVX512 ;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return SIMD_AVX2 ;
+#endif
+  return SIMD_SSE2 ;
+}
+
+static const SimdKernels &select_simd_kernels()
+{
+  const int supported(simd_supported_path()) ;
+  int path(supported) ;
+
+  const char *requested(std::getenv("POD_SIMD")) ;
+  if (requested && *requested)
+  {
+    int wanted(-1) ;
+    for (const auto table : simdTables)
+      if (std::strcmp(requested, table->name) == 0)
+        wanted = table->path ;
+
+    if (wanted < 0)
+      std::cerr << "Unknown POD_SIMD path " << requested << " (sse2, avx2 or avx512), ignored." << std::endl ;
+    else if (wanted > supported)
+      std::cerr << "POD_SIMD path " << requested << " is not supported by this processor, ignored." << std::endl ;
+    else
+      path = wanted ;
+  }
+
+  if (library_verbose())
+    std::cout << "SIMD kernels: " << simdTables[path]->name << " (processor supports "
+              << simdTables[supported]->name << (path != supported ? ", overridden by POD_SIMD" : "") << ")."
+              << std::endl ;
+  return *simdTables[path] ;
+}
+
+const SimdKernels &simd_kernels()
+{
+  /* Selected once, thread-safe */
+  static const SimdKernels &kernels(select_simd_kernels()) ;
+  return kernels ;
+}
@@ -0,0 +1,112 @@
+//
+// Hot kernels compiled for several instruction sets, dispatched at run time.
+//
+
+#ifndef POD_SIMD_H
+#define POD_SIMD_H
+
+#include <complex>
+#include <type_traits>
+
+/*
+Instruction set of a kernel table. The build flags target the baseline
+(x86-64, SSE2), so that the binaries run on every node; the kernels below are
+also compiled with AVX2 and FMA, and with AVX-512, in their own translation
+units, and the best table supported by the processor is chosen once: by the
+drivers at startup, after option parsing, and by the libraries at the first
+use. The environment variable POD_SIMD (sse2, avx2 or avx512) overrides
+the choice, for testing; a path the processor does not support is refused.
+*/
+enum SimdPath {
+  SIMD_SSE2 = 0,
+  SIMD_AVX2 = 1,    // AVX2 and FMA
+  SIMD_AVX512 = 2   // AVX-512 F and DQ
+};
+
+/*
+c = alpha op(a) op(b), or c += alpha op(a) op(b) if accumulate, with
+column-major matrices given by their pointer and leading dimension, op(x)
+being x or x^H (x^T for real scalars): op(a) is m x k, op(b) is k x n and c is
+m x n. Single-threaded, for the blocks computed by the threads of the callers.
+*/
+template <typename Scalar>
+using ScalarGemmKernel = void (*)(const bool transA, const bool transB,
+                                  const long m, const long n, const long k,
+                                  const Scalar alpha,
+                                  const Scalar *a, const long lda,
+                                  const Scalar *b, const long ldb,
+                                  const bool accumulate,
+                                  Scalar *c, const long ldc) ;
+
+/*
+out(i) = sum_k g(k + w) ext(i + k) for i < size and |k| <= w, ext being
+padded with w values on each side (the SPOD filter of one diagonal). The
+filter g is real, converted to the precision of ext.
+*/
+template <typename Scalar>
+using ScalarConvolveKernel = void (*)(const Scalar *ext, const long size,
+                                      const double *g, const long w,
+                                      Scalar *out) ;
+
+typedef ScalarGemmKernel<double> GemmKernel ;
+typedef ScalarConvolveKernel<double> ConvolveKernel ;
+
+/*
+The kernels of every scalar type of the POD (-scalar): double, float and
+std::complex<double>.
+*/
+struct SimdKernels {
+  int path ;
+  const char *name ;
+  GemmKernel gemm ;
+  ConvolveKernel convolve ;
+  ScalarGemmKernel<float> gemmFloat ;
+  ScalarConvolveKernel<float> convolveFloat ;
+  ScalarGemmKernel<std::complex<double>> gemmComplex ;
+  ScalarConvolveKernel<std::complex<double>> convolveComplex ;
+} ;
+
+/*
+Kernels of a table for the given scalar type.
+*/
+template <typename Scalar>
+ScalarGemmKernel<Scalar> gemm_kernel(const SimdKernels &kernels)
+{
+  if constexpr (std::is_same<Scalar, float>::value)
+    return kernels.gemmFloat ;
+  else if constexpr (std::is_same<Scalar, std::complex<double>>::value)
+    return kernels.gemmComplex ;
+  else
+    return kernels.gemm ;
+}
+
+template <typename Scalar>
+ScalarConvolveKernel<Scalar> convolve_kernel(const SimdKernels &kernels)
+{
+  if constexpr (std::is_same<Scalar, float>::value)
+    return kernels.convolveFloat ;
+  else if constexpr (std::is_same<Scalar, std::complex<double>>::value)
+    return kernels.convolveComplex ;
+  else
+    return kernels.convolve ;
+}
+
+/*
+Kernel tables of every path (simd_<path>.cpp).
+*/
+extern const SimdKernels simdKernelsSse2 ;
+extern const SimdKernels simdKernelsAvx2 ;
+extern const SimdKernels simdKernelsAvx512 ;
+
+/*
+Best path supported by the processor (CPUID).
+*/
+int simd_supported_path() ;
+
+/*
+Kernels of the chosen path. The first call selects them and logs a line
+naming the path; the drivers make it before their first stage prints.
+*/
+const SimdKernels &simd_kernels() ;
+
+#endif //POD_SIMD_H
@@ -0,0 +1,10 @@
+//
+// SIMD kernels compiled for AVX2 and FMA.
+//
+
+#define Eigen EigenSimdAvx2
+#include "simdkernels.inl"
+
+const SimdKernels simdKernelsAvx2 = {SIMD_AVX2, "avx2", gemm<double>, convolve<double>,
+                                     gemm<float>, convolve<float>,
+                                     gemm<std::complex<double>>, convolve<std::complex<double>>} ;
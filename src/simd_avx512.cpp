@@ -0,0 +1,10 @@
+//
+// SIMD kernels compiled for AVX-512 F and DQ, with FMA.
+//
+
+#define Eigen EigenSimdAvx512
+#include "simdkernels.inl"
+
+const SimdKernels simdKernelsAvx512 = {SIMD_AVX512, "avx512", gemm<double>, convolve<double>,
+                                       gemm<float>, convolve<float>,
+                                       gemm<std::complex<double>>, convolve<std::complex<double>>} ;
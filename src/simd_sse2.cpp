@@ -0,0 +1,10 @@
+//
+// SIMD kernels compiled for the baseline (SSE2).
+//
+
+#define Eigen EigenSimdSse2
+#include "simdkernels.inl"
+
+const SimdKernels simdKernelsSse2 = {SIMD_SSE2, "sse2", gemm<double>, convolve<double>,
+                                     gemm<float>, convolve<float>,
+                                     gemm<std::complex<double>>, convolve<std::complex<double>>} ;
@@ -0,0 +1,90 @@
+//
+// Body of the SIMD kernels, included by simd_<path>.cpp, each compiled with
+// the flags of its instruction set.
+//
+// The includer defines Eigen to a name of its own before including this file:
+// the Eigen templates instantiated here are then in a namespace of their own,
+// and cannot be merged by the linker with the baseline instantiations of the
+// other translation units (which would run AVX code on any processor, or SSE2
+// code on every one). For the same reason no header of the project including
+// Eigen may be included here, only simd.h. The products are the blocks of the
+// threads of the callers: Eigen does not start threads of its own.
+//
+
+#define EIGEN_DONT_PARALLELIZE
+#include <Eigen/Core>
+
+#include "simd.h"
+
+namespace {
+
+template <typename Scalar>
+using Matrix = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> ;
+template <typename Scalar>
+using ConstMap = Eigen::Map<const Matrix<Scalar>, 0, Eigen::OuterStride<>> ;
+template <typename Scalar>
+using Map = Eigen::Map<Matrix<Scalar>, 0, Eigen::OuterStride<>> ;
+
+template <typename A, typename B, typename C>
+void product(const A &a, const B &b, const typename C::Scalar alpha, const bool accumulate, C &c)
+{
+  if (accumulate)
+    c.noalias() += alpha * a * b ;
+  else
+    c.noalias() = alpha * a * b ;
+}
+
+/* adjoint() is transpose() for real scalars */
+template <typename Scalar>
+void gemm(const bool transA, const bool transB,
+          const long m, const long n, const long k,
+          const Scalar alpha,
+          const Scalar *a, const long lda,
+          const Scalar *b, const long ldb,
+          const bool accumulate,
+          Scalar *c, const long ldc)
+{
+  if (m == 0 || n == 0)
+    return ;
+
+  Map<Scalar> cm(c, m, n, Eigen::OuterStride<>(ldc)) ;
+  if (k == 0)
+  {
+    if (!accumulate)
+      cm.setZero() ;
+    return ;
+  }
+
+  const ConstMap<Scalar> am(a, transA ? k : m, transA ? m : k, Eigen::OuterStride<>(lda)) ;
+  const ConstMap<Scalar> bm(b, transB ? n : k, transB ? k : n, Eigen::OuterStride<>(ldb)) ;
+
+  if (transA && transB)
+    product(am.adjoint(), bm.adjoint(), alpha, accumulate, cm) ;
+  else if (transA)
+    product(am.adjoint(), bm, alpha, accumulate, cm) ;
+  else if (transB)
+    product(am, bm.adjoint(), alpha, accumulate, cm) ;
+  else
+    product(am, bm, alpha, accumulate, cm) ;
+}
+
+template <typename Scalar>
+void convolve(const Scalar *ext, const long size, const double *g, const long w, Scalar *out)
+{
+  typedef typename Eigen::NumTraits<Scalar>::Real Real ;
+
+  for (long i = 0; i < size; i++)
+    out[i] = Scalar(0) ;
+
+  /* One axpy per filter coefficient, vectorised along the line */
+  for (long k = -w; k <= w; k++)
+  {
+    const Real gk(g[k + w]) ;
+    const Scalar *src(ext + k) ;
+    for (long i = 0; i < size; i++)
+      out[i] += gk * src[i] ;
+  }
+}
+
+}
+
@@ -0,0 +1,219 @@
+//
+// Detection of the snapshot files completed by a running solver.
+//
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <dirent.h>
+#include <omp.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include "snapshotwatcher.h"
+
+/*
+Time directory names are numbers.
+*/
+static bool is_time_name(const std::string &name, double &time)
+{
+  char *end(nullptr) ;
+  time = std::strtod(name.c_str(), &end) ;
+  return !name.empty() && end && *end == '\0' ;
+}
+
+static double time_value(const std::string &name)
+{
+  double time(0.) ;
+  is_time_name(name, time) ;
+  return time ;
+}
+
+SnapshotWatcher::SnapshotWatcher(const std::string &inputDir, const std::string &dataFileName,
+                                 const long pointSize, const double pollInterval) :
+m_inputDir(inputDir),
+m_dataFileName(dataFileName),
+m_pointSize(pointSize),
+m_pollInterval(pollInterval),
+m_fd(-1),
+m_dirWatch(-1) {
+#ifdef __linux__
+  if (m_pollInterval <= 0.)
+  {
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC) ;
+    if (m_fd >= 0)
+      m_dirWatch = inotify_add_watch(m_fd, m_inputDir.c_str(), IN_CREATE | IN_MOVED_TO | IN_ONLYDIR) ;
+    if (m_fd >= 0 && m_dirWatch < 0)
+    {
+      close(m_fd) ;
+      m_fd = -1 ;
+    }
+  }
+#endif
+  if (m_fd < 0 && m_pollInterval <= 0.)
+  {
+    std::cout << "inotify not available, polling " << m_inputDir << " every 0.1s." << std::endl ;
+    m_pollInterval = 0.1 ;
+  }
+  scan_directories() ;
+}
+
+SnapshotWatcher::~SnapshotWatcher()
+{
+  if (m_fd >= 0)
+    close(m_fd) ;
+}
+
+void SnapshotWatcher::scan_directories()
+{
+  DIR *dir(opendir(m_inputDir.c_str())) ;
+  if (!dir)
+    throw "Could not read the input directory" ;
+
+  while (const dirent *entry = readdir(dir))
+  {
+    double time ;
+    const std::string name(entry->d_name) ;
+    if (is_time_name(name, time) && !m_done.count(name) && !m_pending.count(name))
+    {
+      struct stat info ;
+      if (stat((m_inputDir + "/" + name).c_str(), &info) == 0 && S_ISDIR(info.st_mode))
+        add_directory(name) ;
+    }
+  }
+  closedir(dir) ;
+}
+
+void SnapshotWatcher::add_directory(const std::string &time)
+{
+  m_pending[time] = -1 ;
+#ifdef __linux__
+  if (m_fd >= 0)
+  {
+    const int wd(inotify_add_watch(m_fd, (m_inputDir + "/" + time).c_str(), IN_CLOSE_WRITE | IN_MOVED_TO)) ;
+    if (wd >= 0)
+      m_watches[wd] = time ;
+  }
+#endif
+}
+
+void SnapshotWatcher::check(const std::string &time, std::vector<WatchedSnapshot> &ready)
+{
+  auto pending(m_pending.find(time)) ;
+  if (pending == m_pending.end())
+    return ;
+
+  /* Unchanged since found incomplete */
+  const std::string fname(m_inputDir + "/" + time + "/" + m_dataFileName) ;
+  struct stat info ;
+  if (stat(fname.c_str(), &info) != 0 || info.st_size == pending->second)
+    return ;
+  pending->second = info.st_size ;
+
+  /* Complete when every point has its line */
+  std::ifstream file(fname, std::ios::binary) ;
+  const std::string buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()) ;
+  if (buffer.empty() || buffer.back() != '\n' || std::count(buffer.begin(), buffer.end(), '\n') != m_pointSize)
+    return ;
+
+  ready.push_back({time, fname, omp_get_wtime()}) ;
+  m_done.insert(time) ;
+  m_pending.erase(pending) ;
+#ifdef __linux__
+  for (auto it = m_watches.begin(); it != m_watches.end(); ++it)
+  {
+    if (it->second == time)
+    {
+      inotify_rm_watch(m_fd, it->first) ;
+      m_watches.erase(it) ;
+      break ;
+    }
+  }
+#endif
+}
+
+void SnapshotWatcher::read_events(std::vector<WatchedSnapshot> &ready)
+{
+#ifdef __linux__
+  alignas(inotify_event) char buffer[16384] ;
+  ssize_t size ;
+  while ((size = read(m_fd, buffer, sizeof(buffer))) > 0)
+  {
+    for (char *p = buffer; p < buffer + size; p += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(p)->len)
+    {
+      const inotify_event *event(reinterpret_cast<inotify_event*>(p)) ;
+      if (event->mask & IN_Q_OVERFLOW)
+      {
+        scan_directories() ;
+        continue ;
+      }
+      const std::string name(event->len > 0 ? event->name : "") ;
+      double time ;
+      if (event->wd == m_dirWatch && (event->mask & IN_ISDIR) && is_time_name(name, time)
+          && !m_done.count(name) && !m_pending.count(name))
+      {
+        /* The file may have been written before the directory was watched */
+        add_directory(name) ;
+        check(name, ready) ;
+      }
+      else if (name == m_dataFileName && m_watches.count(event->wd))
+      {
+        auto pending(m_pending.find(m_watches[event->wd])) ;
+        if (pending != m_pending.end())
+        {
+          pending->second = -1 ;
+          check(pending->first, ready) ;
+        }
+      }
+    }
+  }
+#endif
+}
+
+std::vector<WatchedSnapshot> SnapshotWatcher::wait(const double timeout)
+{
+  std::vector<WatchedSnapshot> ready ;
+  const double deadline(omp_get_wtime() + timeout) ;
+  bool recheck(true) ;
+  while (true)
+  {
+    if (m_fd >= 0)
+      read_events(ready) ;
+    else
+      scan_directories() ;
+
+    /* Pending snapshots, every poll or when inotify was quiet */
+    if (recheck)
+    {
+      std::vector<std::string> times ;
+      for (const auto &pending : m_pending)
+        times.push_back(pending.first) ;
+      for (const auto &time : times)
+        check(time, ready) ;
+    }
+
+    const double remaining(deadline - omp_get_wtime()) ;
+    if (!ready.empty() || remaining <= 0.)
+      break ;
+
+    if (m_fd >= 0)
+    {
+      pollfd events = {m_fd, POLLIN, 0} ;
+      recheck = poll(&events, 1, (int)(std::min(remaining, 1.) * 1.e3) + 1) == 0 ;
+    }
+    else
+      std::this_thread::sleep_for(std::chrono::duration<double>(std::min(remaining, m_pollInterval))) ;
+  }
+
+  std::sort(ready.begin(), ready.end(), [](const WatchedSnapshot &a, const WatchedSnapshot &b) {
+    return time_value(a.time) < time_value(b.time) ;
+  }) ;
+  return ready ;
+}
@@ -0,0 +1,74 @@
+//
+// Detection of the snapshot files completed by a running solver.
+//
+
+#ifndef POD_SNAPSHOTWATCHER_H
+#define POD_SNAPSHOTWATCHER_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+/*
+Snapshot file completed in a time directory, and when its completion was
+detected (omp_get_wtime()).
+*/
+struct WatchedSnapshot {
+  std::string time ;
+  std::string fname ;
+  double detected ;
+} ;
+
+/*
+Time directories of inputDir (names that are numbers, as written by the
+sampling function object) whose dataFileName is complete, i.e. holds the
+pointSize lines of the point cloud, each ended. Every snapshot is reported
+once, even if the file is rewritten later (e.g. when its coordinates are
+erased).
+
+The directory and the new time directories are watched with inotify, a file
+being checked when it is closed after writing or moved in place, and the
+pending ones being checked again every second in case an event was missed.
+Where inotify is not available, or if pollInterval (seconds) is given, the
+directories are scanned every pollInterval instead, and a file is only read
+again once its size has changed.
+*/
+class SnapshotWatcher {
+public:
+  SnapshotWatcher(const std::string &inputDir, const std::string &dataFileName, const long pointSize,
+                  const double pollInterval = 0.) ;
+  ~SnapshotWatcher() ;
+
+  SnapshotWatcher(const SnapshotWatcher&) = delete ;
+  SnapshotWatcher &operator=(const SnapshotWatcher&) = delete ;
+
+  /*
+  Whether inotify is used.
+  */
+  bool notified() const { return m_fd >= 0 ; }
+
+  /*
+  Snapshots completed since the last call (on the first call, the ones already
+  there), in time order. Waits at most timeout seconds for one.
+  */
+  std::vector<WatchedSnapshot> wait(const double timeout) ;
+
+private:
+  void scan_directories() ;
+  void add_directory(const std::string &time) ;
+  void check(const std::string &time, std::vector<WatchedSnapshot> &ready) ;
+  void read_events(std::vector<WatchedSnapshot> &ready) ;
+
+  std::string m_inputDir ;
+  std::string m_dataFileName ;
+  long m_pointSize ;
+  double m_pollInterval ;
+  int m_fd ;
+  int m_dirWatch ;
+  std::map<int, std::string> m_watches ;    // time directory of every watch
+  std::map<std::string, long> m_pending ;   // incomplete snapshot, size of the file when checked
+  std::set<std::string> m_done ;
+} ;
+
+#endif //POD_SNAPSHOTWATCHER_H
@@ -0,0 +1,305 @@
+//
+// Spectral POD filtering of the correlation matrix (Sieber et al., 2016).
+//
+
+#include <complex>
+#include <fstream>
+#include <iostream>
+#include <unsupported/Eigen/FFT>
+#include <omp.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "spod.h"
+#include "simd.h"
+
+VectorXd spod_filter_weights(const int type, const int width)
+{
+  int nfSize = 2 * width + 1;
+
+  VectorXd g = VectorXd::Ones(nfSize);
+
+  if (type == SPOD_GAUSS)
+  {
+    VectorXd gauss = VectorXd::LinSpaced(nfSize, -2.285, 2.285);
+    g = exp(-square(gauss.array()));
+  }
+
+  return g / g.sum();
+}
+
+template <typename Scalar>
+void spod_filter(const ScalarMatrix<Scalar> &pm,
+                 const std::vector<VectorXd> &filters,
+                 const int boundary,
+                 const std::vector<ScalarMatrix<Scalar>*> &spms)
+{
+  typedef Matrix<Scalar, Dynamic, 1> Vector ;
+  const long TSIZE(pm.rows()) ;
+
+  long maxWidth(0) ;
+  for (const auto &g : filters)
+    maxWidth = std::max(maxWidth, (long)(g.size() - 1) / 2) ;
+
+  for (auto spm : spms)
+    spm->resize(TSIZE, TSIZE) ;
+
+  /* With wrap-around, diagonal d holds the entries (i, (i+d) mod T) and is
+  the transpose of diagonal T-d. Without it, diagonal d holds (i, i+d). */
+  const long diagsSize(boundary == SPOD_PERIODIC ? TSIZE / 2 + 1 : TSIZE) ;
+  const ScalarConvolveKernel<Scalar> convolve(convolve_kernel<Scalar>(simd_kernels())) ;
+
+#pragma omp parallel
+  {
+    /* Diagonal with maxWidth samples of padding on each side */
+    Vector line(TSIZE + 2 * maxWidth) ;
+    Vector out(TSIZE) ;
+
+#pragma omp for schedule(dynamic, 16)
+    for (long d = 0; d < diagsSize; d++)
+    {
+      const long lineSize(boundary == SPOD_PERIODIC ? TSIZE : TSIZE - d) ;
+      Scalar *ext(line.data() + maxWidth) ;
+
+      for (long i = 0; i < lineSize; i++)
+      {
+        const long j(i + d < TSIZE ? i + d : i + d - TSIZE) ;
+        ext[i] = pm(i, j) ;
+      }
+
+      for (long k = 1; k <= maxWidth; k++)
+      {
+        if (boundary == SPOD_PERIODIC)
+        {
+          ext[-k] = ext[((-k) % TSIZE + TSIZE) % TSIZE] ;
+          ext[lineSize - 1 + k] = ext[(lineSize - 1 + k) % TSIZE] ;
+        }
+        else
+        {
+          ext[-k] = Scalar(0) ;
+          ext[lineSize - 1 + k] = Scalar(0) ;
+        }
+      }
+
+      for (size_t f = 0; f < filters.size(); f++)
+      {
+        const VectorXd &g(filters[f]) ;
+        const long w((g.size() - 1) / 2) ;
+
+        convolve(ext, lineSize, g.data(), w, out.data()) ;
+
+        /* The transposed entry of a Hermitian matrix is conjugated */
+        ScalarMatrix<Scalar> &spm(*spms[f]) ;
+        for (long i = 0; i < lineSize; i++)
+        {
+          const long j(i + d < TSIZE ? i + d : i + d - TSIZE) ;
+          spm(i, j) = out(i) ;
+          spm(j, i) = numext::conj(out(i)) ;
+        }
+      }
+    }
+  }
+}
+
+template void spod_filter<float>(const MatrixXf&, const std::vector<VectorXd>&, const int, const std::vector<MatrixXf*>&) ;
+template void spod_filter<double>(const MatrixXd&, const std::vector<VectorXd>&, const int, const std::vector<MatrixXd*>&) ;
+template void spod_filter<std::complex<double>>(const MatrixXcd&, const std::vector<VectorXd>&, const int,
+                                                const std::vector<MatrixXcd*>&) ;
+
+template <typename Scalar>
+void frequency_spod(const Ref<const ScalarMatrix<Scalar>> &m, const double dt, const Parameters &params)
+{
+  typedef typename NumTraits<Scalar>::Real Real ;
+  typedef std::complex<Real> Complex ;
+  typedef Matrix<Real, Dynamic, 1> RealVector ;
+  typedef Matrix<Complex, Dynamic, Dynamic> ComplexMatrix ;
+  const bool isFloat(std::is_same<Scalar, float>::value) ;
+  const long NSIZE(m.rows()) ;
+  const long TSIZE(m.cols()) ;
+
+  /* Default: blocks of a quarter of the series, 50% overlap. A complex series
+  has a two-sided spectrum, its bins above nfft / 2 being the negative
+  frequencies. */
+  const long nfft(std::min(params.m_fspodNfft > 0 ? (long)params.m_fspodNfft : std::max(TSIZE / 4, 2L), TSIZE)) ;
+  const long overlap(params.m_fspodOverlap >= 0 ? std::min((long)params.m_fspodOverlap, nfft - 1) : nfft / 2) ;
+  const long blocksSize((TSIZE - overlap) / (nfft - overlap)) ;
+  const long binsSize(NumTraits<Scalar>::IsComplex ? nfft : nfft / 2 + 1) ;
+
+  std::vector<int> freqs(params.m_fspodFreqs) ;
+  if (freqs.empty())
+  {
+    for (int k = 0; k < binsSize; k++)
+      freqs.push_back(k) ;
+  }
+  for (auto k : freqs)
+  {
+    if (k < 0 || k >= binsSize)
+      throw "Frequency bin out of range" ;
+  }
+  const long freqsSize(freqs.size()) ;
+  const long modesSize(params.m_podSize > 0 ? std::min((long)params.m_podSize, blocksSize) : blocksSize) ;
+
+  std::cout << "Frequency-domain SPOD: " << blocksSize << " blocks of " << nfft << " snapshots (overlap "
+            << overlap << "), " << freqsSize << " of " << binsSize << " frequency bins, df = "
+            << 1. / (nfft * dt) << "." << std::endl ;
+
+  /* Hann window, with the scaling that makes Q^H Q / blocks a power
+  spectral density */
+  VectorXd w(nfft) ;
+  for (long n = 0; n < nfft; n++)
+    w(n) = 0.5 * (1. - std::cos(2. * M_PI * n / nfft)) ;
+  const double scale(std::sqrt(dt / w.squaredNorm())) ;
+
+  const Matrix<Scalar, Dynamic, 1> mean(m.rowwise().mean()) ;
+
+  /* Fourier coefficients of rows r0..r0+rows of every block at the selected
+  bins, q[f] (rows x blocks), the tile being gathered time-contiguously so
+  that each snapshot column segment is read once */
+  const long tileSize(64) ;
+  auto transform = [&](FFT<Real> &fft, ScalarMatrix<Scalar> &tile, std::vector<Complex> &spectrum,
+                       const long r0, const long rows, std::vector<ComplexMatrix> &q) {
+    for (long f = 0; f < freqsSize; f++)
+      q[f].resize(rows, blocksSize) ;
+    for (long b = 0; b < blocksSize; b++)
+    {
+      const long first(b * (nfft - overlap)) ;
+      for (long n = 0; n < nfft; n++)
+        for (long r = 0; r < rows; r++)
+          tile(n, r) = Real(w(n)) * (m(r0 + r, first + n) - mean(r0 + r)) ;
+
+      for (long r = 0; r < rows; r++)
+      {
+        fft.fwd(spectrum.data(), tile.col(r).data(), nfft) ;
+        for (long f = 0; f < freqsSize; f++)
+          q[f](r, b) = Real(scale) * spectrum[freqs[f]] ;
+      }
+    }
+  } ;
+
+  // CROSS-SPECTRAL DENSITY, TILE BY TILE
+
+  /* csd[f] = Q_f^H Q_f / blocks accumulated over the tiles of rows, one sum
+  per thread added in thread order so that the result does not depend on
+  the schedule */
+  std::vector<std::vector<ComplexMatrix>> partials(omp_get_max_threads()) ;
+
+#pragma omp parallel
+  {
+    const FlushDenormals flush(isFloat) ;
+    FFT<Real> fft ;
+    fft.SetFlag(FFT<Real>::HalfSpectrum) ;
+    ScalarMatrix<Scalar> tile(nfft, tileSize) ;
+    std::vector<Complex> spectrum(nfft) ;
+    std::vector<ComplexMatrix> q(freqsSize) ;
+    std::vector<ComplexMatrix> &csd(partials[omp_get_thread_num()]) ;
+    csd.assign(freqsSize, ComplexMatrix::Zero(blocksSize, blocksSize)) ;
+
+#pragma omp for schedule(static)
+    for (long r0 = 0; r0 < NSIZE; r0 += tileSize)
+    {
+      transform(fft, tile, spectrum, r0, std::min(tileSize, NSIZE - r0), q) ;
+      for (long f = 0; f < freqsSize; f++)
+        csd[f].noalias() += q[f].adjoint() * q[f] ;
+    }
+  }
+
+  // EIGEN-DECOMPOSITION OF THE CROSS-SPECTRAL DENSITY, BIN BY BIN
+
+  /* modes = Q_f V Lambda^-1/2 / sqrt(blocks), through the weights W_f */
+  std::vector<ComplexMatrix> weights(freqsSize) ;
+
+#pragma omp parallel for schedule(dynamic)
+  for (long f = 0; f < freqsSize; f++)
+  {
+    const FlushDenormals flush(isFloat) ;
+    ComplexMatrix csd(ComplexMatrix::Zero(blocksSize, blocksSize)) ;
+    for (const auto &partial : partials)
+    {
+      if (!partial.empty())
+        csd += partial[f] ;
+    }
+    csd /= Real(blocksSize) ;
+    SelfAdjointEigenSolver<ComplexMatrix> eigensolver(csd) ;
+
+    const VectorXd eigval = eigensolver.eigenvalues().reverse().template cast<double>() ;
+    const ComplexMatrix eigvec = eigensolver.eigenvectors().rowwise().reverse() ;
+
+    RealVector factor(modesSize) ;
+    for (long i = 0; i < modesSize; i++)
+      factor(i) = eigval(i) > 0. ? Real(1. / std::sqrt(eigval(i) * blocksSize)) : Real(0) ;
+    weights[f] = eigvec.leftCols(modesSize) * factor.asDiagonal() ;
+
+    std::ofstream writeEigval(params.m_chronosDirName + "/eigenValues.f" + std::to_string(freqs[f]) + ".bin",
+                              std::ios::binary) ;
+    if (writeEigval.is_open()) {
+      writeEigval.write(reinterpret_cast<const char*>(eigval.data()), eigval.size() * sizeof(double)) ;
+      writeEigval.close() ;
+    }
+  }
+  partials.clear() ;
+
+  // MODES, TILE BY TILE
+
+  /* The spectra of every tile are computed again and its mode rows written
+  in place: column i of mode.f<k>.bin starts at i * rows values */
+  std::vector<int> modeFiles(freqsSize, -1) ;
+  const off_t modeBytes(NSIZE * modesSize * sizeof(Complex)) ;
+  for (long f = 0; f < freqsSize; f++)
+  {
+    const std::string fname(params.m_modeDirName + "/mode.f" + std::to_string(freqs[f]) + ".bin") ;
+    modeFiles[f] = open(fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644) ;
+    if (modeFiles[f] < 0 || ftruncate(modeFiles[f], modeBytes) != 0)
+    {
+      for (auto fd : modeFiles)
+        if (fd >= 0)
+          close(fd) ;
+      throw "Could not write mode file" ;
+    }
+  }
+
+  bool written(true) ;
+#pragma omp parallel reduction(&&:written)
+  {
+    const FlushDenormals flush(isFloat) ;
+    FFT<Real> fft ;
+    fft.SetFlag(FFT<Real>::HalfSpectrum) ;
+    ScalarMatrix<Scalar> tile(nfft, tileSize) ;
+    std::vector<Complex> spectrum(nfft) ;
+    std::vector<ComplexMatrix> q(freqsSize) ;
+    ComplexMatrix modes ;
+
+#pragma omp for schedule(dynamic)
+    for (long r0 = 0; r0 < NSIZE; r0 += tileSize)
+    {
+      const long rows(std::min(tileSize, NSIZE - r0)) ;
+      transform(fft, tile, spectrum, r0, rows, q) ;
+      for (long f = 0; f < freqsSize; f++)
+      {
+        modes.noalias() = q[f] * weights[f] ;
+        for (long i = 0; i < modesSize; i++)
+        {
+          const size_t bytes(rows * sizeof(Complex)) ;
+          const off_t offset((i * NSIZE + r0) * sizeof(Complex)) ;
+          written = pwrite(modeFiles[f], modes.col(i).data(), bytes, offset) == (ssize_t)bytes && written ;
+        }
+      }
+    }
+  }
+
+  for (auto fd : modeFiles)
+    close(fd) ;
+  if (!written)
+    throw "Could not write mode file" ;
+
+  std::ofstream writeFreqs(params.m_chronosDirName + "/frequencies.dat") ;
+  if (writeFreqs.is_open()) {
+    writeFreqs << "# bin frequency" << std::endl ;
+    for (auto k : freqs)
+      writeFreqs << k << " " << (2 * k <= nfft ? k : k - nfft) / (nfft * dt) << std::endl ;
+    writeFreqs.close() ;
+  }
+}
+
+template void frequency_spod<float>(const Ref<const MatrixXf>&, const double, const Parameters&) ;
+template void frequency_spod<double>(const Ref<const MatrixXd>&, const double, const Parameters&) ;
+template void frequency_spod<std::complex<double>>(const Ref<const MatrixXcd>&, const double, const Parameters&) ;
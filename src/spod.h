@@ -0,0 +1,75 @@
+//
+// Spectral POD filtering of the correlation matrix (Sieber et al., 2016).
+//
+
+#ifndef POD_SPOD_H
+#define POD_SPOD_H
+
+#include <vector>
+#include <Eigen/Dense>
+
+#include "utils.h"
+
+using namespace Eigen;
+
+/*
+Filter types (as given to -spod-type).
+*/
+enum SpodFilterType {
+  SPOD_NONE = 0,
+  SPOD_BOX = 1,
+  SPOD_GAUSS = 2,
+  SPOD_FREQUENCY = 3  // Frequency-domain (Welch) SPOD, not a filter
+};
+
+/*
+Treatment of the ends of the time series when filtering.
+*/
+enum SpodBoundary {
+  SPOD_PERIODIC = 0,  // The snapshot sequence wraps around
+  SPOD_ZERO = 1       // Samples outside the time series are zero
+};
+
+/*
+Normalised filter coefficients of 2*width+1 samples.
+*/
+VectorXd spod_filter_weights(const int type, const int width) ;
+
+/*
+Filter the symmetric (Hermitian) correlation matrix pm along its diagonals:
+  spm(i, j) = sum_k g(k + w) pm(i + k, j + k),  k = -w..w.
+Every (wrapped) diagonal is gathered once into a contiguous line and
+convolved with all the filters, so that several filter widths or types are
+evaluated in a single sweep over pm. The result is Hermitian: only half of
+the diagonals are computed and each is written to both triangles. Diagonals
+are distributed over the OpenMP threads. Every diagonal is only read by the
+thread that writes it, so that spms may include &pm to filter in place.
+*/
+template <typename Scalar>
+void spod_filter(const ScalarMatrix<Scalar> &pm,
+                 const std::vector<VectorXd> &filters,
+                 const int boundary,
+                 const std::vector<ScalarMatrix<Scalar>*> &spms) ;
+
+/*
+Frequency-domain SPOD (Towne, Schmidt & Colonius, 2018) of the snapshots m,
+sampled every dt. The series is split into blocks of -fspod-nfft snapshots
+overlapping by -fspod-overlap, each Hann-windowed and Fourier transformed in
+time after removing the temporal mean, and only the selected frequency bins
+(-fspod-freqs, default all) are kept: nfft / 2 + 1 bins for real snapshots,
+nfft for complex ones, whose spectrum is two-sided. The rows are processed by
+tiles over the threads, so that the spectra of a tile only are resident: a
+first pass accumulates the cross-spectral density of every bin (blocks x
+blocks), which is decomposed with the method of snapshots, and a second pass
+transforms the tiles again and writes their mode rows. Beyond m, the memory
+is that of the blocks x blocks matrices of the bins.
+
+Per bin k, the eigenvalues are written to chronosDir/eigenValues.f<k>.bin
+(doubles) and the complex modes (rows x modes, real and imaginary parts
+interleaved, in the precision of Scalar) to modeDir/mode.f<k>.bin.
+chronosDir/frequencies.dat lists the bins.
+*/
+template <typename Scalar>
+void frequency_spod(const Ref<const ScalarMatrix<Scalar>> &m, const double dt, const Parameters &params) ;
+
+#endif //POD_SPOD_H
@@ -0,0 +1,124 @@
+//
+// Dependency graph of tasks executed by a pool of threads.
+//
+
+#include <iomanip>
+#include <thread>
+#include <omp.h>
+
+#include "taskgraph.h"
+
+TaskGraph::TaskGraph(const int workersSize, const int ompThreadsSize) :
+m_workersSize(std::max(workersSize, 1)),
+m_ompThreadsSize(ompThreadsSize),
+m_doneSize(0),
+m_origin(0.) {
+}
+
+TaskGraph::TaskId TaskGraph::add(const std::string &name,
+                                 const std::function<void()> &work,
+                                 const std::vector<TaskId> &deps)
+{
+  std::lock_guard<std::mutex> lock(m_mutex) ;
+
+  const TaskId id(m_tasks.size()) ;
+  Task task = {name, work, 0, {}, false, 0., 0.} ;
+  for (auto dep : deps)
+  {
+    if (!m_tasks[dep].m_done)
+    {
+      m_tasks[dep].m_successors.push_back(id) ;
+      task.m_pendingDeps++ ;
+    }
+  }
+  m_tasks.push_back(task) ;
+
+  if (task.m_pendingDeps == 0)
+  {
+    m_ready.push_back(id) ;
+    m_cond.notify_one() ;
+  }
+
+  return id ;
+}
+
+void TaskGraph::worker()
+{
+  if (m_ompThreadsSize > 0)
+    omp_set_num_threads(m_ompThreadsSize) ;
+
+  std::unique_lock<std::mutex> lock(m_mutex) ;
+  while (true)
+  {
+    m_cond.wait(lock, [this]() { return !m_ready.empty() || m_doneSize == m_tasks.size() ; }) ;
+    if (m_ready.empty())
+      break ;
+
+    /* Tasks are started in the order they became ready */
+    const TaskId id(m_ready.front()) ;
+    m_ready.erase(m_ready.begin()) ;
+    const bool skip(m_error != nullptr) ;
+    std::function<void()> work(m_tasks[id].m_work) ;
+    m_tasks[id].m_start = omp_get_wtime() - m_origin ;
+    lock.unlock() ;
+
+    if (!skip)
+    {
+      try
+      {
+        work() ;
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> errorLock(m_mutex) ;
+        if (!m_error)
+          m_error = std::current_exception() ;
+      }
+    }
+
+    lock.lock() ;
+    Task &task(m_tasks[id]) ;
+    task.m_end = omp_get_wtime() - m_origin ;
+    task.m_done = true ;
+    m_doneSize++ ;
+    if (!skip)
+      std::cout << std::left << std::setw(48) << task.m_name + "..." << "Done in "
+                << task.m_end - task.m_start << "s" << std::endl ;
+
+    for (auto successor : task.m_successors)
+    {
+      if (--m_tasks[successor].m_pendingDeps == 0)
+        m_ready.push_back(successor) ;
+    }
+    m_cond.notify_all() ;
+  }
+}
+
+void TaskGraph::run()
+{
+  m_origin = omp_get_wtime() ;
+
+  std::vector<std::thread> workers ;
+  for (int i = 0; i < m_workersSize; i++)
+    workers.emplace_back(&TaskGraph::worker, this) ;
+  for (auto &w : workers)
+    w.join() ;
+
+  if (m_error)
+    std::rethrow_exception(m_error) ;
+}
+
+void TaskGraph::report(std::ostream &out) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex) ;
+
+  out << "\nStage spans (s since start):" << std::endl ;
+  for (const auto &task : m_tasks)
+  {
+    out << "  " << std::left << std::setw(46) << task.m_name
+        << std::right << std::fixed << std::setprecision(4)
+        << std::setw(10) << task.m_start << " -> " << std::setw(10) << task.m_end << std::endl ;
+  }
+  out.unsetf(std::ios::fixed) ;
+  out << std::setprecision(6) << std::endl ;
+}
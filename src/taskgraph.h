@@ -0,0 +1,74 @@
+//
+// Dependency graph of tasks executed by a pool of threads.
+//
+
+#ifndef POD_TASKGRAPH_H
+#define POD_TASKGRAPH_H
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+Tasks are added with the list of tasks they depend on and start as soon as all
+of them have completed. Tasks may be added while the graph runs (e.g. when the
+number of output blocks is only known once a stage is done). Every worker sets
+the number of OpenMP threads used by the parallel regions of its tasks.
+
+The start and end time of every task is recorded, and a line is logged when a
+task completes so that the overlap of the stages can be checked in the run
+log.
+*/
+class TaskGraph {
+public:
+  typedef size_t TaskId ;
+
+  TaskGraph(const int workersSize, const int ompThreadsSize) ;
+
+  /*
+  Add a task, which becomes ready when all deps have completed. Thread-safe.
+  */
+  TaskId add(const std::string &name,
+             const std::function<void()> &work,
+             const std::vector<TaskId> &deps = {}) ;
+
+  /*
+  Execute all tasks and return when they are completed. The first exception
+  thrown by a task is rethrown here; the tasks not started yet are skipped.
+  */
+  void run() ;
+
+  /*
+  Write the span of every task, in seconds since the start of run().
+  */
+  void report(std::ostream &out) const ;
+
+private:
+  struct Task {
+    std::string m_name ;
+    std::function<void()> m_work ;
+    size_t m_pendingDeps ;
+    std::vector<TaskId> m_successors ;
+    bool m_done ;
+    double m_start ;
+    double m_end ;
+  } ;
+
+  void worker() ;
+
+  int m_workersSize ;
+  int m_ompThreadsSize ;
+  std::vector<Task> m_tasks ;
+  std::vector<TaskId> m_ready ;
+  size_t m_doneSize ;
+  double m_origin ;
+  std::exception_ptr m_error ;
+  mutable std::mutex m_mutex ;
+  std::condition_variable m_cond ;
+} ;
+
+#endif //POD_TASKGRAPH_H
@@ -2,7 +2,19 @@
 // Created by encheryg on 02/05/2022.
 //
 
+#include <cstdio>
+#include <limits>
+#include <sys/resource.h>
+#include <unistd.h>
+#ifdef __SSE3__
+#include <pmmintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
 #include "utils.h"
+#include "components.h"
+#include "simd.h"
 
 std::vector<std::string> read_timefile(const std::string tfile)
 {
@@ -41,15 +53,163 @@ std::vector<std::string> split_string(const std::string &s, char delimiter)
   return tokens;
 }
 
+const char* layout_name(const int layout)
+{
+  return layout == LAYOUT_INTERLEAVED ? "interleaved" : "blocked" ;
+}
+
+const char* scalar_name(const int scalar)
+{
+  return scalar == SCALAR_FLOAT ? "float" : scalar == SCALAR_COMPLEX ? "complex" : "double" ;
+}
+
+FlushDenormals::FlushDenormals(const bool enabled) :
+m_csr(0) {
+#ifdef __SSE__
+  m_csr = _mm_getcsr() ;
+  if (enabled)
+    _mm_setcsr(m_csr | 0x8040) ;  // Flush to zero and denormals are zero
+#endif
+}
+
+FlushDenormals::~FlushDenormals()
+{
+#ifdef __SSE__
+  _mm_setcsr(m_csr) ;
+#endif
+}
+
+/*
+Size of a point cloud file.
+*/
+pointCloudFileInfo read_pcf_info(const std::string &fname)
+{
+  pointCloudFileInfo info;
+  info.rows = 0;
+  info.columns = 0;
+
+  std::ifstream file(fname);
+  if (file.is_open())
+  {
+    std::string unused_line;
+
+    /* Get a line and count the number of columns by splitting at spaces ' '.
+    Increment the row counter. */
+    getline(file, unused_line);
+    info.rows++;
+    auto tokens = split_string(unused_line, ' ');
+    info.columns = tokens.size();
+
+    /* Count the rest of the rows. */
+    while (getline(file, unused_line))
+      info.rows++;
+  }
+  file.close();
+
+  return info;
+}
+
+/*
+Parse one point cloud file into a snapshot column.
+*/
+void read_pcf_to_column(const std::string &fname,
+                        const long rows,
+                        const long no_cols,
+                        const long offset,
+                        const int layout,
+                        double *column)
+{
+  std::ifstream file(fname, std::ios::binary | std::ios::ate);
+
+  if (file.is_open())
+  {
+    /* The file is read in one block and parsed by the kernel of its number
+    of components */
+    const std::streamsize size(file.tellg());
+    std::string buffer(size, '\0');
+    file.seekg(0);
+    file.read(&buffer[0], size);
+    file.close();
+
+    component_kernels(no_cols).parse[layout](buffer.data(), buffer.data() + size, rows, no_cols, offset, column);
+  }
+  else
+  {
+    std::cerr << "Unable to open file " << fname << std::endl;
+  }
+}
+
+/*
+Parse one point cloud file into a snapshot column of Scalar values.
+*/
+template <typename Scalar>
+void read_pcf_to_column(const std::string &fname,
+                        const long rows,
+                        const long no_cols,
+                        const long offset,
+                        const int layout,
+                        Scalar *column)
+{
+  if constexpr (std::is_same<Scalar, double>::value)
+  {
+    read_pcf_to_column(fname, rows, no_cols, offset, layout, static_cast<double*>(column)) ;
+  }
+  else if constexpr (NumTraits<Scalar>::IsComplex)
+  {
+    /* Point after point, the real and imaginary parts of every component */
+    std::vector<double> values(2 * rows * no_cols) ;
+    read_pcf_to_column(fname, rows, 2 * no_cols, offset, LAYOUT_INTERLEAVED, values.data()) ;
+    for (long i = 0; i < rows; i++)
+      for (long j = 0; j < no_cols; j++)
+        column[layout_row(layout, i, j, rows, no_cols)] = Scalar(values[2 * (j + no_cols * i)],
+                                                                 values[2 * (j + no_cols * i) + 1]) ;
+  }
+  else
+  {
+    std::vector<double> values(rows * no_cols) ;
+    read_pcf_to_column(fname, rows, no_cols, offset, layout, values.data()) ;
+    for (size_t i = 0; i < values.size(); i++)
+      column[i] = Scalar(values[i]) ;
+  }
+}
+
+/*
+Read the snapshot files batch by batch.
+*/
+template <typename Scalar>
+void stream_snapshots(const std::vector<std::string> &fvec,
+                      const long rows,
+                      const long no_cols,
+                      const long offset,
+                      const int layout,
+                      const long batchSize,
+                      const std::function<void(long, const Ref<const ScalarMatrix<Scalar>>&)> &process)
+{
+  const long TSIZE(fvec.size()) ;
+  ScalarMatrix<Scalar> batch(rows * no_cols, std::min(batchSize, TSIZE)) ;
+
+  for (long first = 0; first < TSIZE; first += batchSize)
+  {
+    const long cols(std::min(batchSize, TSIZE - first)) ;
+
+#pragma omp parallel for schedule(dynamic)
+    for (long j = 0; j < cols; j++)
+      read_pcf_to_column(fvec[first + j], rows, no_cols, offset, layout, batch.col(j).data()) ;
+
+    process(first, batch.leftCols(cols)) ;
+  }
+}
+
 /*
 Parse the point cloud files and populate matrix with data.
 */
-pointCloudFileInfo read_pcfs_to_matrix(MatrixXd *m,
+template <typename Scalar>
+pointCloudFileInfo read_pcfs_to_matrix(ScalarMatrix<Scalar> *m,
                                        const std::vector<std::string> *fvec,
                                        const long no_cols,
-                                       const long offset)
+                                       const long offset,
+                                       const int layout)
 {
-  pointCloudFileInfo pointCloudRefFileInfo;
   bool verbose = false;
 
   if (verbose)
@@ -60,26 +220,8 @@ pointCloudFileInfo read_pcfs_to_matrix(MatrixXd *m,
 
   /* Establish a reference number of points for checking the problem size.
   The size is determined from the point cloud file in the first time directory. */
-  pointCloudRefFileInfo.rows = 0;
   std::string ref_fname = *(fvec->begin());
-
-  std::ifstream ref_file(ref_fname);
-  if (ref_file.is_open())
-  {
-    std::string unused_line;
-
-    /* Get a line and count the number of columns by splitting at spaces ' '.
-    Increment the row counter. */
-    getline(ref_file, unused_line);
-    pointCloudRefFileInfo.rows++;
-    auto tokens = split_string(unused_line, ' ');
-    pointCloudRefFileInfo.columns = tokens.size();
-
-    /* Count the rest of the rows. */
-    while (getline(ref_file, unused_line))
-      pointCloudRefFileInfo.rows++;
-  }
-  ref_file.close();
+  pointCloudFileInfo pointCloudRefFileInfo(read_pcf_info(ref_fname));
 
   if (verbose)
   {
@@ -92,40 +234,413 @@ pointCloudFileInfo read_pcfs_to_matrix(MatrixXd *m,
   long TSIZE = fvec->size();
 
   /* Define matrix to store the file content */
-  *m = MatrixXd::Zero(pointCloudRefFileInfo.rows * no_cols, TSIZE);
-  double dummy = 0;
+  *m = ScalarMatrix<Scalar>::Zero(pointCloudRefFileInfo.rows * no_cols, TSIZE);
 #pragma omp parallel
 #pragma omp for
   for (size_t snapshot = 0; snapshot < TSIZE; snapshot++)
+    read_pcf_to_column((*fvec)[snapshot], pointCloudRefFileInfo.rows, no_cols, offset, layout, m->col(snapshot).data());
+
+  return pointCloudRefFileInfo;
+}
+
+/*
+Convert the layout of every column of m.
+*/
+template <typename Scalar>
+void convert_layout(ScalarMatrix<Scalar> &m, const long varSize, const int from, const int to)
+{
+  if (from == to || varSize == 1)
+    return ;
+
+  const long pointSize(m.rows() / varSize) ;
+  const long tileSize(1024) ;
+
+#pragma omp parallel
   {
-    std::ifstream file((*fvec)[snapshot]);
+    Matrix<Scalar, Dynamic, 1> column(m.rows()) ;
 
-    if (file.is_open())
+#pragma omp for
+    for (long k = 0; k < m.cols(); k++)
     {
-      for (size_t row_idx = 0; row_idx < pointCloudRefFileInfo.rows; row_idx++)
+      const Scalar *src(m.col(k).data()) ;
+      Scalar *dst(column.data()) ;
+      for (long i0 = 0; i0 < pointSize; i0 += tileSize)
       {
-        for (size_t col_no = 0, j = 0; col_no < (no_cols + offset); col_no++)
-        {
-          if (col_no < offset)
-            file >> dummy;
-          else
-          {
-            file >> (*m)(row_idx + pointCloudRefFileInfo.rows * j, snapshot);
-            j++;
-          }
-        }
+        const long i1(std::min(i0 + tileSize, pointSize)) ;
+        for (long j = 0; j < varSize; j++)
+          for (long i = i0; i < i1; i++)
+            dst[layout_row(to, i, j, pointSize, varSize)] = src[layout_row(from, i, j, pointSize, varSize)] ;
       }
-      file.close();
+      m.col(k) = column ;
     }
-    else
+  }
+}
+
+void write_matrix_info(const std::string &fname, const long rows, const long cols,
+                       const long varSize, const int layout, const int scalar)
+{
+  std::ofstream info(fname + ".info") ;
+  if (info.is_open())
+  {
+    info << "rows " << rows << std::endl ;
+    info << "cols " << cols << std::endl ;
+    info << "varSize " << varSize << std::endl ;
+    info << "layout " << layout_name(layout) << std::endl ;
+    info << "scalar " << scalar_name(scalar) << std::endl ;
+    info.close() ;
+  }
+}
+
+void write_eigenvalues(const std::string &chronosDir, const VectorXd &values, const long total,
+                       const double trace)
+{
+  const std::string fname(chronosDir + "/eigenValues.bin") ;
+  std::ofstream writeEigval(fname, std::ios::binary) ;
+  if (writeEigval.is_open()) {
+    writeEigval.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(double)) ;
+    writeEigval.close() ;
+  }
+
+  if (values.size() >= total)
+  {
+    std::remove((fname + ".info").c_str()) ;
+    return ;
+  }
+
+  std::ofstream info(fname + ".info") ;
+  if (info.is_open())
+  {
+    info << "rows " << values.size() << std::endl ;
+    info << "cols " << 1 << std::endl ;
+    info << "total " << total << std::endl ;
+    info << "trace " << std::setprecision(17) << trace << std::endl ;
+    info.close() ;
+  }
+  std::cerr << "WARNING: only " << values.size() << " of the " << total << " eigenvalues were computed, "
+            << fname << " is partial (total and trace in " << fname << ".info)." << std::endl ;
+}
+
+MatrixInfo read_matrix_info(const std::string &fname)
+{
+  MatrixInfo description = {0, 0, 0, read_matrix_layout(fname), read_matrix_scalar(fname)} ;
+  std::ifstream info(fname + ".info") ;
+  std::string key, value ;
+  while (info >> key >> value)
+  {
+    if (key == "rows")
+      description.rows = std::stol(value) ;
+    else if (key == "cols")
+      description.cols = std::stol(value) ;
+    else if (key == "varSize")
+      description.varSize = std::stol(value) ;
+  }
+
+  return description ;
+}
+
+int read_matrix_layout(const std::string &fname)
+{
+  std::ifstream info(fname + ".info") ;
+  std::string key, value ;
+  while (info >> key >> value)
+  {
+    if (key == "layout")
+      return value == layout_name(LAYOUT_INTERLEAVED) ? LAYOUT_INTERLEAVED : LAYOUT_BLOCKED ;
+  }
+
+  return LAYOUT_BLOCKED ;
+}
+
+int read_matrix_scalar(const std::string &fname)
+{
+  std::ifstream info(fname + ".info") ;
+  std::string key, value ;
+  while (info >> key >> value)
+  {
+    if (key == "scalar")
+      return value == scalar_name(SCALAR_FLOAT) ? SCALAR_FLOAT :
+             value == scalar_name(SCALAR_COMPLEX) ? SCALAR_COMPLEX : SCALAR_DOUBLE ;
+  }
+
+  return SCALAR_DOUBLE ;
+}
+
+void require_double_matrix(const std::string &fname)
+{
+  if (read_matrix_scalar(fname) != SCALAR_DOUBLE)
+    throw "Float or complex matrix file (POD -scalar), only REC and MODES read it" ;
+}
+
+void write_mode_source(const std::string &fname, const ModeSource &source)
+{
+  std::ofstream info(fname) ;
+  if (info.is_open())
+  {
+    info << "inputDir " << source.inputDirName << std::endl ;
+    info << "timesFile " << source.timesFileName << std::endl ;
+    info << "dataFile " << source.dataFileName << std::endl ;
+    info << "chronosDir " << source.chronosDirName << std::endl ;
+    info << "varSize " << source.varSize << std::endl ;
+    info << "offset " << source.offset << std::endl ;
+    info << "layout " << layout_name(source.layout) << std::endl ;
+    info << "rows " << source.rows << std::endl ;
+    info << "modes " << source.modes << std::endl ;
+    info << "times " << source.times << std::endl ;
+    info.close() ;
+  }
+}
+
+ModeSource read_mode_source(const std::string &fname)
+{
+  std::ifstream info(fname) ;
+  if (!info.is_open())
+    throw "Could not open mode source file" ;
+
+  ModeSource source{"", "", "", "", 0, 0, LAYOUT_BLOCKED, 0, 0, 0} ;
+  /* The value is the rest of the line after the key and its separating
+  space, so that paths may contain spaces */
+  std::string key, value ;
+  while (info >> key && std::getline(info, value))
+  {
+    if (!value.empty() && value[0] == ' ')
+      value.erase(0, 1) ;
+
+    if (key == "inputDir") source.inputDirName = value ;
+    else if (key == "timesFile") source.timesFileName = value ;
+    else if (key == "dataFile") source.dataFileName = value ;
+    else if (key == "chronosDir") source.chronosDirName = value ;
+    else if (key == "varSize") source.varSize = std::stol(value) ;
+    else if (key == "offset") source.offset = std::stol(value) ;
+    else if (key == "layout") source.layout = value == layout_name(LAYOUT_INTERLEAVED) ? LAYOUT_INTERLEAVED : LAYOUT_BLOCKED ;
+    else if (key == "rows") source.rows = std::stol(value) ;
+    else if (key == "modes") source.modes = std::stol(value) ;
+    else if (key == "times") source.times = std::stol(value) ;
+  }
+  info.close() ;
+
+  return source ;
+}
+
+template <typename Scalar>
+void correlation_matrix(const ScalarMatrix<Scalar> &m, ScalarMatrix<Scalar> &pm)
+{
+  typedef typename NumTraits<Scalar>::Real Real ;
+  const long NSIZE(m.rows()) ;
+  const long TSIZE(m.cols()) ;
+  const ScalarGemmKernel<Scalar> gemm(gemm_kernel<Scalar>(simd_kernels())) ;
+  const long blockSize(64) ;
+  const long blocksSize((TSIZE + blockSize - 1) / blockSize) ;
+  pm.resize(TSIZE, TSIZE) ;
+
+#pragma omp parallel
+  {
+    const FlushDenormals flush(std::is_same<Scalar, float>::value) ;
+
+    /* Block columns get shorter to the right, longest first */
+#pragma omp for schedule(dynamic)
+    for (long b = 0; b < blocksSize; b++)
     {
-      std::cerr << "Unable to open file " << (*fvec)[snapshot] << std::endl;
+      const long j0(b * blockSize) ;
+      const long cols(std::min(blockSize, TSIZE - j0)) ;
+      /* pm.block(j0, j0, TSIZE - j0, cols) = m.rightCols(TSIZE - j0)^H m.middleCols(j0, cols) / TSIZE */
+      gemm(true, false, TSIZE - j0, cols, NSIZE, Scalar(Real(1.0 / TSIZE)),
+           m.data() + j0 * NSIZE, NSIZE, m.data() + j0 * NSIZE, NSIZE,
+           false, pm.data() + j0 + j0 * TSIZE, TSIZE) ;
     }
   }
 
-  return pointCloudRefFileInfo;
+  symmetrize_lower(pm) ;
 }
 
+template <typename Scalar>
+void covariance_matrix(const Ref<const ScalarMatrix<Scalar>> &m, ScalarMatrix<Scalar> &c, const long batchSize)
+{
+  typedef typename NumTraits<Scalar>::Real Real ;
+  const long NSIZE(m.rows()) ;
+  const long TSIZE(m.cols()) ;
+  const long blockSize(64) ;
+  const long blocksSize((NSIZE + blockSize - 1) / blockSize) ;
+  const ScalarGemmKernel<Scalar> gemm(gemm_kernel<Scalar>(simd_kernels())) ;
+  c.setZero(NSIZE, NSIZE) ;
+
+  for (long t0 = 0; t0 < TSIZE; t0 += batchSize)
+  {
+    const long batch(std::min(batchSize, TSIZE - t0)) ;
+    const Scalar *b(m.data() + t0 * m.outerStride()) ;
+
+#pragma omp parallel
+    {
+      const FlushDenormals flush(std::is_same<Scalar, float>::value) ;
+#pragma omp for schedule(dynamic)
+      for (long k = 0; k < blocksSize; k++)
+      {
+        const long j0(k * blockSize) ;
+        const long cols(std::min(blockSize, NSIZE - j0)) ;
+        /* c.block(j0, j0, NSIZE - j0, cols) += b.bottomRows(NSIZE - j0) b.middleRows(j0, cols)^H / TSIZE */
+        gemm(false, true, NSIZE - j0, cols, batch, Scalar(Real(1.0 / TSIZE)),
+             b + j0, m.outerStride(), b + j0, m.outerStride(),
+             true, c.data() + j0 + j0 * NSIZE, NSIZE) ;
+      }
+    }
+  }
+
+  symmetrize_lower(c) ;
+}
+
+template <typename Scalar>
+void symmetrize_lower(ScalarMatrix<Scalar> &a)
+{
+  const long nSize(a.rows()) ;
+
+#pragma omp parallel for schedule(dynamic, 16)
+  for (long j = 0; j < nSize; j++)
+    a.row(j).tail(nSize - j - 1) = a.col(j).tail(nSize - j - 1).adjoint() ;
+}
+
+static bool libraryVerbose(true) ;
+
+void set_library_verbose(const bool verbose)
+{
+  libraryVerbose = verbose ;
+}
+
+bool library_verbose()
+{
+  return libraryVerbose ;
+}
+
+double peak_memory_mb()
+{
+  struct rusage usage ;
+  getrusage(RUSAGE_SELF, &usage) ;
+  return usage.ru_maxrss / 1024. ;
+}
+
+void resident_memory_mb(double &current, double &peak)
+{
+  current = 0. ;
+  peak = 0. ;
+  std::ifstream status("/proc/self/status") ;
+  std::string key ;
+  long kilobytes ;
+  while (status >> key)
+  {
+    if ((key == "VmRSS:" || key == "VmHWM:") && status >> kilobytes)
+      (key == "VmRSS:" ? current : peak) = kilobytes / 1024. ;
+    status.ignore(std::numeric_limits<std::streamsize>::max(), '\n') ;
+  }
+  if (peak == 0.)
+    peak = peak_memory_mb() ;
+  peak = std::max(peak, current) ;
+}
+
+/*
+Read a column-major binary matrix with a known number of rows.
+*/
+template <typename Scalar>
+ScalarMatrix<Scalar> read_binary_matrix(const std::string &fname, const long rows)
+{
+  std::ifstream file(fname, std::ios::binary) ;
+  if (!file.is_open())
+    throw "Could not open binary matrix file" ;
+
+  file.seekg(0, std::ios::end) ;
+  const long cols(file.tellg() / (rows * (long)sizeof(Scalar))) ;
+  ScalarMatrix<Scalar> m(rows, cols) ;
+  file.seekg(0, std::ios::beg) ;
+  file.read(reinterpret_cast<char*>(m.data()), m.size() * sizeof(Scalar)) ;
+  file.close() ;
+
+  return m ;
+}
+
+/*
+Projection error curves from the snapshot norms and the basis coefficients.
+*/
+template <typename Scalar>
+MatrixXd projection_error_curves(const VectorXd &norms2,
+                                 const ScalarMatrix<Scalar> &coeffs,
+                                 VectorXd &globalError,
+                                 VectorXd &energy,
+                                 const ScalarMatrix<Scalar> &gram)
+{
+  const long RSIZE(coeffs.rows()) ;
+  const long TSIZE(coeffs.cols()) ;
+  const bool orthonormal(gram.size() == 0) ;
+  if (!orthonormal && (gram.rows() < RSIZE || gram.cols() < RSIZE))
+    throw "Gram matrix smaller than the number of modes" ;
+  MatrixXd snapError(RSIZE, TSIZE) ;
+  MatrixXd residual(RSIZE, TSIZE) ;
+
+#pragma omp parallel for
+  for (long j = 0; j < TSIZE; j++)
+  {
+    double res(norms2(j)) ;
+    for (long i = 0; i < RSIZE; i++)
+    {
+      /* Rank i adds |c_i|^2 (G_ii - 2) + 2 Re(conj(c_i) sum_{k<i} G_ik c_k) */
+      const Scalar ci(coeffs(i, j)) ;
+      if (orthonormal)
+        res -= std::norm(ci) ;
+      else
+        res += numext::real(numext::conj(ci) * (ci * (gram(i, i) - 2.)
+                            + 2. * gram.row(i).head(i).conjugate().dot(coeffs.col(j).head(i)))) ;
+      /* Round-off can make the residual slightly negative at full rank */
+      residual(i, j) = std::max(res, 0.) ;
+      snapError(i, j) = norms2(j) > 0. ? std::sqrt(residual(i, j) / norms2(j)) : 0. ;
+    }
+  }
+
+  const double totalNorm2(norms2.sum()) ;
+  globalError = (residual.rowwise().sum() / totalNorm2).cwiseSqrt() ;
+  energy = (totalNorm2 - residual.rowwise().sum().array()) / totalNorm2 ;
+
+  return snapError ;
+}
+
+void write_error_curves(const std::string &dir,
+                        const MatrixXd &snapError,
+                        const VectorXd &globalError,
+                        const VectorXd &energy)
+{
+  std::ofstream writeError(dir + "/projectionError.bin", std::ios::binary) ;
+  if (writeError.is_open()) {
+    writeError.write(reinterpret_cast<const char*>(snapError.data()), snapError.size() * sizeof(double)) ;
+    writeError.close() ;
+  }
+
+  std::ofstream writeCurve(dir + "/errorCurve.dat") ;
+  if (writeCurve.is_open()) {
+    writeCurve << "# rank energy globalRelativeError maxSnapshotRelativeError" << std::endl ;
+    writeCurve << std::scientific << std::setprecision(8) ;
+    for (long i = 0; i < snapError.rows(); i++)
+      writeCurve << (i + 1) << " " << energy(i) << " " << globalError(i) << " "
+                 << snapError.row(i).maxCoeff() << std::endl ;
+    writeCurve.close() ;
+  }
+}
+
+// EXPLICIT INSTANTIATIONS
+
+#define POD_INSTANTIATE_UTILS(Scalar) \
+  template void read_pcf_to_column<Scalar>(const std::string&, const long, const long, const long, const int, Scalar*) ; \
+  template void stream_snapshots<Scalar>(const std::vector<std::string>&, const long, const long, const long, \
+                                         const int, const long, \
+                                         const std::function<void(long, const Ref<const ScalarMatrix<Scalar>>&)>&) ; \
+  template pointCloudFileInfo read_pcfs_to_matrix<Scalar>(ScalarMatrix<Scalar>*, const std::vector<std::string>*, \
+                                                          const long, const long, const int) ; \
+  template void convert_layout<Scalar>(ScalarMatrix<Scalar>&, const long, const int, const int) ; \
+  template ScalarMatrix<Scalar> read_binary_matrix<Scalar>(const std::string&, const long) ; \
+  template void correlation_matrix<Scalar>(const ScalarMatrix<Scalar>&, ScalarMatrix<Scalar>&) ; \
+  template void covariance_matrix<Scalar>(const Ref<const ScalarMatrix<Scalar>>&, ScalarMatrix<Scalar>&, const long) ; \
+  template void symmetrize_lower<Scalar>(ScalarMatrix<Scalar>&) ; \
+  template MatrixXd projection_error_curves<Scalar>(const VectorXd&, const ScalarMatrix<Scalar>&, VectorXd&, VectorXd&, \
+                                                    const ScalarMatrix<Scalar>&) ;
+
+POD_INSTANTIATE_UTILS(float)
+POD_INSTANTIATE_UTILS(double)
+POD_INSTANTIATE_UTILS(std::complex<double>)
+
 void Usage(ez::ezOptionParser &opt)
 {
   std::string usage;
@@ -146,5 +661,44 @@ const char* Parameters::m_targetRicOpt = "-ric";
 const char* Parameters::m_spodTypeOpt = "-spod-type" ;
 const char* Parameters::m_spodWidthOpt = "-spod-width" ;
 const char* Parameters::m_recDirNameOpt = "-r" ;
+const char* Parameters::m_outTimesFileNameOpt = "-ot" ;
+const char* Parameters::m_interpTypeOpt = "-interp" ;
+const char* Parameters::m_errorCurvesOpt = "-ec" ;
+const char* Parameters::m_writeRawOpt = "-xy" ;
+const char* Parameters::m_pointsFileNameOpt = "-pts" ;
+const char* Parameters::m_modeBlockSizeOpt = "-mb" ;
+const char* Parameters::m_modeRowBlockSizeOpt = "-mrb" ;
+const char* Parameters::m_layoutOpt = "-layout" ;
+const char* Parameters::m_spodBoundaryOpt = "-spod-bc" ;
+const char* Parameters::m_spodStudyWidthsOpt = "-spod-widths" ;
+const char* Parameters::m_fspodNfftOpt = "-fspod-nfft" ;
+const char* Parameters::m_fspodOverlapOpt = "-fspod-overlap" ;
+const char* Parameters::m_fspodFreqsOpt = "-fspod-freqs" ;
+const char* Parameters::m_eigSolverOpt = "-eig" ;
+const char* Parameters::m_rsvdOpt = "-rsvd" ;
+const char* Parameters::m_rsvdPowerOpt = "-rsvd-q" ;
+const char* Parameters::m_rsvdOversamplingOpt = "-rsvd-p" ;
+const char* Parameters::m_lazyModesOpt = "-lazy" ;
+const char* Parameters::m_covarianceOpt = "-cov" ;
+const char* Parameters::m_previewPointsOpt = "-preview" ;
+const char* Parameters::m_previewStrideOpt = "-preview-stride" ;
+const char* Parameters::m_previewSamplingOpt = "-preview-sampling" ;
+const char* Parameters::m_previewModesOpt = "-preview-modes" ;
+const char* Parameters::m_scalarOpt = "-scalar" ;
+const char* Parameters::m_modeIndicesOpt = "-modes" ;
+const char* Parameters::m_pointIndicesFileNameOpt = "-pidx" ;
+const char* Parameters::m_outFileNameOpt = "-o" ;
+const char* Parameters::m_reconstructOpt = "-rec" ;
+const char* Parameters::m_recRankOpt = "-rank" ;
+const char* Parameters::m_reconstructionErrorOpt = "-err" ;
+const char* Parameters::m_writeVtkOpt = "-vtk" ;
+const char* Parameters::m_shmNameOpt = "-shm" ;
+const char* Parameters::m_socketNameOpt = "-sock" ;
+const char* Parameters::m_batchColumnsOpt = "-bc" ;
+const char* Parameters::m_batchWaitOpt = "-bw" ;
+const char* Parameters::m_watchOpt = "-watch" ;
+const char* Parameters::m_watchPollOpt = "-watch-poll" ;
+const char* Parameters::m_watchIdleOpt = "-watch-idle" ;
+const char* Parameters::m_manifestFileNameOpt = "-manifest" ;
 
 
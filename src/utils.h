@@ -12,6 +12,11 @@
 #include <string>
 #include <Eigen/Dense>
 #include <iterator>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <type_traits>
 
 #include "ezOptionParser.hpp"
 #include <Eigen/Dense>
@@ -37,12 +42,307 @@ struct pointCloudFileInfo {
 using namespace Eigen;
 
 /*
-Parse the point cloud files and populate matrix with data.
+Ordering of the rows of the snapshot, mode and reconstruction matrices.
+Component-blocked: row i + N*j holds component j of point i (all x, then all y...).
+Point-interleaved: row j + varSize*i holds component j of point i (x, y, z of each point).
 */
-pointCloudFileInfo read_pcfs_to_matrix(MatrixXd *m,
+enum VariableLayout {
+  LAYOUT_BLOCKED = 0,
+  LAYOUT_INTERLEAVED = 1
+};
+
+/*
+Row of component j of point i, for pointSize points of varSize components.
+*/
+inline long layout_row(const int layout, const long i, const long j, const long pointSize, const long varSize)
+{
+  return layout == LAYOUT_INTERLEAVED ? j + varSize * i : i + pointSize * j ;
+}
+
+const char* layout_name(const int layout) ;
+
+/*
+Scalar type of the snapshot, mode and reconstruction matrices (as given to
+-scalar). Complex values are read from pairs of columns (real, imaginary).
+*/
+enum ScalarType {
+  SCALAR_DOUBLE = 0,
+  SCALAR_FLOAT = 1,
+  SCALAR_COMPLEX = 2  // std::complex<double>
+};
+
+const char* scalar_name(const int scalar) ;
+
+/*
+Matrices of the snapshots, modes and reconstructions of every scalar type:
+the stages of POD and REC are templated on Scalar and instantiated for float,
+double and std::complex<double>.
+*/
+template <typename Scalar>
+using ScalarMatrix = Matrix<Scalar, Dynamic, Dynamic> ;
+
+/*
+ScalarType of Scalar.
+*/
+template <typename Scalar>
+constexpr int scalar_type_of()
+{
+  return std::is_same<Scalar, float>::value ? SCALAR_FLOAT :
+         NumTraits<Scalar>::IsComplex ? SCALAR_COMPLEX : SCALAR_DOUBLE ;
+}
+
+/*
+Flush the denormal results (and operands) of the single precision arithmetic
+of the calling thread to zero while in scope: products of small components
+(e.g. the 1e-22 out-of-plane velocity of a 2D case) fall below the normal
+floats, and the processor computes denormals orders of magnitude slower.
+*/
+class FlushDenormals {
+public:
+  explicit FlushDenormals(const bool enabled) ;
+  ~FlushDenormals() ;
+
+private:
+  unsigned int m_csr ;
+} ;
+
+/*
+Number of rows (points) and columns of a point cloud file.
+*/
+pointCloudFileInfo read_pcf_info(const std::string &fname) ;
+
+/*
+Parse the no_cols columns following offset of one point cloud file of the given
+number of rows into a snapshot column, in the given layout. The file is read in
+one block and parsed by the kernel specialised on no_cols (components.h).
+*/
+void read_pcf_to_column(const std::string &fname,
+                        const long rows,
+                        const long no_cols,
+                        const long offset,
+                        const int layout,
+                        double *column) ;
+
+/*
+Same, converted to Scalar. Complex components are read from two columns each,
+real then imaginary part: no_cols complex values per point take 2 no_cols
+columns after offset.
+*/
+template <typename Scalar>
+void read_pcf_to_column(const std::string &fname,
+                        const long rows,
+                        const long no_cols,
+                        const long offset,
+                        const int layout,
+                        Scalar *column) ;
+
+/*
+Read the snapshot files fvec in batches of batchSize columns of Scalar values,
+each batch being parsed in parallel, and hand every batch to process(first
+column, batch). Only one batch is held in memory.
+*/
+template <typename Scalar>
+void stream_snapshots(const std::vector<std::string> &fvec,
+                      const long rows,
+                      const long no_cols,
+                      const long offset,
+                      const int layout,
+                      const long batchSize,
+                      const std::function<void(long, const Ref<const ScalarMatrix<Scalar>>&)> &process) ;
+
+/*
+Parse the point cloud files and populate matrix with data. In the interleaved
+layout every parsed line is written sequentially.
+*/
+template <typename Scalar>
+pointCloudFileInfo read_pcfs_to_matrix(ScalarMatrix<Scalar> *m,
                                        const std::vector<std::string> *fvec,
                                        const long no_cols,
-                                       const long offset) ;
+                                       const long offset,
+                                       const int layout = LAYOUT_BLOCKED) ;
+
+/*
+Convert every column of m from one layout to the other, in place. Each column
+is transposed (pointSize x varSize <-> varSize x pointSize) by tiles of points
+small enough to stay in cache, one column per thread.
+*/
+template <typename Scalar>
+void convert_layout(ScalarMatrix<Scalar> &m, const long varSize, const int from, const int to) ;
+
+/*
+Write and read the description of a binary matrix file (fname.info next to it:
+rows, columns, values per point, layout and scalar type).
+*/
+void write_matrix_info(const std::string &fname, const long rows, const long cols,
+                       const long varSize, const int layout, const int scalar = SCALAR_DOUBLE) ;
+
+/*
+Write the descending eigenvalues to chronosDir/eigenValues.bin. A partial
+solve (Lanczos, randomized SVD) computes fewer than the total of the matrix:
+the file is then described by eigenValues.bin.info (rows, total and trace,
+the sum of all the eigenvalues, from which the RIC of the missing tail
+follows) and a warning is printed. A stale description is removed otherwise.
+*/
+void write_eigenvalues(const std::string &chronosDir, const VectorXd &values, const long total,
+                       const double trace) ;
+
+/*
+Description of a binary matrix file; rows and cols are 0 if there is none.
+*/
+struct MatrixInfo {
+  long rows ;
+  long cols ;
+  long varSize ;
+  int layout ;
+  int scalar ;
+} ;
+
+MatrixInfo read_matrix_info(const std::string &fname) ;
+
+/*
+Layout recorded for fname, or LAYOUT_BLOCKED if there is no description.
+*/
+int read_matrix_layout(const std::string &fname) ;
+
+/*
+Scalar type recorded for fname, or SCALAR_DOUBLE if there is no description.
+*/
+int read_matrix_scalar(const std::string &fname) ;
+
+/*
+Throw unless fname holds doubles: the float and complex outputs of
+POD -scalar are only read by REC, the other readers would reinterpret them.
+*/
+void require_double_matrix(const std::string &fname) ;
+
+/*
+Reference to the snapshots from which the modes of a POD run can be computed
+on demand (modeDir/modeSource.info, written by POD -lazy): where the snapshot
+files are, how they are read, and where the eigenvalues and chronos are.
+*/
+struct ModeSource {
+  std::string inputDirName ;
+  std::string timesFileName ;
+  std::string dataFileName ;
+  std::string chronosDirName ;
+  long varSize ;
+  long offset ;
+  int layout ;
+  long rows ;
+  long modes ;
+  long times ;
+} ;
+
+void write_mode_source(const std::string &fname, const ModeSource &source) ;
+
+ModeSource read_mode_source(const std::string &fname) ;
+
+/*
+Read a column-major binary matrix of Scalar values with a known number of
+rows. The number of columns is deduced from the file size.
+*/
+template <typename Scalar = double>
+ScalarMatrix<Scalar> read_binary_matrix(const std::string &fname, const long rows) ;
+
+/*
+Correlation matrix pm = m^H m / T of the snapshots m (N x T). Only the blocks
+on and below the diagonal are computed, as products distributed over the
+threads, and the lower triangle is then mirrored in place; pm is allocated
+once, without initialisation or temporary.
+*/
+template <typename Scalar>
+void correlation_matrix(const ScalarMatrix<Scalar> &m, ScalarMatrix<Scalar> &pm) ;
+
+/*
+Matrix decomposed by the POD (as given to -cov): the T x T correlation matrix
+of the snapshots (method of snapshots) or the N x N spatial covariance matrix,
+the smaller one being chosen by default.
+*/
+enum CovarianceType {
+  COV_AUTO = 0,
+  COV_SNAPSHOTS = 1,
+  COV_SPATIAL = 2
+};
+
+/*
+Spatial covariance matrix c = m m^H / T of the snapshots m (N x T), for
+snapshots outnumbering the rows. The lower triangle is accumulated by
+Hermitian rank-k updates over batches of batchSize snapshots, every update
+being split into block columns distributed over the threads, and then
+mirrored in place.
+*/
+template <typename Scalar>
+void covariance_matrix(const Ref<const ScalarMatrix<Scalar>> &m, ScalarMatrix<Scalar> &c, const long batchSize = 256) ;
+
+/*
+Mirror the lower triangle of the square matrix a to its upper triangle,
+conjugated for complex values (Hermitian matrix).
+*/
+template <typename Scalar>
+void symmetrize_lower(ScalarMatrix<Scalar> &a) ;
+
+/*
+Whether the library prints its progress messages (eigen-solver, kernel
+selection) to std::cout: on by default for the executables, off in the C
+interface unless pod_c_set_verbose is called.
+*/
+void set_library_verbose(const bool verbose) ;
+bool library_verbose() ;
+
+/*
+Peak resident memory of the process so far, in MB.
+*/
+double peak_memory_mb() ;
+
+/*
+Current and peak resident memory of the process, in MB, read together from
+/proc/self/status (VmRSS and VmHWM) so that the current one never exceeds
+the peak. Where /proc is not available, current is 0 and peak is
+peak_memory_mb().
+*/
+void resident_memory_mb(double &current, double &peak) ;
+
+/*
+Number of modes reaching the RIC, given the eigenvalues in descending order
+and the sum of all of them, and at most podSize.
+*/
+template <typename Vector>
+int ric_pod_size(const Vector &eigval, const double eigValSum, const double targetRic, const int podSize)
+{
+  auto ric(0.) ;
+  auto podSizeWithRIC(0) ;
+  while(ric < targetRic * eigValSum && podSizeWithRIC < eigval.size()) {
+    ric += std::fabs(eigval(podSizeWithRIC)) ;
+    ++podSizeWithRIC ;
+  }
+  return std::min(podSizeWithRIC, podSize) ;
+}
+
+/*
+Projection error of every snapshot for every truncation rank, computed in
+closed form from the squared snapshot norms and the coefficients
+c = Phi^H s of the snapshots on the modes (coeffs(i, j) is the coefficient of
+snapshot j on mode i): |s - Phi_r c_r|^2 = |s|^2 - 2 |c_r|^2 + c_r^H G_r c_r,
+G being the Gram matrix Phi^H Phi of the modes, the identity if gram is empty
+(orthonormal modes). Column j of the returned matrix holds the relative error
+curve of snapshot j for ranks 1..coeffs.rows(); globalError gets the relative
+error of the whole snapshot set and energy the fraction of energy captured.
+*/
+template <typename Scalar>
+MatrixXd projection_error_curves(const VectorXd &norms2,
+                                 const ScalarMatrix<Scalar> &coeffs,
+                                 VectorXd &globalError,
+                                 VectorXd &energy,
+                                 const ScalarMatrix<Scalar> &gram = ScalarMatrix<Scalar>()) ;
+
+/*
+Write the error curves to dir/projectionError.bin (per snapshot, binary) and
+dir/errorCurve.dat (rank, energy, global error, worst snapshot error).
+*/
+void write_error_curves(const std::string &dir,
+                        const MatrixXd &snapError,
+                        const VectorXd &globalError,
+                        const VectorXd &energy) ;
 
 void Usage(ez::ezOptionParser &opt) ;
 
@@ -60,7 +360,43 @@ struct Parameters {
   m_recDirName(""),
   m_targetRic(0.),
   m_spodType(0),
-  m_spodWidth(0) {
+  m_spodWidth(0),
+  m_outTimesFileName(""),
+  m_interpType(1),
+  m_errorCurves(false),
+  m_writeRaw(false),
+  m_pointsFileName(""),
+  m_modeBlockSize(0),
+  m_modeRowBlockSize(0),
+  m_layout(LAYOUT_BLOCKED),
+  m_spodBoundary(0),
+  m_fspodNfft(0),
+  m_fspodOverlap(-1),
+  m_eigSolver(0),
+  m_rsvd(false),
+  m_rsvdPower(1),
+  m_rsvdOversampling(10),
+  m_lazyModes(false),
+  m_covariance(COV_AUTO),
+  m_previewPoints(0),
+  m_previewStride(1),
+  m_previewSampling(1),
+  m_previewModes(false),
+  m_scalar(SCALAR_DOUBLE),
+  m_pointIndicesFileName(""),
+  m_outFileName(""),
+  m_reconstruct(false),
+  m_recRank(0),
+  m_reconstructionError(false),
+  m_writeVtk(false),
+  m_shmName(""),
+  m_socketName(""),
+  m_batchColumns(256),
+  m_batchWait(0),
+  m_watch(false),
+  m_watchPoll(0.),
+  m_watchIdle(0.),
+  m_manifestFileName("") {
     if(opt.isSet(m_varSizeOpt))
       opt.get(m_varSizeOpt) -> getInt(m_varSize) ;
 
@@ -99,6 +435,114 @@ struct Parameters {
 
     if(opt.isSet(m_spodWidthOpt))
       opt.get(m_spodWidthOpt) -> getInt(m_spodWidth) ;
+
+    if(opt.isSet(m_outTimesFileNameOpt))
+      opt.get(m_outTimesFileNameOpt) -> getString(m_outTimesFileName) ;
+
+    if(opt.isSet(m_interpTypeOpt))
+      opt.get(m_interpTypeOpt) -> getInt(m_interpType) ;
+
+    m_errorCurves = opt.isSet(m_errorCurvesOpt) ;
+
+    m_writeRaw = opt.isSet(m_writeRawOpt) ;
+
+    if(opt.isSet(m_pointsFileNameOpt))
+      opt.get(m_pointsFileNameOpt) -> getString(m_pointsFileName) ;
+
+    if(opt.isSet(m_modeBlockSizeOpt))
+      opt.get(m_modeBlockSizeOpt) -> getInt(m_modeBlockSize) ;
+
+    if(opt.isSet(m_modeRowBlockSizeOpt))
+      opt.get(m_modeRowBlockSizeOpt) -> getInt(m_modeRowBlockSize) ;
+
+    if(opt.isSet(m_layoutOpt))
+      opt.get(m_layoutOpt) -> getInt(m_layout) ;
+
+    if(opt.isSet(m_spodBoundaryOpt))
+      opt.get(m_spodBoundaryOpt) -> getInt(m_spodBoundary) ;
+
+    if(opt.isSet(m_spodStudyWidthsOpt))
+      opt.get(m_spodStudyWidthsOpt) -> getInts(m_spodStudyWidths) ;
+
+    if(opt.isSet(m_fspodNfftOpt))
+      opt.get(m_fspodNfftOpt) -> getInt(m_fspodNfft) ;
+
+    if(opt.isSet(m_fspodOverlapOpt))
+      opt.get(m_fspodOverlapOpt) -> getInt(m_fspodOverlap) ;
+
+    if(opt.isSet(m_fspodFreqsOpt))
+      opt.get(m_fspodFreqsOpt) -> getInts(m_fspodFreqs) ;
+
+    if(opt.isSet(m_eigSolverOpt))
+      opt.get(m_eigSolverOpt) -> getInt(m_eigSolver) ;
+
+    m_rsvd = opt.isSet(m_rsvdOpt) ;
+
+    if(opt.isSet(m_rsvdPowerOpt))
+      opt.get(m_rsvdPowerOpt) -> getInt(m_rsvdPower) ;
+
+    if(opt.isSet(m_rsvdOversamplingOpt))
+      opt.get(m_rsvdOversamplingOpt) -> getInt(m_rsvdOversampling) ;
+
+    m_lazyModes = opt.isSet(m_lazyModesOpt) ;
+
+    if(opt.isSet(m_covarianceOpt))
+      opt.get(m_covarianceOpt) -> getInt(m_covariance) ;
+
+    if(opt.isSet(m_previewPointsOpt))
+      opt.get(m_previewPointsOpt) -> getInt(m_previewPoints) ;
+
+    if(opt.isSet(m_previewStrideOpt))
+      opt.get(m_previewStrideOpt) -> getInt(m_previewStride) ;
+
+    if(opt.isSet(m_previewSamplingOpt))
+      opt.get(m_previewSamplingOpt) -> getInt(m_previewSampling) ;
+
+    m_previewModes = opt.isSet(m_previewModesOpt) ;
+
+    if(opt.isSet(m_scalarOpt))
+      opt.get(m_scalarOpt) -> getInt(m_scalar) ;
+
+    if(opt.isSet(m_modeIndicesOpt))
+      opt.get(m_modeIndicesOpt) -> getInts(m_modeIndices) ;
+
+    if(opt.isSet(m_pointIndicesFileNameOpt))
+      opt.get(m_pointIndicesFileNameOpt) -> getString(m_pointIndicesFileName) ;
+
+    if(opt.isSet(m_outFileNameOpt))
+      opt.get(m_outFileNameOpt) -> getString(m_outFileName) ;
+
+    m_reconstruct = opt.isSet(m_reconstructOpt) ;
+
+    if(opt.isSet(m_recRankOpt))
+      opt.get(m_recRankOpt) -> getInt(m_recRank) ;
+
+    m_reconstructionError = opt.isSet(m_reconstructionErrorOpt) ;
+
+    m_writeVtk = opt.isSet(m_writeVtkOpt) ;
+
+    if(opt.isSet(m_shmNameOpt))
+      opt.get(m_shmNameOpt) -> getString(m_shmName) ;
+
+    if(opt.isSet(m_socketNameOpt))
+      opt.get(m_socketNameOpt) -> getString(m_socketName) ;
+
+    if(opt.isSet(m_batchColumnsOpt))
+      opt.get(m_batchColumnsOpt) -> getInt(m_batchColumns) ;
+
+    if(opt.isSet(m_batchWaitOpt))
+      opt.get(m_batchWaitOpt) -> getInt(m_batchWait) ;
+
+    m_watch = opt.isSet(m_watchOpt) ;
+
+    if(opt.isSet(m_watchPollOpt))
+      opt.get(m_watchPollOpt) -> getDouble(m_watchPoll) ;
+
+    if(opt.isSet(m_watchIdleOpt))
+      opt.get(m_watchIdleOpt) -> getDouble(m_watchIdle) ;
+
+    if(opt.isSet(m_manifestFileNameOpt))
+      opt.get(m_manifestFileNameOpt) -> getString(m_manifestFileName) ;
   }
 
   int m_varSize ;
@@ -114,6 +558,45 @@ struct Parameters {
   double m_targetRic ;
   int m_spodType ;
   int m_spodWidth ;
+  std::string m_outTimesFileName ;
+  int m_interpType ;
+  bool m_errorCurves ;
+  bool m_writeRaw ;
+  std::string m_pointsFileName ;
+  int m_modeBlockSize ;
+  int m_modeRowBlockSize ;
+  int m_layout ;
+  int m_spodBoundary ;
+  std::vector<int> m_spodStudyWidths ;
+  int m_fspodNfft ;
+  int m_fspodOverlap ;
+  std::vector<int> m_fspodFreqs ;
+  int m_eigSolver ;
+  bool m_rsvd ;
+  int m_rsvdPower ;
+  int m_rsvdOversampling ;
+  bool m_lazyModes ;
+  int m_covariance ;
+  int m_previewPoints ;
+  int m_previewStride ;
+  int m_previewSampling ;
+  bool m_previewModes ;
+  int m_scalar ;
+  std::vector<int> m_modeIndices ;
+  std::string m_pointIndicesFileName ;
+  std::string m_outFileName ;
+  bool m_reconstruct ;
+  int m_recRank ;
+  bool m_reconstructionError ;
+  bool m_writeVtk ;
+  std::string m_shmName ;
+  std::string m_socketName ;
+  int m_batchColumns ;
+  int m_batchWait ;
+  bool m_watch ;
+  double m_watchPoll ;
+  double m_watchIdle ;
+  std::string m_manifestFileName ;
 
   static const char* m_varSizeOpt ;
   static const char* m_offsetOpt ;
@@ -128,6 +611,45 @@ struct Parameters {
   static const char* m_spodTypeOpt ;
   static const char* m_spodWidthOpt ;
   static const char* m_recDirNameOpt ;
+  static const char* m_outTimesFileNameOpt ;
+  static const char* m_interpTypeOpt ;
+  static const char* m_errorCurvesOpt ;
+  static const char* m_writeRawOpt ;
+  static const char* m_pointsFileNameOpt ;
+  static const char* m_modeBlockSizeOpt ;
+  static const char* m_modeRowBlockSizeOpt ;
+  static const char* m_layoutOpt ;
+  static const char* m_spodBoundaryOpt ;
+  static const char* m_spodStudyWidthsOpt ;
+  static const char* m_fspodNfftOpt ;
+  static const char* m_fspodOverlapOpt ;
+  static const char* m_fspodFreqsOpt ;
+  static const char* m_eigSolverOpt ;
+  static const char* m_rsvdOpt ;
+  static const char* m_rsvdPowerOpt ;
+  static const char* m_rsvdOversamplingOpt ;
+  static const char* m_lazyModesOpt ;
+  static const char* m_covarianceOpt ;
+  static const char* m_previewPointsOpt ;
+  static const char* m_previewStrideOpt ;
+  static const char* m_previewSamplingOpt ;
+  static const char* m_previewModesOpt ;
+  static const char* m_scalarOpt ;
+  static const char* m_modeIndicesOpt ;
+  static const char* m_pointIndicesFileNameOpt ;
+  static const char* m_outFileNameOpt ;
+  static const char* m_reconstructOpt ;
+  static const char* m_recRankOpt ;
+  static const char* m_reconstructionErrorOpt ;
+  static const char* m_writeVtkOpt ;
+  static const char* m_shmNameOpt ;
+  static const char* m_socketNameOpt ;
+  static const char* m_batchColumnsOpt ;
+  static const char* m_batchWaitOpt ;
+  static const char* m_watchOpt ;
+  static const char* m_watchPollOpt ;
+  static const char* m_watchIdleOpt ;
+  static const char* m_manifestFileNameOpt ;
 } ;
 
 #endif //POD_UTILS_H
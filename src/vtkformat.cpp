@@ -0,0 +1,147 @@
+//
+// Point cloud fields in the VTK XML format (.vtu), for ParaView.
+//
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+
+#include "vtkformat.h"
+#include "rawformat.h"
+
+Matrix3Xd read_point_positions(const std::string &fname)
+{
+  const std::vector<std::string> coords(read_point_coordinates(fname)) ;
+  if (coords.empty())
+    throw "No point coordinates read" ;
+
+  Matrix3Xd points(3, coords.size()) ;
+  for (size_t i = 0; i < coords.size(); i++)
+  {
+    std::istringstream tokens(coords[i]) ;
+    if (!(tokens >> points(0, i) >> points(1, i) >> points(2, i)))
+      throw "Point coordinates are not x y z triplets" ;
+  }
+  return points ;
+}
+
+/*
+Appended data block: byte count (header_type UInt64) followed by the bytes.
+*/
+static void append_block(std::string &data, const void *values, const uint64_t bytes)
+{
+  data.append(reinterpret_cast<const char*>(&bytes), sizeof(bytes)) ;
+  data.append(reinterpret_cast<const char*>(values), bytes) ;
+}
+
+void write_vtk_fields(const std::string &dir,
+                      const std::string &prefix,
+                      const std::vector<std::string> &labels,
+                      const Matrix3Xd &points,
+                      const std::vector<std::string> &names,
+                      const std::vector<const double*> &fields,
+                      const long varSize,
+                      const int layout)
+{
+  const long pointSize(points.cols()) ;
+  const long rowsSize(pointSize * varSize) ;
+  if (names.size() != fields.size())
+    throw "Every field needs a name" ;
+
+  mkdir(dir.c_str(), 0755) ;
+
+  /* Geometry and vertex cells, the same in every file */
+  std::vector<int64_t> connectivity(pointSize), offsets(pointSize) ;
+  std::vector<uint8_t> types(pointSize, 1) ; // VTK_VERTEX
+  for (long i = 0; i < pointSize; i++)
+  {
+    connectivity[i] = i ;
+    offsets[i] = i + 1 ;
+  }
+
+  std::string geometry ;
+  append_block(geometry, points.data(), points.size() * sizeof(double)) ;
+  append_block(geometry, connectivity.data(), pointSize * sizeof(int64_t)) ;
+  append_block(geometry, offsets.data(), pointSize * sizeof(int64_t)) ;
+  append_block(geometry, types.data(), pointSize * sizeof(uint8_t)) ;
+
+  /* XML header: the data arrays first, then the geometry */
+  const uint64_t fieldBytes(sizeof(uint64_t) + rowsSize * sizeof(double)) ;
+  const uint64_t pointBytes(sizeof(uint64_t) + points.size() * sizeof(double)) ;
+  const uint64_t cellBytes(sizeof(uint64_t) + pointSize * sizeof(int64_t)) ;
+  uint64_t offset(0) ;
+
+  std::ostringstream header ;
+  const uint16_t endianness(1) ;
+  header << "<?xml version=\"1.0\"?>\n"
+         << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\""
+         << (*reinterpret_cast<const uint8_t*>(&endianness) ? "LittleEndian" : "BigEndian")
+         << "\" header_type=\"UInt64\">\n"
+         << "<UnstructuredGrid>\n"
+         << "<Piece NumberOfPoints=\"" << pointSize << "\" NumberOfCells=\"" << pointSize << "\">\n"
+         << "<PointData>\n" ;
+  for (const auto &name : names)
+  {
+    header << "<DataArray type=\"Float64\" Name=\"" << name << "\" NumberOfComponents=\"" << varSize
+           << "\" format=\"appended\" offset=\"" << offset << "\"/>\n" ;
+    offset += fieldBytes ;
+  }
+  header << "</PointData>\n"
+         << "<Points>\n"
+         << "<DataArray type=\"Float64\" NumberOfComponents=\"3\" format=\"appended\" offset=\"" << offset << "\"/>\n"
+         << "</Points>\n" ;
+  offset += pointBytes ;
+  header << "<Cells>\n"
+         << "<DataArray type=\"Int64\" Name=\"connectivity\" format=\"appended\" offset=\"" << offset << "\"/>\n" ;
+  offset += cellBytes ;
+  header << "<DataArray type=\"Int64\" Name=\"offsets\" format=\"appended\" offset=\"" << offset << "\"/>\n" ;
+  offset += cellBytes ;
+  header << "<DataArray type=\"UInt8\" Name=\"types\" format=\"appended\" offset=\"" << offset << "\"/>\n"
+         << "</Cells>\n"
+         << "</Piece>\n"
+         << "</UnstructuredGrid>\n"
+         << "<AppendedData encoding=\"raw\">\n_" ;
+  const std::string head(header.str()) ;
+  const std::string tail("\n</AppendedData>\n</VTKFile>\n") ;
+
+#pragma omp parallel
+  {
+    /* Components of every point side by side, as VTK expects them */
+    std::vector<double> values(rowsSize) ;
+
+#pragma omp for schedule(dynamic)
+    for (long k = 0; k < (long)labels.size(); k++)
+    {
+      const std::string fname(dir + "/" + prefix + labels[k] + ".vtu") ;
+      std::FILE *file(std::fopen(fname.c_str(), "wb")) ;
+      if (!file)
+      {
+#pragma omp critical
+        std::cerr << "Unable to write file " << fname << std::endl ;
+        continue ;
+      }
+
+      std::fwrite(head.data(), 1, head.size(), file) ;
+      for (auto field : fields)
+      {
+        const double *col(field + k * rowsSize) ;
+        if (layout == LAYOUT_INTERLEAVED)
+          std::copy(col, col + rowsSize, values.begin()) ;
+        else
+          for (long j = 0; j < varSize; j++)
+            for (long i = 0; i < pointSize; i++)
+              values[i * varSize + j] = col[j * pointSize + i] ;
+
+        const uint64_t bytes(rowsSize * sizeof(double)) ;
+        std::fwrite(&bytes, sizeof(bytes), 1, file) ;
+        std::fwrite(values.data(), sizeof(double), values.size(), file) ;
+      }
+      std::fwrite(geometry.data(), 1, geometry.size(), file) ;
+      std::fwrite(tail.data(), 1, tail.size(), file) ;
+      std::fclose(file) ;
+    }
+  }
+}
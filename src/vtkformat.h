@@ -0,0 +1,39 @@
+//
+// Point cloud fields in the VTK XML format (.vtu), for ParaView.
+//
+
+#ifndef POD_VTKFORMAT_H
+#define POD_VTKFORMAT_H
+
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+
+#include "utils.h"
+
+using namespace Eigen;
+
+/*
+Coordinates of the sampling points (pointCloud.xy or pointCloud.dat, as read
+by read_point_coordinates), one point per column.
+*/
+Matrix3Xd read_point_positions(const std::string &fname) ;
+
+/*
+Write column k of every matrix of fields (column-major, points.cols() varSize
+rows in the given layout as in the snapshot matrix, at least one column per
+label) as the point data names[i] of dir/<prefix><labels[k]>.vtu,
+an unstructured grid of one vertex per point, as written by pointsToVTK of
+pyevtk in the plot scripts. Data are appended in raw binary (doubles, varSize
+components per point), and the files are written in parallel.
+*/
+void write_vtk_fields(const std::string &dir,
+                      const std::string &prefix,
+                      const std::vector<std::string> &labels,
+                      const Matrix3Xd &points,
+                      const std::vector<std::string> &names,
+                      const std::vector<const double*> &fields,
+                      const long varSize,
+                      const int layout) ;
+
+#endif //POD_VTKFORMAT_H
@@ -14,6 +14,8 @@ import os
 import sys
 from tqdm import tqdm
 
+from podfiles import read_layout, split_components
+
 # ---------------------------------------------------------------------------
 # UTILITY FUNCTION(S)
 # ---------------------------------------------------------------------------
@@ -75,6 +77,7 @@ class calculateReconError():
 
         #- Read the reconstructed field
         print('\nReading reconstructed velocity fields from binary files...\n')
+        self.layout = read_layout(self.recDir+'/reconstruction.bin')
         self.U_R_V = np.fromfile(self.recDir+'/reconstruction.bin', dtype=float)
         self.U_R_V = self.U_R_V.reshape(self.N, self.varSize*self.MM)
 
@@ -84,7 +87,7 @@ class calculateReconError():
         for i in tqdm(range(self.N)):
             U_V_C = np.ascontiguousarray(self.U_V[:,i], dtype=np.float32)
             U = (U_V_C[:MM], U_V_C[MM:2*MM], U_V_C[2*MM:3*MM])
-            U_R = (self.U_R_V[i, :MM], self.U_R_V[i, MM:2*MM], self.U_R_V[i, 2*MM:3*MM])
+            U_R = split_components(self.U_R_V[i, :], MM, self.layout)
             nrmse += np.sqrt(np.sum((U[0]-U_R[0])**2 + 
                                     (U[1]-U_R[1])**2 +
                                     (U[2]-U_R[2])**2)) / np.sqrt(np.sum(
@@ -17,6 +17,8 @@ from pathlib import Path
 
 from pyevtk.hl import pointsToVTK
 
+from podfiles import read_layout, split_components
+
 # ---------------------------------------------------------------------------
 # UTILITY FUNCTION(S)
 # ---------------------------------------------------------------------------
@@ -78,6 +80,7 @@ class convertReconToVTK():
 
         #- Read the reconstructed field
         print('\nReading reconstructed velocity fields from binary files...\n')
+        self.layout = read_layout(self.recDir+'/reconstruction.bin')
         self.U_R_V = np.fromfile(self.recDir+'/reconstruction.bin', dtype=float)
         self.U_R_V = self.U_R_V.reshape(self.N, self.varSize*self.MM)
 
@@ -90,7 +93,7 @@ class convertReconToVTK():
             t = self.timeList[i]
             U_V_C = np.ascontiguousarray(self.U_V[:,i], dtype=np.float32)
             U = (U_V_C[:MM], U_V_C[MM:2*MM], U_V_C[2*MM:3*MM])
-            U_R = (self.U_R_V[i, :MM], self.U_R_V[i, MM:2*MM], self.U_R_V[i, 2*MM:3*MM])
+            U_R = split_components(self.U_R_V[i, :], MM, self.layout)
             pointsToVTK(vtkDir+"U_%s"%(str(t if t % 1 else int(t))), 
                     self.x, self.y, self.z, data={"U": U, "U_R": U_R})
 
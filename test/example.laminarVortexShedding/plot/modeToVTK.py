@@ -15,6 +15,8 @@ from tqdm import tqdm
 from pathlib import Path
 from pyevtk.hl import pointsToVTK
 
+from podfiles import read_layout, split_components
+
 # import time as clock
 # start_time = clock.time()
 
@@ -67,6 +69,7 @@ class convertModeToVTK():
 
         #- Read the reconstructed field
         print('\nReading modes from binary files...\n')
+        self.layout = read_layout(self.modeDir+'/mode.bin')
         self.mode = np.fromfile(self.modeDir+'/mode.bin', dtype=float)
         self.mode = self.mode.reshape(self.nModes, self.varSize*self.MM)
 
@@ -76,7 +79,7 @@ class convertModeToVTK():
         print('\nWriting the modes in VTK files...\n')
         MM = self.MM
         for i in tqdm(range(self.nModes)):
-            modei = (self.mode[i, :MM], self.mode[i, MM:2*MM], self.mode[i, 2*MM:3*MM])
+            modei = split_components(self.mode[i, :], MM, self.layout)
             pointsToVTK(vtkDir+"mode_%s"%(str(i)), 
                     self.x, self.y, self.z, data={"mode": modei})
 
@@ -0,0 +1,27 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+# ---------------------------------------------------------------------------
+""" 
+Helpers for the binary matrix files written by POD and REC
+"""
+
+# ---------------------------------------------------------------------------
+# UTILITY FUNCTION(S)
+# ---------------------------------------------------------------------------
+#- Layout of a binary matrix file, as recorded in its .info description
+def read_layout(fname):
+    try:
+        with open(fname+'.info') as f:
+            for line in f:
+                key, value = line.split()
+                if key == 'layout':
+                    return value
+    except IOError:
+        pass
+    return 'blocked'
+
+#- Split a field vector into its 3 components
+def split_components(v, MM, layout):
+    if layout == 'interleaved':
+        return (v[0::3], v[1::3], v[2::3])
+    return (v[:MM], v[MM:2*MM], v[2*MM:3*MM])